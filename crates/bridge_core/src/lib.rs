@@ -36,6 +36,7 @@ use flate2::{read::GzDecoder, Compression, GzBuilder};
 use md5::{Digest, Md5};
 use std::num::NonZeroUsize;
 use std::{
+    collections::HashMap,
     convert::TryInto,
     ffi::CStr,
     fmt::{Display, Error as FmtError, Formatter},
@@ -47,7 +48,7 @@ use std::{
 };
 use tectonic_errors::prelude::*;
 use tectonic_io_base::{
-    digest::DigestData, normalize_tex_path, InputFeatures, InputHandle, IoProvider, OpenResult,
+    digest::StreamDigest, normalize_tex_path, InputFeatures, InputHandle, IoProvider, OpenResult,
     OutputHandle,
 };
 use tectonic_status_base::{tt_error, tt_warning, MessageKind, StatusBackend};
@@ -131,20 +132,55 @@ pub trait DriverHooks {
     fn io(&mut self) -> &mut dyn IoProvider;
 
     /// This function is called when an output file is closed. The "digest"
-    /// argument specifies the cryptographic digest of the data that were
-    /// written. Note that this function takes ownership of the name and
-    /// digest.
-    fn event_output_closed(&mut self, _name: String, _digest: DigestData) {}
+    /// argument specifies the digest of the data that were written. Note that
+    /// this function takes ownership of the name and digest.
+    fn event_output_closed(&mut self, _name: String, _digest: StreamDigest) {}
 
     /// This function is called when an input file is closed. The "digest"
-    /// argument specifies the cryptographic digest of the data that were
-    /// read, if available. This digest is not always available, if the engine
+    /// argument specifies the digest of the data that were read, if
+    /// available. This digest is not always available, if the engine
     /// used seeks while reading the file. Note that this function takes
     /// ownership of the name and digest.
     fn event_input_closed(
         &mut self,
         _name: String,
-        _digest: Option<DigestData>,
+        _digest: Option<StreamDigest>,
+        _status: &mut dyn StatusBackend,
+    ) {
+    }
+
+    /// This function is called when a file is closed, just before
+    /// `event_input_closed` or `event_output_closed`, with the number of bytes
+    /// that the engine read from it or wrote to it.
+    fn event_bytes_transferred(&mut self, _name: &str, _read: u64, _written: u64) {}
+
+    /// Look up information about the input file `name` that was previously
+    /// saved with [`Self::metadata_cache_put`] under the key `key`.
+    ///
+    /// Engines use this to avoid re-parsing files just to measure them, e.g.
+    /// to get the dimensions of an included image, or to save a preprocessed
+    /// form of a file that is quicker to load. The driver is responsible for
+    /// making sure that the information still applies to the current contents
+    /// of the file, and may share it between engines and passes. The default
+    /// implementation never has anything saved.
+    fn metadata_cache_get(
+        &mut self,
+        _name: &str,
+        _key: &str,
+        _status: &mut dyn StatusBackend,
+    ) -> Option<Vec<u8>> {
+        None
+    }
+
+    /// Save information about the input file `name` for later lookup with
+    /// [`Self::metadata_cache_get`]. The key and value are opaque to the
+    /// driver, but the key contains no tabs or newlines. The default
+    /// implementation does nothing.
+    fn metadata_cache_put(
+        &mut self,
+        _name: &str,
+        _key: &str,
+        _value: &[u8],
         _status: &mut dyn StatusBackend,
     ) {
     }
@@ -359,6 +395,15 @@ pub struct CoreBridgeState<'a> {
     /// recent input didn't have a filesystem path (it came from a bundle or
     /// memory or something else).
     latest_input_path: Option<PathBuf>,
+
+    /// MD5 digests of files computed by `get_file_md5`, keyed by the name of
+    /// the file that was actually read. An entry is removed when the file is
+    /// opened or closed for writing.
+    file_md5s: HashMap<String, [u8; 16]>,
+
+    /// The names of the files read by `get_file_md5`, keyed by the names that
+    /// it was asked for, which may lack an extension.
+    file_md5_names: HashMap<String, String>,
 }
 
 impl<'a> CoreBridgeState<'a> {
@@ -376,6 +421,8 @@ impl<'a> CoreBridgeState<'a> {
             input_handles: Vec::new(),
             latest_input_path: None,
             fs_emulation_settings,
+            file_md5s: HashMap::new(),
+            file_md5_names: HashMap::new(),
         }
     }
 
@@ -461,12 +508,21 @@ impl<'a> CoreBridgeState<'a> {
 
     fn get_file_md5(&mut self, name: &str, dest: &mut [u8]) -> bool {
         let name = normalize_tex_path(name);
-        let mut hash = Md5::default();
 
-        // We could try to be fancy and look up the file in our cache to see
-        // if we've already computed is SHA256 ... and then lie and use a
-        // truncated SHA256 digest as the MD5 ... but it seems like a better
-        // idea to just go and read the file.
+        // LaTeX's rerun checks ask for the MD5 of the same files over and over
+        // again. Files can only change if we write them, or if a shell-escape
+        // command does, and in both cases we forget the saved digest.
+
+        if let Some(digest) = self
+            .file_md5_names
+            .get(name.as_ref())
+            .and_then(|read_name| self.file_md5s.get(read_name))
+        {
+            dest.copy_from_slice(digest);
+            return false;
+        }
+
+        let mut hash = Md5::default();
 
         let mut ih = match self.input_open_name_format(&name, FileFormat::Tex) {
             OpenResult::Ok((ih, _path)) => ih,
@@ -486,8 +542,8 @@ impl<'a> CoreBridgeState<'a> {
 
         // No canned way to stream the whole file into the digest, it seems.
 
-        const BUF_SIZE: usize = 1024;
-        let mut buf = [0u8; BUF_SIZE];
+        const BUF_SIZE: usize = 65536;
+        let mut buf = vec![0u8; BUF_SIZE];
         let mut error_occurred = false;
 
         loop {
@@ -508,17 +564,43 @@ impl<'a> CoreBridgeState<'a> {
 
         // Clean up.
 
-        let (name, digest_opt) = ih.into_name_digest();
-        self.hooks.event_input_closed(name, digest_opt, self.status);
+        self.hooks
+            .event_bytes_transferred(ih.name(), ih.bytes_read(), 0);
+        let (ih_name, digest_opt) = ih.into_name_digest();
+        self.hooks
+            .event_input_closed(ih_name.clone(), digest_opt, self.status);
 
         if !error_occurred {
-            let result = hash.finalize();
-            dest.copy_from_slice(result.as_slice());
+            let mut result = [0u8; 16];
+            result.copy_from_slice(hash.finalize().as_slice());
+            dest.copy_from_slice(&result);
+
+            // A file that is still being written may change again before
+            // we'd notice.
+            let being_written = self
+                .output_handles
+                .iter()
+                .flatten()
+                .any(|oh| oh.name() == ih_name);
+
+            if !being_written {
+                self.file_md5_names
+                    .insert(name.into_owned(), ih_name.clone());
+                self.file_md5s.insert(ih_name, result);
+            }
         }
 
         error_occurred
     }
 
+    /// Forget the saved MD5 digest of a file that is being written, and how
+    /// its name was resolved, since a new file by that name may now shadow
+    /// another one.
+    fn forget_file_md5(&mut self, name: &str) {
+        self.file_md5s.remove(name);
+        self.file_md5_names.remove(name);
+    }
+
     /// Get a mutable reference to an [`OutputHandle`] associated with an [`OutputId`]
     pub fn get_output(&mut self, id: OutputId) -> &mut OutputHandle {
         self.output_handles[id.idx()].as_mut().unwrap()
@@ -526,8 +608,10 @@ impl<'a> CoreBridgeState<'a> {
 
     /// Open a new output, provided the output name and whether it is gzipped.
     pub fn output_open(&mut self, name: &str, is_gz: bool) -> Option<OutputId> {
-        let io = self.hooks.io();
         let name = normalize_tex_path(name);
+        self.forget_file_md5(&name);
+
+        let io = self.hooks.io();
 
         let mut oh = match io.output_open_name(&name) {
             OpenResult::Ok(oh) => oh,
@@ -601,7 +685,10 @@ impl<'a> CoreBridgeState<'a> {
             tt_warning!(self.status, "error when closing output {}", oh.name(); e.into());
             rv = true;
         }
+        self.hooks
+            .event_bytes_transferred(oh.name(), 0, oh.bytes_written());
         let (name, digest) = oh.into_name_digest();
+        self.forget_file_md5(&name);
         self.hooks.event_output_closed(name, digest);
         rv
     }
@@ -717,13 +804,34 @@ impl<'a> CoreBridgeState<'a> {
             rv = true;
         }
 
+        self.hooks
+            .event_bytes_transferred(ih.name(), ih.bytes_read(), 0);
         let (name, digest_opt) = ih.into_name_digest();
         self.hooks.event_input_closed(name, digest_opt, self.status);
         rv
     }
 
+    /// Look up information saved about the open input file `handle`; see
+    /// [`DriverHooks::metadata_cache_get`].
+    pub fn input_metadata_get(&mut self, handle: InputId, key: &str) -> Option<Vec<u8>> {
+        let name = self.get_input(handle).name().to_owned();
+        self.hooks.metadata_cache_get(&name, key, self.status)
+    }
+
+    /// Save information about the open input file `handle`; see
+    /// [`DriverHooks::metadata_cache_put`].
+    pub fn input_metadata_put(&mut self, handle: InputId, key: &str, value: &[u8]) {
+        let name = self.get_input(handle).name().to_owned();
+        self.hooks
+            .metadata_cache_put(&name, key, value, self.status)
+    }
+
     fn shell_escape(&mut self, command: &str) -> bool {
         if self.security.allow_shell_escape() {
+            // The command might change any file.
+            self.file_md5s.clear();
+            self.file_md5_names.clear();
+
             match self.hooks.sysrq_shell_escape(command, self.status) {
                 Ok(_) => false,
 
@@ -1240,6 +1348,59 @@ pub extern "C" fn ttbc_input_close(
     }
 }
 
+/// Look up saved information about a Tectonic input file.
+///
+/// If the driver has a value saved under `key` for the file that `handle` is
+/// reading, return its length in bytes, and if it fits into `buf` along with a
+/// terminating NUL, copy it there. Otherwise return -1. `buf` may be null if
+/// `len` is zero, to just get the length of the value.
+///
+/// # Safety
+///
+/// This function is unsafe because it dereferences raw C pointers.
+#[no_mangle]
+pub unsafe extern "C" fn ttbc_input_get_metadata(
+    es: &mut CoreBridgeState,
+    handle: Option<InputId>,
+    key: *const libc::c_char,
+    buf: *mut libc::c_char,
+    len: libc::size_t,
+) -> libc::ssize_t {
+    let rkey = CStr::from_ptr(key).to_string_lossy();
+
+    let value = match es.input_metadata_get(handle.expect("valid handle"), &rkey) {
+        Some(v) => v,
+        None => return -1,
+    };
+
+    if value.len() < len {
+        let rbuf = slice::from_raw_parts_mut(buf as *mut u8, len);
+        rbuf[..value.len()].copy_from_slice(&value);
+        rbuf[value.len()] = 0;
+    }
+
+    value.len() as libc::ssize_t
+}
+
+/// Save information about a Tectonic input file, for later lookup with
+/// `ttbc_input_get_metadata`. The value is `len` bytes long.
+///
+/// # Safety
+///
+/// This function is unsafe because it dereferences raw C pointers.
+#[no_mangle]
+pub unsafe extern "C" fn ttbc_input_put_metadata(
+    es: &mut CoreBridgeState,
+    handle: Option<InputId>,
+    key: *const libc::c_char,
+    value: *const libc::c_char,
+    len: libc::size_t,
+) {
+    let rkey = CStr::from_ptr(key).to_string_lossy();
+    let rvalue = slice::from_raw_parts(value as *const u8, len);
+    es.input_metadata_put(handle.expect("valid handle"), &rkey, rvalue);
+}
+
 /// A buffer for diagnostic messages. Rust code does not need to use this type.
 ///
 /// This type has to be public so that it can be exposed in the C/C++ headers,
@@ -1429,3 +1590,107 @@ impl FileFormat {
 /// Does our resulting executable link correctly?
 #[test]
 fn linkage() {}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::{cell::RefCell, io::Cursor, rc::Rc};
+    use tectonic_io_base::InputOrigin;
+    use tectonic_status_base::NoopStatusBackend;
+
+    type Files = Rc<RefCell<HashMap<String, Vec<u8>>>>;
+
+    /// Writes straight into the shared file map, so that readers see partly
+    /// written files.
+    struct FileWriter(String, Files);
+
+    impl Write for FileWriter {
+        fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+            self.1
+                .borrow_mut()
+                .get_mut(&self.0)
+                .unwrap()
+                .extend_from_slice(buf);
+            Ok(buf.len())
+        }
+
+        fn flush(&mut self) -> std::io::Result<()> {
+            Ok(())
+        }
+    }
+
+    struct TestIo(Files);
+
+    impl IoProvider for TestIo {
+        fn output_open_name(&mut self, name: &str) -> OpenResult<OutputHandle> {
+            self.0.borrow_mut().insert(name.to_owned(), Vec::new());
+            OpenResult::Ok(OutputHandle::new(
+                name,
+                FileWriter(name.to_owned(), self.0.clone()),
+            ))
+        }
+
+        fn input_open_name(
+            &mut self,
+            name: &str,
+            _status: &mut dyn StatusBackend,
+        ) -> OpenResult<InputHandle> {
+            match self.0.borrow().get(name) {
+                Some(data) => OpenResult::Ok(InputHandle::new(
+                    name,
+                    Cursor::new(data.clone()),
+                    InputOrigin::Other,
+                )),
+                None => OpenResult::NotAvailable,
+            }
+        }
+    }
+
+    fn md5(state: &mut CoreBridgeState, name: &str) -> [u8; 16] {
+        let mut digest = [0u8; 16];
+        assert!(!state.get_file_md5(name, &mut digest));
+        digest
+    }
+
+    fn write(state: &mut CoreBridgeState, name: &str, data: &[u8]) -> OutputId {
+        let id = state.output_open(name, false).unwrap();
+        assert!(!state.output_write(id, data));
+        id
+    }
+
+    /// Saved MD5s must be forgotten whenever the file that was actually read
+    /// might have changed.
+    #[test]
+    fn file_md5_cache() {
+        let files = Files::default();
+        files
+            .borrow_mut()
+            .insert("doc.tex".to_owned(), b"one".to_vec());
+
+        let mut hooks = MinimalDriver::new(TestIo(files.clone()));
+        let mut status = NoopStatusBackend::default();
+        let mut state = CoreBridgeState::new(
+            SecuritySettings::default(),
+            &mut hooks,
+            &mut status,
+            FsEmulationSettings::default(),
+        );
+
+        // "doc" resolves to "doc.tex", so writing the latter must be noticed.
+        let one = md5(&mut state, "doc");
+        assert_eq!(md5(&mut state, "doc"), one);
+        let id = write(&mut state, "doc.tex", b"two");
+        let two = md5(&mut state, "doc");
+        assert_ne!(two, one);
+
+        // While the file is open, its contents can still change.
+        assert!(!state.output_write(id, b"three"));
+        let three = md5(&mut state, "doc");
+        assert_ne!(three, two);
+
+        // Closing it must not leave a digest of a partial file behind.
+        files.borrow_mut().get_mut("doc.tex").unwrap().push(b'!');
+        assert!(!state.output_close(id));
+        assert_ne!(md5(&mut state, "doc"), three);
+    }
+}
@@ -324,6 +324,20 @@ ttstub_input_close(rust_input_handle_t handle)
 }
 
 
+ssize_t
+ttstub_input_get_metadata(rust_input_handle_t handle, const char *key, char *buf, size_t len)
+{
+    return ttbc_input_get_metadata(tectonic_global_bridge_core, handle, key, buf, len);
+}
+
+
+void
+ttstub_input_put_metadata(rust_input_handle_t handle, const char *key, const char *value, size_t len)
+{
+    ttbc_input_put_metadata(tectonic_global_bridge_core, handle, key, value, len);
+}
+
+
 int
 ttstub_get_file_md5(char const *path, char *digest)
 {
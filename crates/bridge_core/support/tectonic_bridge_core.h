@@ -247,6 +247,8 @@ ssize_t ttstub_input_read_partial(rust_input_handle_t handle, char *data, size_t
 int ttstub_input_getc(rust_input_handle_t handle);
 int ttstub_input_ungetc(rust_input_handle_t handle, int ch);
 int ttstub_input_close(rust_input_handle_t handle);
+ssize_t ttstub_input_get_metadata(rust_input_handle_t handle, const char *key, char *buf, size_t len);
+void ttstub_input_put_metadata(rust_input_handle_t handle, const char *key, const char *value, size_t len);
 
 int ttstub_get_file_md5(char const *path, char *digest);
 
@@ -314,6 +314,38 @@ ssize_t ttbc_input_read_partial(ttbc_state_t *es, Option_InputId handle, uint8_t
  */
 int ttbc_input_close(ttbc_state_t *es, Option_InputId handle);
 
+/**
+ * Look up saved information about a Tectonic input file.
+ *
+ * If the driver has a value saved under `key` for the file that `handle` is
+ * reading, return its length in bytes, and if it fits into `buf` along with a
+ * terminating NUL, copy it there. Otherwise return -1. `buf` may be null if
+ * `len` is zero, to just get the length of the value.
+ *
+ * # Safety
+ *
+ * This function is unsafe because it dereferences raw C pointers.
+ */
+ssize_t ttbc_input_get_metadata(ttbc_state_t *es,
+                                Option_InputId handle,
+                                const char *key,
+                                char *buf,
+                                size_t len);
+
+/**
+ * Save information about a Tectonic input file, for later lookup with
+ * `ttbc_input_get_metadata`. The value is `len` bytes long.
+ *
+ * # Safety
+ *
+ * This function is unsafe because it dereferences raw C pointers.
+ */
+void ttbc_input_put_metadata(ttbc_state_t *es,
+                             Option_InputId handle,
+                             const char *key,
+                             const char *value,
+                             size_t len);
+
 /**
  * Create a new diagnostic that will be reported as a warning.
  */
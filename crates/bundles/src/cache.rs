@@ -63,6 +63,20 @@ macro_rules! ensure_dir {
     };
 }
 
+/// Counts of how a [`BundleCache`] satisfied requests for files.
+#[derive(Clone, Copy, Debug, Default, Eq, PartialEq)]
+pub struct CacheStats {
+    /// Files that were already present in the local cache.
+    pub hits: u64,
+
+    /// Files that had to be fetched from the backing bundle.
+    pub fetches: u64,
+
+    /// Requests for files that weren't available, either because the bundle
+    /// doesn't contain them or because we're only using cached files.
+    pub misses: u64,
+}
+
 /// A cache wrapper for another bundle.
 ///
 /// This bundle implementation is the key to Tectonic’s ability to download TeX
@@ -92,6 +106,9 @@ pub struct BundleCache<'this, T> {
 
     // The hash of the bundle we're caching.
     bundle_hash: DigestData,
+
+    /// How file requests have been satisfied so far.
+    stats: CacheStats,
 }
 
 impl<'this, T: FileIndex<'this>> BundleCache<'this, T> {
@@ -171,6 +188,7 @@ impl<'this, T: FileIndex<'this>> BundleCache<'this, T> {
             bundle,
             cache_root,
             bundle_hash,
+            stats: CacheStats::default(),
         };
 
         // Right now, files are stored in
@@ -337,12 +355,24 @@ impl<'this, T: FileIndex<'this>> IoProvider for BundleCache<'this, T> {
         status: &mut dyn StatusBackend,
     ) -> OpenResult<InputHandle> {
         let path = match self.get_fileinfo(name) {
-            OpenResult::NotAvailable => return OpenResult::NotAvailable,
+            OpenResult::NotAvailable => {
+                self.stats.misses += 1;
+                return OpenResult::NotAvailable;
+            }
             OpenResult::Err(e) => return OpenResult::Err(e),
-            OpenResult::Ok((true, f)) => self.get_file_path(&f),
+            OpenResult::Ok((true, f)) => {
+                self.stats.hits += 1;
+                self.get_file_path(&f)
+            }
             OpenResult::Ok((false, f)) => match self.fetch_file(f, status) {
-                OpenResult::Ok(p) => p,
-                OpenResult::NotAvailable => return OpenResult::NotAvailable,
+                OpenResult::Ok(p) => {
+                    self.stats.fetches += 1;
+                    p
+                }
+                OpenResult::NotAvailable => {
+                    self.stats.misses += 1;
+                    return OpenResult::NotAvailable;
+                }
                 OpenResult::Err(e) => return OpenResult::Err(e),
             },
         };
@@ -368,4 +398,8 @@ impl<'this, T: FileIndex<'this>> Bundle for BundleCache<'this, T> {
     fn all_files(&self) -> Vec<String> {
         self.bundle.all_files()
     }
+
+    fn cache_stats(&self) -> Option<CacheStats> {
+        Some(self.stats)
+    }
 }
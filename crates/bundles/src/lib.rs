@@ -107,6 +107,12 @@ pub trait Bundle: IoProvider {
     /// Iterate over all file paths in this bundle.
     /// This is used for the `bundle search` command
     fn all_files(&self) -> Vec<String>;
+
+    /// If this bundle keeps a local cache of its files, get statistics about
+    /// how well that cache has been working.
+    fn cache_stats(&self) -> Option<cache::CacheStats> {
+        None
+    }
 }
 
 impl<B: Bundle + ?Sized> Bundle for Box<B> {
@@ -117,6 +123,10 @@ impl<B: Bundle + ?Sized> Bundle for Box<B> {
     fn all_files(&self) -> Vec<String> {
         (**self).all_files()
     }
+
+    fn cache_stats(&self) -> Option<cache::CacheStats> {
+        (**self).cache_stats()
+    }
 }
 
 /// A bundle that may be cached.
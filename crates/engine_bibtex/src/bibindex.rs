@@ -0,0 +1,282 @@
+//! Cached layouts of `.bib` databases.
+//!
+//! Large bibliographies are typically cited sparsely, but BibTeX still has to
+//! scan every entry of every database on every run. The first time we read a
+//! database cleanly we remember where each of its `@` items starts and, for
+//! entries, what their lowercased keys are, and save that in the driver's
+//! metadata cache, which keys it by the digest of the file. The next time we
+//! see identical contents -- a later pass or build of the same document, or
+//! another document that shares the database -- we jump straight over entries
+//! that aren't cited.
+//!
+//! Skipping is only sound because an uncited entry has no side effects: it's
+//! scanned without storing anything, and the only messages it can produce are
+//! syntax errors. We therefore only remember databases that were read without
+//! any errors, and stop replaying a layout as soon as the parse wanders away
+//! from it.
+
+use crate::{
+    buffer::{BufTy, GlobalBuffer},
+    hash::{self, HashData},
+    peekable::input_ln,
+    pool::StringPool,
+    File, History,
+};
+use tectonic_bridge_core::{CoreBridgeState, InputId};
+
+/// The key under which layouts are saved in the driver's metadata cache.
+/// Change it if the layout format or what it means changes.
+const LAYOUT_KEY: &str = "bib-layout-v1";
+
+/// One `@` command or entry of a database.
+struct BibItem {
+    /// Offset of the `@` within the file.
+    at: usize,
+    /// Offset of the start of the line containing the `@`.
+    line_start: usize,
+    /// Line number of that line.
+    line: u32,
+    /// The lowercased key, if this item is an entry.
+    key: Option<Box<[u8]>>,
+}
+
+/// The items of a database, in file order.
+struct BibLayout {
+    items: Vec<BibItem>,
+}
+
+impl BibLayout {
+    /// Serialize the layout for the metadata cache. Each item is stored as
+    /// little-endian `at`, `line_start` and `line`, followed by the length of
+    /// the key, or `u32::MAX` if there is none, and the key itself.
+    fn to_bytes(&self) -> Vec<u8> {
+        let mut data = Vec::new();
+
+        for item in &self.items {
+            data.extend_from_slice(&(item.at as u64).to_le_bytes());
+            data.extend_from_slice(&(item.line_start as u64).to_le_bytes());
+            data.extend_from_slice(&item.line.to_le_bytes());
+
+            match &item.key {
+                Some(key) => {
+                    data.extend_from_slice(&(key.len() as u32).to_le_bytes());
+                    data.extend_from_slice(key);
+                }
+                None => data.extend_from_slice(&u32::MAX.to_le_bytes()),
+            }
+        }
+
+        data
+    }
+
+    /// Deserialize a layout saved by [`Self::to_bytes`], returning None if
+    /// the data are malformed.
+    fn from_bytes(mut data: &[u8]) -> Option<BibLayout> {
+        fn take<'a>(data: &mut &'a [u8], n: usize) -> Option<&'a [u8]> {
+            if data.len() < n {
+                return None;
+            }
+
+            let (head, rest) = data.split_at(n);
+            *data = rest;
+            Some(head)
+        }
+
+        fn take_u64(data: &mut &[u8]) -> Option<u64> {
+            Some(u64::from_le_bytes(take(data, 8)?.try_into().ok()?))
+        }
+
+        fn take_u32(data: &mut &[u8]) -> Option<u32> {
+            Some(u32::from_le_bytes(take(data, 4)?.try_into().ok()?))
+        }
+
+        let mut items = Vec::new();
+
+        while !data.is_empty() {
+            let at = take_u64(&mut data)? as usize;
+            let line_start = take_u64(&mut data)? as usize;
+            let line = take_u32(&mut data)?;
+            let key = match take_u32(&mut data)? {
+                u32::MAX => None,
+                n => Some(take(&mut data, n as usize)?.into()),
+            };
+
+            items.push(BibItem {
+                at,
+                line_start,
+                line,
+                key,
+            });
+        }
+
+        Some(BibLayout { items })
+    }
+}
+
+enum State {
+    /// We're not tracking this file at all.
+    Off,
+    /// We haven't seen this file before and are noting down its layout.
+    Recording {
+        id: InputId,
+        items: Vec<BibItem>,
+        errors: u32,
+    },
+    /// We know this file's layout; `next` is the item we expect to see next.
+    Replaying { layout: BibLayout, next: usize },
+}
+
+/// Tracks the layout of the database currently being read.
+pub(crate) struct BibIndex {
+    state: State,
+    /// The number of entries skipped so far.
+    skipped: usize,
+}
+
+fn error_count(history: History) -> Option<u32> {
+    match history {
+        History::Spotless | History::WarningIssued(_) => Some(0),
+        History::ErrorIssued(n) => Some(n),
+        History::FatalError => None,
+    }
+}
+
+impl BibIndex {
+    pub fn new() -> BibIndex {
+        BibIndex {
+            state: State::Off,
+            skipped: 0,
+        }
+    }
+
+    /// Start reading the database open as `id`, looking up its layout in
+    /// the driver's metadata cache.
+    pub fn start(&mut self, engine: &mut CoreBridgeState<'_>, id: InputId, history: History) {
+        let cached = engine
+            .input_metadata_get(id, LAYOUT_KEY)
+            .and_then(|data| BibLayout::from_bytes(&data));
+
+        self.state = match (cached, error_count(history)) {
+            (Some(layout), _) => State::Replaying { layout, next: 0 },
+            (None, Some(errors)) => State::Recording {
+                id,
+                items: Vec::new(),
+                errors,
+            },
+            (None, None) => State::Off,
+        };
+    }
+
+    /// Finish reading the current database, saving its layout if it was
+    /// read cleanly.
+    pub fn finish(&mut self, engine: &mut CoreBridgeState<'_>, history: History) {
+        if let State::Recording { id, items, errors } =
+            std::mem::replace(&mut self.state, State::Off)
+        {
+            if error_count(history) != Some(errors) {
+                return;
+            }
+
+            engine.input_metadata_put(id, LAYOUT_KEY, &BibLayout { items }.to_bytes());
+        }
+    }
+
+    /// The number of uncited entries that have been skipped.
+    pub fn skipped(&self) -> usize {
+        self.skipped
+    }
+
+    /// Note that the reader found an `@` at offset `at` of the file.
+    pub fn record_item(&mut self, at: usize, line_start: usize, line: u32) {
+        if let State::Recording { items, .. } = &mut self.state {
+            items.push(BibItem {
+                at,
+                line_start,
+                line,
+                key: None,
+            });
+        }
+    }
+
+    /// Note that the most recently found item is an entry with the given
+    /// (lowercased) key.
+    pub fn record_key(&mut self, key: &[u8]) {
+        if let State::Recording { items, .. } = &mut self.state {
+            if let Some(item) = items.last_mut() {
+                item.key = Some(key.into());
+            }
+        }
+    }
+
+    /// Check the `@` found at offset `at` of the file against the known
+    /// layout. Returns the item following it if the item is an uncited entry
+    /// that can be skipped outright, `Some(None)` if that entry was the last
+    /// item in the file, and `None` if the item needs to be parsed as usual.
+    fn check_item(
+        &mut self,
+        at: usize,
+        hash: &HashData,
+        pool: &StringPool,
+    ) -> Option<Option<(usize, usize, u32)>> {
+        let State::Replaying { layout, next } = &mut self.state else {
+            return None;
+        };
+
+        if layout.items.get(*next).map(|item| item.at) != Some(at) {
+            // The parse has diverged from the layout we know about, presumably
+            // while recovering from an error. Stop trusting it.
+            self.state = State::Off;
+            return None;
+        }
+
+        let item = &layout.items[*next];
+        *next += 1;
+
+        let key = item.key.as_ref()?;
+        if hash.lookup_str::<hash::LcCite>(pool, key).is_some() {
+            return None;
+        }
+
+        self.skipped += 1;
+
+        Some(
+            layout
+                .items
+                .get(*next)
+                .map(|next| (next.line_start, next.at, next.line)),
+        )
+    }
+}
+
+/// If the `@` at the current position of the database being read is known to
+/// start an uncited entry, skip to the next item. Returns whether the entry was
+/// skipped.
+pub(crate) fn skip_uncited_entry(
+    index: &mut BibIndex,
+    file: &mut File,
+    buffers: &mut GlobalBuffer,
+    hash: &HashData,
+    pool: &StringPool,
+    all_entries: bool,
+) -> bool {
+    if all_entries {
+        return false;
+    }
+
+    let at = file.file.line_start() + buffers.offset(BufTy::Base, 2);
+    match index.check_item(at, hash, pool) {
+        None => false,
+        Some(Some((line_start, next_at, line))) => {
+            file.file.seek(line_start);
+            input_ln(&mut file.file, buffers);
+            file.line = line;
+            buffers.set_offset(BufTy::Base, 2, next_at - line_start);
+            true
+        }
+        Some(None) => {
+            file.file.seek(usize::MAX);
+            buffers.set_offset(BufTy::Base, 2, buffers.init(BufTy::Base));
+            true
+        }
+    }
+}
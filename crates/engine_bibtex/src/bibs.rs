@@ -1,4 +1,5 @@
 use crate::{
+    bibindex::{skip_uncited_entry, BibIndex},
     buffer::{BufTy, GlobalBuffer},
     char_info::LexClass,
     cite::add_database_cite,
@@ -12,8 +13,9 @@ use crate::{
     peekable::input_ln,
     pool::{StrNumber, StringPool},
     scan::{scan_and_store_the_field_value_and_eat_white, scan_identifier, Scan, ScanRes},
-    Bibtex, BibtexError, File, GlobalItems, HashPointer, LookupRes,
+    Bibtex, BibtexError, File, GlobalItems, HashPointer, History, LookupRes,
 };
+use tectonic_bridge_core::CoreBridgeState;
 
 #[derive(Copy, Clone, Debug, PartialEq)]
 pub(crate) enum BibCommand {
@@ -25,6 +27,7 @@ pub(crate) enum BibCommand {
 pub(crate) struct BibData {
     bibs: Vec<File>,
     preamble: Vec<StrNumber>,
+    index: BibIndex,
 }
 
 impl BibData {
@@ -32,6 +35,7 @@ impl BibData {
         BibData {
             bibs: Vec::new(),
             preamble: Vec::new(),
+            index: BibIndex::new(),
         }
     }
 
@@ -66,19 +70,44 @@ impl BibData {
     pub fn len(&self) -> usize {
         self.bibs.len()
     }
+
+    pub fn start_reading(&mut self, engine: &mut CoreBridgeState<'_>, history: History) {
+        self.index.start(engine, self.bibs[0].file.id(), history);
+    }
+
+    pub fn finish_reading(&mut self, engine: &mut CoreBridgeState<'_>, history: History) {
+        self.index.finish(engine, history);
+    }
+
+    pub fn index_mut(&mut self) -> &mut BibIndex {
+        &mut self.index
+    }
+
+    pub fn skip_uncited_entry(
+        &mut self,
+        buffers: &mut GlobalBuffer,
+        hash: &HashData,
+        pool: &StringPool,
+        all_entries: bool,
+    ) -> bool {
+        skip_uncited_entry(
+            &mut self.index,
+            &mut self.bibs[0],
+            buffers,
+            hash,
+            pool,
+            all_entries,
+        )
+    }
 }
 
-pub(crate) fn eat_bib_white_space(
-    ctx: &mut Bibtex<'_, '_>,
-    buffers: &mut GlobalBuffer,
-    bibs: &mut BibData,
-) -> bool {
+pub(crate) fn eat_bib_white_space(buffers: &mut GlobalBuffer, bibs: &mut BibData) -> bool {
     let mut init = buffers.init(BufTy::Base);
     while !Scan::new()
         .not_class(LexClass::Whitespace)
         .scan_till(buffers, init)
     {
-        if !input_ln(ctx.engine, &mut bibs.top_file_mut().file, buffers) {
+        if !input_ln(&mut bibs.top_file_mut().file, buffers) {
             return false;
         }
 
@@ -108,7 +137,7 @@ pub(crate) fn compress_bib_white(
         .not_class(LexClass::Whitespace)
         .scan_till(buffers, last)
     {
-        let res = !input_ln(ctx.engine, &mut bibs.top_file_mut().file, buffers);
+        let res = !input_ln(&mut bibs.top_file_mut().file, buffers);
 
         if res {
             return eat_bib_print(ctx, buffers, pool, bibs, bib_command).map(|_| false);
@@ -132,11 +161,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
 
     let mut init = globals.buffers.init(BufTy::Base);
     while !Scan::new().chars(b"@").scan_till(globals.buffers, init) {
-        if !input_ln(
-            ctx.engine,
-            &mut globals.bibs.top_file_mut().file,
-            globals.buffers,
-        ) {
+        if !input_ln(&mut globals.bibs.top_file_mut().file, globals.buffers) {
             return Ok(());
         }
 
@@ -151,11 +176,23 @@ pub(crate) fn get_bib_command_or_entry_and_process(
         return Err(BibtexError::Fatal);
     }
 
+    if globals
+        .bibs
+        .skip_uncited_entry(globals.buffers, globals.hash, globals.pool, ctx.all_entries)
+    {
+        return Ok(());
+    }
+
+    let file = globals.bibs.top_file();
+    let at = file.file.line_start() + globals.buffers.offset(BufTy::Base, 2);
+    let (line_start, line) = (file.file.line_start(), file.line);
+    globals.bibs.index_mut().record_item(at, line_start, line);
+
     globals
         .buffers
         .set_offset(BufTy::Base, 2, globals.buffers.offset(BufTy::Base, 2) + 1);
 
-    if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+    if !eat_bib_white_space(globals.buffers, globals.bibs) {
         eat_bib_print(
             ctx,
             globals.buffers,
@@ -197,7 +234,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
         match cmd {
             BibCommand::Comment => (),
             BibCommand::Preamble => {
-                if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+                if !eat_bib_white_space(globals.buffers, globals.bibs) {
                     eat_bib_print(
                         ctx,
                         globals.buffers,
@@ -231,7 +268,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
                     globals.buffers.offset(BufTy::Base, 2) + 1,
                 );
 
-                if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+                if !eat_bib_white_space(globals.buffers, globals.bibs) {
                     eat_bib_print(
                         ctx,
                         globals.buffers,
@@ -275,7 +312,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
                 );
             }
             BibCommand::String => {
-                if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+                if !eat_bib_white_space(globals.buffers, globals.bibs) {
                     eat_bib_print(
                         ctx,
                         globals.buffers,
@@ -309,7 +346,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
                     globals.buffers.offset(BufTy::Base, 2) + 1,
                 );
 
-                if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+                if !eat_bib_white_space(globals.buffers, globals.bibs) {
                     eat_bib_print(
                         ctx,
                         globals.buffers,
@@ -353,7 +390,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
                     .set_extra(res.loc, globals.hash.get(res.loc).text());
                 *cur_macro_loc = res.loc;
 
-                if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+                if !eat_bib_white_space(globals.buffers, globals.bibs) {
                     eat_bib_print(
                         ctx,
                         globals.buffers,
@@ -381,7 +418,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
                     globals.buffers.offset(BufTy::Base, 2) + 1,
                 );
 
-                if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+                if !eat_bib_white_space(globals.buffers, globals.bibs) {
                     eat_bib_print(
                         ctx,
                         globals.buffers,
@@ -436,7 +473,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
         .lookup_str::<BstFn>(globals.pool, bst_fn)
         .filter(|&loc| matches!(globals.hash.get(loc).extra(), BstFn::Wizard(_),));
 
-    if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+    if !eat_bib_white_space(globals.buffers, globals.bibs) {
         eat_bib_print(
             ctx,
             globals.buffers,
@@ -468,7 +505,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
         .buffers
         .set_offset(BufTy::Base, 2, globals.buffers.offset(BufTy::Base, 2) + 1);
 
-    if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+    if !eat_bib_white_space(globals.buffers, globals.bibs) {
         eat_bib_print(
             ctx,
             globals.buffers,
@@ -498,6 +535,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
     let range = globals.buffers.offset(BufTy::Base, 1)..globals.buffers.offset(BufTy::Base, 2);
     let lc_cite = &mut globals.buffers.buffer_mut(BufTy::Ex)[range];
     lc_cite.make_ascii_lowercase();
+    globals.bibs.index_mut().record_key(lc_cite);
 
     let lc_res = if ctx.all_entries {
         globals
@@ -652,7 +690,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
         }
     }
 
-    if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+    if !eat_bib_white_space(globals.buffers, globals.bibs) {
         eat_bib_print(
             ctx,
             globals.buffers,
@@ -681,7 +719,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
             .buffers
             .set_offset(BufTy::Base, 2, globals.buffers.offset(BufTy::Base, 2) + 1);
 
-        if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+        if !eat_bib_white_space(globals.buffers, globals.bibs) {
             eat_bib_print(
                 ctx,
                 globals.buffers,
@@ -732,7 +770,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
             }
         }
 
-        if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+        if !eat_bib_white_space(globals.buffers, globals.bibs) {
             eat_bib_print(
                 ctx,
                 globals.buffers,
@@ -758,7 +796,7 @@ pub(crate) fn get_bib_command_or_entry_and_process(
             .buffers
             .set_offset(BufTy::Base, 2, globals.buffers.offset(BufTy::Base, 2) + 1);
 
-        if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+        if !eat_bib_white_space(globals.buffers, globals.bibs) {
             eat_bib_print(
                 ctx,
                 globals.buffers,
@@ -512,7 +512,9 @@ fn bst_read_command(
 
         let mut cur_macro_loc = HashPointer::default();
         let mut field_name_loc = HashPointer::default();
-        while !globals.bibs.top_file_mut().file.eof(ctx.engine) {
+        let history = ctx.history;
+        globals.bibs.start_reading(ctx.engine, history);
+        while !globals.bibs.top_file_mut().file.eof() {
             get_bib_command_or_entry_and_process(
                 ctx,
                 globals,
@@ -520,9 +522,13 @@ fn bst_read_command(
                 &mut field_name_loc,
             )?;
         }
+        let history = ctx.history;
+        globals.bibs.finish_reading(ctx.engine, history);
         globals.bibs.pop_file().file.close(ctx)?;
     }
 
+    ctx.entries_skipped = globals.bibs.index_mut().skipped();
+
     ctx.reading_completed = true;
     globals.cites.set_num_cites(globals.cites.ptr());
 
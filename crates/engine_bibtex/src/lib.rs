@@ -47,6 +47,7 @@ use tectonic_bridge_core::{CoreBridgeLauncher, CoreBridgeState, FileFormat, Outp
 use tectonic_errors::prelude::*;
 
 pub(crate) mod auxi;
+pub(crate) mod bibindex;
 pub(crate) mod bibs;
 pub(crate) mod bst;
 pub(crate) mod buffer;
@@ -112,6 +113,7 @@ pub enum BibtexOutcome {
 #[derive(Debug, Default)]
 pub struct BibtexEngine {
     config: BibtexConfig,
+    statistics: Vec<(&'static str, u64)>,
 }
 
 impl BibtexEngine {
@@ -127,6 +129,14 @@ impl BibtexEngine {
         self
     }
 
+    /// Get statistics about the most recent run of the engine: the number of
+    /// uncited database entries that were skipped without being parsed, since
+    /// the layout of their database was already known. If the engine has not
+    /// been run, the list is empty.
+    pub fn statistics(&self) -> &[(&'static str, u64)] {
+        &self.statistics
+    }
+
     /// Run BibTeX.
     ///
     /// The *launcher* parameter gives overarching environmental context in
@@ -144,6 +154,7 @@ impl BibtexEngine {
         launcher.with_global_lock(|state| {
             let mut ctx = Bibtex::new(state, self.config.clone());
             let hist = bibtex_main(&mut ctx, &caux);
+            self.statistics = vec![("bib_entries_skipped", ctx.entries_skipped as u64)];
 
             match hist {
                 History::Spotless => Ok(BibtexOutcome::Spotless),
@@ -225,6 +236,7 @@ pub(crate) struct Bibtex<'a, 'cbs> {
     pub read_performed: bool,
     pub reading_completed: bool,
     pub all_entries: bool,
+    pub entries_skipped: usize,
 
     pub b_default: HashPointer<hash::BstFn>,
     pub s_null: StrNumber,
@@ -255,6 +267,7 @@ impl<'a, 'cbs> Bibtex<'a, 'cbs> {
             read_performed: false,
             reading_completed: false,
             all_entries: false,
+            entries_skipped: 0,
             b_default: HashPointer::default(),
             s_null: StrNumber::invalid(),
             s_default: StrNumber::invalid(),
@@ -569,11 +582,7 @@ pub(crate) fn inner_bibtex_main(
     let last_aux = loop {
         globals.aux.top_file_mut().line += 1;
 
-        if !input_ln(
-            ctx.engine,
-            &mut globals.aux.top_file_mut().file,
-            globals.buffers,
-        ) {
+        if !input_ln(&mut globals.aux.top_file_mut().file, globals.buffers) {
             if let Some(last) = pop_the_aux_stack(ctx, globals.aux) {
                 break last;
             }
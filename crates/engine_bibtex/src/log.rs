@@ -549,7 +549,7 @@ pub(crate) fn bst_err_print_and_look_for_blank_line(
     bst_ln_num_print(ctx, pool)?;
     print_bad_input_line(ctx, buffers);
     while buffers.init(BufTy::Base) != 0 {
-        if !input_ln(ctx.engine, &mut ctx.bst.as_mut().unwrap().file, buffers) {
+        if !input_ln(&mut ctx.bst.as_mut().unwrap().file, buffers) {
             return Err(BibtexError::Recover);
         } else {
             ctx.bst.as_mut().unwrap().line += 1;
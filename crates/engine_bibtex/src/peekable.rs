@@ -1,19 +1,21 @@
 use crate::{
     buffer::{BufTy, GlobalBuffer},
     char_info::LexClass,
-    ASCIICode, Bibtex, BibtexError, BufPointer,
+    Bibtex, BibtexError,
 };
-use libc::EOF;
-use std::{ffi::CStr, io};
-use tectonic_bridge_core::{CoreBridgeState, FileFormat, InputId};
+use std::{ffi::CStr, io::Read};
+use tectonic_bridge_core::{FileFormat, InputId};
 
-/* Sigh, I'm worried about ungetc() and EOF semantics in Bibtex's I/O, so
- * here's a tiny wrapper that lets us fake it. */
+/* BibTeX's inputs are small enough that we just slurp each one into memory
+ * when it's opened. Besides sidestepping the ungetc() and EOF semantics of
+ * the original, this lets the .bib reader seek around within a file (see
+ * `bibindex`). */
 
 pub(crate) struct PeekableInput {
     id: InputId,
-    peek_char: libc::c_int,
-    saw_eof: bool,
+    data: Vec<u8>,
+    pos: usize,
+    line_start: usize,
 }
 
 impl PeekableInput {
@@ -25,10 +27,16 @@ impl PeekableInput {
         let id = ctx.engine.input_open(path.to_str().unwrap(), format, false);
 
         if let Some(id) = id {
+            // A read error used to look like a premature EOF, and it still
+            // does: we keep whatever we managed to read.
+            let mut data = Vec::new();
+            let _ = ctx.engine.get_input(id).read_to_end(&mut data);
+
             Ok(PeekableInput {
                 id,
-                peek_char: EOF,
-                saw_eof: false,
+                data,
+                pos: 0,
+                line_start: 0,
             })
         } else {
             Err(BibtexError::Fatal)
@@ -43,91 +51,52 @@ impl PeekableInput {
         }
     }
 
-    fn getc(&mut self, engine: &mut CoreBridgeState<'_>) -> libc::c_int {
-        if self.peek_char != EOF {
-            let rv = self.peek_char;
-            self.peek_char = EOF;
-            return rv;
-        }
-
-        // SAFETY: Internal handle guaranteed valid, unique access to this input is unique access
-        //         to the handle
-        let handle = engine.get_input(self.id);
-        let rv = match handle.getc() {
-            Ok(c) => libc::c_int::from(c),
-            Err(e) => {
-                if let Some(e) = e.downcast_ref::<io::Error>() {
-                    if e.kind() == io::ErrorKind::UnexpectedEof {
-                        return EOF;
-                    }
-                }
-                -1
-            }
-        };
-        if rv == EOF {
-            self.saw_eof = true;
-        }
-        rv
+    /// The bridge handle of the file.
+    pub fn id(&self) -> InputId {
+        self.id
     }
 
-    fn ungetc(&mut self, c: libc::c_int) {
-        assert_ne!(c, EOF);
-        self.peek_char = c;
+    pub fn eof(&self) -> bool {
+        self.pos >= self.data.len()
     }
 
-    pub fn eof(&mut self, engine: &mut CoreBridgeState<'_>) -> bool {
-        if self.saw_eof {
-            return true;
-        }
-        let c = self.getc(engine);
-        if c == EOF {
-            return true;
-        }
-        self.ungetc(c);
-        false
+    /// The offset at which the line most recently read by `input_ln` starts.
+    pub fn line_start(&self) -> usize {
+        self.line_start
     }
 
-    fn eoln(&mut self, engine: &mut CoreBridgeState<'_>) -> bool {
-        if self.saw_eof {
-            return true;
-        }
-        let c = self.getc(engine);
-        if c != EOF {
-            self.ungetc(c);
-        }
-        c == b'\n' as libc::c_int || c == '\r' as libc::c_int || c == EOF
+    /// Move the read position, clamped to the end of the file.
+    pub fn seek(&mut self, pos: usize) {
+        self.pos = pos.min(self.data.len());
     }
 }
 
-pub(crate) fn input_ln(
-    engine: &mut CoreBridgeState<'_>,
-    peekable: &mut PeekableInput,
-    buffers: &mut GlobalBuffer,
-) -> bool {
+pub(crate) fn input_ln(peekable: &mut PeekableInput, buffers: &mut GlobalBuffer) -> bool {
     buffers.set_init(BufTy::Base, 0);
-    let mut last = 0;
-    if peekable.eof(engine) {
+    if peekable.eof() {
         return false;
     }
 
     // Read up to end-of-line
-    while !peekable.eoln(engine) {
-        if last >= buffers.len() as BufPointer {
-            buffers.grow_all();
-        }
-
-        buffers.set_at(BufTy::Base, last, peekable.getc(engine) as ASCIICode);
-        last += 1;
-    }
-
-    // For side effects - consume the eoln we saw
-    let eoln = peekable.getc(engine);
-    if eoln == '\r' as libc::c_int {
-        let next = peekable.getc(engine);
-        if next != '\n' as libc::c_int {
-            peekable.ungetc(next);
-        }
+    peekable.line_start = peekable.pos;
+    let rest = &peekable.data[peekable.pos..];
+    let mut last = rest
+        .iter()
+        .position(|&c| c == b'\n' || c == b'\r')
+        .unwrap_or(rest.len());
+
+    while buffers.len() < last {
+        buffers.grow_all();
     }
+    buffers.copy_from(BufTy::Base, 0, &rest[..last]);
+
+    // Consume the eoln we saw, treating CRLF as a single line ending
+    let eoln_len = match rest.get(last..last + 2) {
+        Some(b"\r\n") => 2,
+        _ if last < rest.len() => 1,
+        _ => 0,
+    };
+    peekable.pos += last + eoln_len;
 
     // Trim whitespace
     while last > 0 {
@@ -161,7 +161,7 @@ pub(crate) fn eat_bst_white_space(ctx: &mut Bibtex<'_, '_>, buffers: &mut Global
             return true;
         }
 
-        if !input_ln(ctx.engine, &mut ctx.bst.as_mut().unwrap().file, buffers) {
+        if !input_ln(&mut ctx.bst.as_mut().unwrap().file, buffers) {
             return false;
         }
 
@@ -495,7 +495,7 @@ fn scan_balanced_braces(
                 b'{' => {
                     brace_level += 1;
                     buffers.set_offset(BufTy::Base, 2, buffers.offset(BufTy::Base, 2) + 1);
-                    if !eat_bib_white_space(ctx, buffers, bibs) {
+                    if !eat_bib_white_space(buffers, bibs) {
                         return eat_bib_print(ctx, buffers, pool, bibs, bib_command).map(|_| false);
                     }
                     while brace_level > 0 {
@@ -512,7 +512,7 @@ fn scan_balanced_braces(
                         if (c == b'{'
                             || c == b'}'
                             || !Scan::new().chars(b"{}").scan_till(buffers, init))
-                            && !eat_bib_white_space(ctx, buffers, bibs)
+                            && !eat_bib_white_space(buffers, bibs)
                         {
                             return eat_bib_print(ctx, buffers, pool, bibs, bib_command)
                                 .map(|_| false);
@@ -529,7 +529,7 @@ fn scan_balanced_braces(
                     if !Scan::new()
                         .chars(&[right_str_delim, b'{', b'}'])
                         .scan_till(buffers, init)
-                        && !eat_bib_white_space(ctx, buffers, bibs)
+                        && !eat_bib_white_space(buffers, bibs)
                     {
                         return eat_bib_print(ctx, buffers, pool, bibs, bib_command).map(|_| false);
                     }
@@ -724,7 +724,7 @@ fn scan_a_field_token_and_eat_white(
         }
     }
 
-    if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+    if !eat_bib_white_space(globals.buffers, globals.bibs) {
         return eat_bib_print(ctx, globals.buffers, globals.pool, globals.bibs, command)
             .map(|_| false);
     }
@@ -759,7 +759,7 @@ pub(crate) fn scan_and_store_the_field_value_and_eat_white(
         globals
             .buffers
             .set_offset(BufTy::Base, 2, globals.buffers.offset(BufTy::Base, 2) + 1);
-        if !eat_bib_white_space(ctx, globals.buffers, globals.bibs) {
+        if !eat_bib_white_space(globals.buffers, globals.bibs) {
             return eat_bib_print(ctx, globals.buffers, globals.pool, globals.bibs, command)
                 .map(|_| false);
         }
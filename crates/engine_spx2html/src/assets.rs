@@ -7,8 +7,7 @@ use serde::Serialize;
 use std::{
     borrow::Cow,
     collections::{hash_map::Iter, HashMap},
-    fs::File,
-    io::{Read, Write},
+    io::Read,
     path::{Path, PathBuf},
 };
 use tectonic_errors::{anyhow::Context, prelude::*};
@@ -91,7 +90,7 @@ impl Assets {
 
     /// This functional must only be called if `common.out_path` is not None.
     pub(crate) fn emit(mut self, mut fonts: FontEnsemble, common: &mut Common) -> Result<()> {
-        let faces = fonts.emit(common.out_base)?;
+        let faces = fonts.emit(common.out_base, &common.outputs)?;
 
         for (dest_path, origin) in self.paths.drain() {
             match origin {
@@ -125,14 +124,14 @@ fn emit_copied_file(src_tex_path: &str, dest_path: &str, common: &mut Common) ->
         ["unable to open provideFile source `{}`", &src_tex_path]
     );
 
-    {
-        let (mut out_file, out_path) = create_asset_file(dest_path, common)?;
+    let mut data = Vec::new();
+    atry!(
+        ih.read_to_end(&mut data);
+        ["unable to read provideFile source `{}`", &src_tex_path]
+    );
 
-        atry!(
-            std::io::copy(&mut ih, &mut out_file);
-            ["cannot copy to output file `{}`", out_path.display()]
-        );
-    }
+    let out_path = create_output_path(dest_path, common)?.0.unwrap();
+    common.outputs.write(&out_path, &data)?;
 
     let (name, digest_opt) = ih.into_name_digest();
     common
@@ -143,26 +142,8 @@ fn emit_copied_file(src_tex_path: &str, dest_path: &str, common: &mut Common) ->
 
 /// This functional must only be called if `common.out_path` is not None.
 fn emit_font_css(dest_path: &str, faces: &str, common: &mut Common) -> Result<()> {
-    let (mut out_file, out_path) = create_asset_file(dest_path, common)?;
-
-    atry!(
-        write!(&mut out_file, "{faces}");
-        ["cannot write output file `{}`", out_path.display()]
-    );
-
-    Ok(())
-}
-
-/// This functional must only be called if `common.out_path` is not None.
-fn create_asset_file(dest_path: &str, common: &mut Common) -> Result<(File, PathBuf)> {
     let out_path = create_output_path(dest_path, common)?.0.unwrap();
-
-    let out_file = atry!(
-        File::create(&out_path);
-        ["cannot open output file `{}`", out_path.display()]
-    );
-
-    Ok((out_file, out_path))
+    common.outputs.write(&out_path, faces.as_bytes())
 }
 
 /// Process a TeX output path into one for the actual filesystem.
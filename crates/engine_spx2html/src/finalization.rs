@@ -90,7 +90,8 @@ impl FinalizingState {
         Ok(())
     }
 
-    pub(crate) fn finished(self) -> (FontEnsemble, Assets) {
-        (self.fonts, self.assets)
+    pub(crate) fn finished(self) -> Result<(FontEnsemble, Assets)> {
+        self.templating.finish()?;
+        Ok((self.fonts, self.assets))
     }
 }
@@ -21,7 +21,7 @@ use pinot::{
 use std::{collections::HashMap, num::Wrapping, path::Path};
 use tectonic_errors::prelude::*;
 
-use crate::FixedPoint;
+use crate::{outputs::OutputFiles, FixedPoint};
 
 /// A numerical identifier of a glyph in a font.
 pub type GlyphId = u16;
@@ -412,12 +412,13 @@ impl FontFileData {
     /// constructed. This wouldn't be too hard to change.
     ///
     /// `out_base` is the output directory, or None if we shouldn't be writing
-    /// anything to disk.
+    /// anything to disk. Files are written through `outputs`.
     ///
     /// Return value is a vec of (variant-map-index, CSS-src-field).
     pub fn emit(
         self,
         out_base: Option<&Path>,
+        outputs: &OutputFiles,
         rel_path: &str,
     ) -> Result<Vec<(Option<usize>, String)>> {
         // Write the main font file ... maybe.
@@ -426,11 +427,7 @@ impl FontFileData {
 
         if let Some(out_path) = out_path.as_mut() {
             out_path.push(rel_path);
-            let display_path = out_path.clone();
-            atry!(
-                std::fs::write(out_path, &self.buffer);
-                ["cannot write output file `{}`", display_path.display()]
-            );
+            outputs.write(out_path, &self.buffer)?;
         }
 
         // CSS info for the main font.
@@ -491,11 +488,7 @@ impl FontFileData {
 
                 out_path.pop();
                 out_path.push(&varname);
-                let display_path = out_path.clone();
-                atry!(
-                    std::fs::write(out_path, &buffer);
-                    ["cannot write output file `{}`", display_path.display()]
-                );
+                outputs.write(out_path, &buffer)?;
             }
 
             // step 5: update CSS
@@ -14,6 +14,7 @@ use tectonic_status_base::{tt_warning, StatusBackend};
 use crate::{
     assets::syntax,
     fontfile::{FontFileData, GlyphId, GlyphMetrics, MapEntry},
+    outputs::OutputFiles,
     Common, FixedPoint, TexFontNum,
 };
 
@@ -385,14 +386,48 @@ impl FontEnsemble {
     ///
     /// This function clears this object's internal data structures, making it
     /// effectively unusable for subsequent operations.
-    pub fn emit(&mut self, out_base: Option<&Path>) -> Result<String> {
-        let mut faces = String::default();
-
-        for font in self.font_files.drain(..) {
-            font.emit(out_base, &mut faces)?;
+    ///
+    /// Fonts are emitted in parallel, since building the variant files for
+    /// large fonts takes a while, but the CSS is assembled in the usual
+    /// order.
+    pub fn emit(&mut self, out_base: Option<&Path>, outputs: &OutputFiles) -> Result<String> {
+        let mut fonts: Vec<Font> = self.font_files.drain(..).collect();
+        let n_threads = std::thread::available_parallelism().map_or(1, |n| n.get());
+        let chunk_size = fonts.len().div_ceil(n_threads).max(1);
+        let mut chunks = Vec::new();
+
+        while !fonts.is_empty() {
+            let rest = fonts.split_off(chunk_size.min(fonts.len()));
+            chunks.push(std::mem::replace(&mut fonts, rest));
         }
 
-        Ok(faces)
+        std::thread::scope(|scope| {
+            let handles: Vec<_> = chunks
+                .into_iter()
+                .map(|chunk| {
+                    scope.spawn(move || -> Result<String> {
+                        let mut faces = String::default();
+
+                        for font in chunk {
+                            font.emit(out_base, outputs, &mut faces)?;
+                        }
+
+                        Ok(faces)
+                    })
+                })
+                .collect();
+
+            let mut faces = String::default();
+
+            for h in handles {
+                match h.join() {
+                    Ok(chunk_faces) => faces.push_str(&chunk_faces?),
+                    Err(e) => std::panic::resume_unwind(e),
+                }
+            }
+
+            Ok(faces)
+        })
     }
 
     pub(crate) fn into_serialize(mut self) -> (syntax::Assets, syntax::FontEnsembleAssetData) {
@@ -749,8 +784,13 @@ impl Font {
         }
     }
 
-    fn emit<W: Write>(self, out_base: Option<&Path>, mut dest: W) -> Result<()> {
-        for (var_index, css_src) in self.details.emit(out_base, &self.out_rel_path)? {
+    fn emit<W: Write>(
+        self,
+        out_base: Option<&Path>,
+        outputs: &OutputFiles,
+        mut dest: W,
+    ) -> Result<()> {
+        for (var_index, css_src) in self.details.emit(out_base, outputs, &self.out_rel_path)? {
             // This is almost identical to `selection_style_text`. A major
             // factor is that we're consuming `self`, with `self.details`
             // already consumed by the `emit()` call, so we can't borrow &self.
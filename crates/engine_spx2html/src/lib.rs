@@ -6,7 +6,10 @@
 //! SPX is essentially the same thing as XDV, but we identify it differently to
 //! mark that the semantics of the content wil be set up for HTML output.
 
-use std::path::{Path, PathBuf};
+use std::{
+    path::{Path, PathBuf},
+    sync::Arc,
+};
 use tectonic_bridge_core::DriverHooks;
 use tectonic_errors::prelude::*;
 use tectonic_status_base::StatusBackend;
@@ -19,12 +22,13 @@ mod fontfile;
 mod fonts;
 mod html;
 mod initialization;
+mod outputs;
 mod specials;
 mod templating;
 
 use self::{
     assets::Assets, emission::EmittingState, finalization::FinalizingState, fonts::FontEnsemble,
-    initialization::InitializationState, specials::Special,
+    initialization::InitializationState, outputs::OutputFiles, specials::Special,
 };
 
 /// An engine that converts SPX to HTML.
@@ -34,6 +38,8 @@ pub struct Spx2HtmlEngine {
     precomputed_assets: Option<AssetSpecification>,
     assets_spec_path: Option<String>,
     do_not_emit_assets: bool,
+    skip_unchanged_files: bool,
+    changed_files: Vec<PathBuf>,
 }
 
 #[derive(Debug, Default)]
@@ -111,6 +117,28 @@ impl Spx2HtmlEngine {
         self
     }
 
+    /// Specify that output files should only be written if their contents
+    /// have changed.
+    ///
+    /// In this mode, each generated file is compared with the one already at
+    /// its output path, if any, and is left untouched if they're identical.
+    /// This preserves the modification times of unchanged files, which helps
+    /// tools like static-site caches and `rsync`. Either way,
+    /// [`Self::changed_files`] reports which files were actually written.
+    pub fn skip_unchanged_files(&mut self) -> &mut Self {
+        self.skip_unchanged_files = true;
+        self
+    }
+
+    /// Get the files that were written during the last call to
+    /// [`Self::process_to_filesystem`], relative to the output root.
+    ///
+    /// If [`Self::skip_unchanged_files`] has been called, files whose contents
+    /// were already up-to-date are not included. The paths are sorted.
+    pub fn changed_files(&self) -> &[PathBuf] {
+        &self.changed_files[..]
+    }
+
     /// Specify the root path for output files.
     ///
     /// Because this driver will, in the generic case, produce a tree of HTML
@@ -142,8 +170,16 @@ impl Spx2HtmlEngine {
             OutputState::Undefined => panic!("spx2html output mode not specified"),
         };
 
+        let outputs = Arc::new(OutputFiles::new(self.skip_unchanged_files));
+
         {
-            let state = EngineState::new(hooks, status, out_base, self.precomputed_assets.as_ref());
+            let state = EngineState::new(
+                hooks,
+                status,
+                out_base,
+                outputs.clone(),
+                self.precomputed_assets.as_ref(),
+            );
             let state = XdvParser::process_with_seeks(&mut input, state)?;
             let (fonts, assets, mut common) = state.finished()?;
 
@@ -158,6 +194,15 @@ impl Spx2HtmlEngine {
             }
         }
 
+        self.changed_files = outputs
+            .take_changed()
+            .into_iter()
+            .map(|p| match out_base.and_then(|b| p.strip_prefix(b).ok()) {
+                Some(rel) => rel.to_owned(),
+                None => p,
+            })
+            .collect();
+
         let (name, digest_opt) = input.into_name_digest();
         hooks.event_input_closed(name, digest_opt, status);
         Ok(())
@@ -175,6 +220,7 @@ struct Common<'a> {
     hooks: &'a mut dyn DriverHooks,
     status: &'a mut dyn StatusBackend,
     out_base: Option<&'a Path>,
+    outputs: Arc<OutputFiles>,
     precomputed_assets: Option<&'a AssetSpecification>,
 }
 
@@ -183,6 +229,7 @@ impl<'a> EngineState<'a> {
         hooks: &'a mut dyn DriverHooks,
         status: &'a mut dyn StatusBackend,
         out_base: Option<&'a Path>,
+        outputs: Arc<OutputFiles>,
         precomputed_assets: Option<&'a AssetSpecification>,
     ) -> Self {
         Self {
@@ -190,6 +237,7 @@ impl<'a> EngineState<'a> {
                 hooks,
                 status,
                 out_base,
+                outputs,
                 precomputed_assets,
             },
             state: State::Initializing(InitializationState::default()),
@@ -212,7 +260,7 @@ impl<'a> EngineState<'a> {
         self.state.ensure_finalizing(&mut self.common)?;
 
         if let State::Finalizing(s) = self.state {
-            let (fonts, mut assets) = s.finished();
+            let (fonts, mut assets) = s.finished()?;
 
             // If we have precomputed assets, make sure that this run didn't
             // define anything surprising, and sync up the runtime manifest with
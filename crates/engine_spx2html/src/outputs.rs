@@ -0,0 +1,125 @@
+// Copyright 2026 the Tectonic Project
+// Licensed under the MIT License.
+
+//! Writing output files to disk.
+//!
+//! Every HTML build regenerates all of its output files, but usually only a
+//! few of them actually change from one build to the next. In incremental mode,
+//! we compare each generated file with what is already on disk and leave it
+//! alone if it's the same, so that its modification time is preserved. Either
+//! way, we keep track of which files were written, so that callers can find
+//! out what changed.
+
+use std::{
+    fs::File,
+    io::Read,
+    path::{Path, PathBuf},
+    sync::Mutex,
+};
+use tectonic_errors::prelude::*;
+
+/// Writes output files and keeps track of which ones were changed. This is
+/// shared between the threads that write the outputs.
+#[derive(Debug, Default)]
+pub(crate) struct OutputFiles {
+    incremental: bool,
+    changed: Mutex<Vec<PathBuf>>,
+}
+
+impl OutputFiles {
+    pub(crate) fn new(incremental: bool) -> Self {
+        OutputFiles {
+            incremental,
+            changed: Mutex::new(Vec::new()),
+        }
+    }
+
+    /// Write `data` to the file `path`. In incremental mode, this does nothing
+    /// if the file already has exactly this content.
+    pub(crate) fn write(&self, path: &Path, data: &[u8]) -> Result<()> {
+        if self.incremental && file_has_contents(path, data) {
+            return Ok(());
+        }
+
+        atry!(
+            std::fs::write(path, data);
+            ["cannot write output file `{}`", path.display()]
+        );
+
+        self.changed.lock().unwrap().push(path.to_owned());
+        Ok(())
+    }
+
+    /// Get the paths of all of the files that have been written, sorted and
+    /// without duplicates.
+    pub(crate) fn take_changed(&self) -> Vec<PathBuf> {
+        let mut changed = std::mem::take(&mut *self.changed.lock().unwrap());
+        changed.sort_unstable();
+        changed.dedup();
+        changed
+    }
+}
+
+/// Check whether the file at `path` exists and contains exactly `data`. Any
+/// error is treated as a difference, since we'll then just rewrite the file.
+fn file_has_contents(path: &Path, data: &[u8]) -> bool {
+    let Ok(mut f) = File::open(path) else {
+        return false;
+    };
+
+    match f.metadata() {
+        Ok(m) if m.is_file() && m.len() == data.len() as u64 => {}
+        _ => return false,
+    }
+
+    let mut buf = vec![0u8; data.len().clamp(1, 65536)];
+    let mut rest = data;
+
+    loop {
+        let n = match f.read(&mut buf[..]) {
+            Ok(n) => n,
+            Err(_) => return false,
+        };
+
+        if n == 0 {
+            return rest.is_empty();
+        }
+
+        if n > rest.len() || buf[..n] != rest[..n] {
+            return false;
+        }
+
+        rest = &rest[n..];
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn incremental() {
+        let dir = tempfile::tempdir().unwrap();
+        let a = dir.path().join("a.html");
+        let b = dir.path().join("b.css");
+
+        let outputs = OutputFiles::new(true);
+        outputs.write(&a, b"hello").unwrap();
+        outputs.write(&b, b"").unwrap();
+        assert_eq!(outputs.take_changed(), vec![a.clone(), b.clone()]);
+
+        outputs.write(&a, b"hello").unwrap();
+        outputs.write(&b, b"").unwrap();
+        assert!(outputs.take_changed().is_empty());
+
+        outputs.write(&a, b"jello").unwrap();
+        outputs.write(&b, b"x").unwrap();
+        assert_eq!(outputs.take_changed(), vec![a.clone(), b]);
+        assert_eq!(std::fs::read(&a).unwrap(), b"jello");
+
+        // Not in incremental mode, everything gets written.
+        let outputs = OutputFiles::new(false);
+        outputs.write(&a, b"jello").unwrap();
+        assert_eq!(outputs.take_changed(), vec![a]);
+    }
+}
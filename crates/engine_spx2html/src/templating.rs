@@ -2,15 +2,23 @@
 // Licensed under the MIT License.
 
 //! State relating to handling the Tera templating and file emission.
+//!
+//! Reading templates goes through the driver's I/O hooks, so it happens as the
+//! SPX file is processed; but rendering the templates and writing the results
+//! to disk are handed off to a pool of worker threads, since large documents
+//! can produce hundreds of output pages.
 
 use std::{
-    fs::File,
-    io::{Read, Write},
+    collections::HashSet,
+    io::Read,
+    path::PathBuf,
+    sync::{mpsc, Arc, Mutex},
+    thread,
 };
 use tectonic_errors::prelude::*;
 use tectonic_status_base::tt_warning;
 
-use crate::Common;
+use crate::{outputs::OutputFiles, Common};
 
 #[derive(Debug)]
 pub(crate) struct Templating {
@@ -18,6 +26,7 @@ pub(crate) struct Templating {
     context: tera::Context,
     next_template_path: String,
     next_output_path: String,
+    renderers: Option<RenderPool>,
 }
 
 impl Templating {
@@ -32,6 +41,7 @@ impl Templating {
             context,
             next_template_path,
             next_output_path,
+            renderers: None,
         }
     }
 
@@ -116,32 +126,196 @@ impl Templating {
             .hooks
             .event_input_closed(name, digest_opt, common.status);
 
-        // Ready to render!
+        // Ready to render! The pool clones our Tera instance for each worker,
+        // so it must be set up after all templates have been added.
 
+        let job = RenderJob {
+            index: 0,
+            template,
+            context: self.context.clone(),
+            template_path: self.next_template_path.clone(),
+            output_path: self.next_output_path.clone(),
+            out_path,
+        };
+
+        let tera = &self.tera;
+        self.renderers
+            .get_or_insert_with(|| RenderPool::new(tera, &common.outputs))
+            .submit(job);
+
+        // Clear the output path, because we don't want people to be accidentally
+        // overwriting the same file by failing to update it.
+
+        self.next_output_path.clear();
+
+        Ok(())
+    }
+
+    /// Wait for all of the emitted files to be rendered and written, and
+    /// report the first error, if any, in emission order.
+    pub(crate) fn finish(self) -> Result<()> {
+        match self.renderers {
+            Some(pool) => pool.finish(),
+            None => Ok(()),
+        }
+    }
+}
+
+/// A page that has been queued for rendering and writing.
+#[derive(Debug)]
+struct RenderJob {
+    index: usize,
+    template: String,
+    context: tera::Context,
+    template_path: String,
+    output_path: String,
+    out_path: Option<PathBuf>,
+}
+
+impl RenderJob {
+    fn run(self, tera: &mut tera::Tera, outputs: &OutputFiles) -> Result<()> {
         let rendered = atry!(
-            self.tera.render_str(&template, &self.context);
-            ["failed to render HTML template `{}` while creating `{}`", &self.next_template_path, &self.next_output_path]
+            tera.render_str(&self.template, &self.context);
+            ["failed to render HTML template `{}` while creating `{}`", &self.template_path, &self.output_path]
         );
 
         // Save it. Unless we shouldn't, actually.
 
-        if let Some(out_path) = out_path {
-            let mut out_file = atry!(
-                File::create(&out_path);
-                ["cannot open output file `{}`", out_path.display()]
-            );
+        if let Some(out_path) = self.out_path {
+            outputs.write(&out_path, rendered.as_bytes())?;
+        }
 
-            atry!(
-                out_file.write_all(rendered.as_bytes());
-                ["cannot write output file `{}`", out_path.display()]
-            );
+        Ok(())
+    }
+}
+
+/// A pool of threads that render pages and write them to disk.
+///
+/// Each worker has its own copy of the Tera instance, since rendering a
+/// one-off template needs mutable access to it. Pages are independent of each
+/// other, so the output is the same as if they had been rendered in order,
+/// except when the same path is written twice: then we wait for everything
+/// in flight to finish first, so that the last version wins.
+#[derive(Debug)]
+struct RenderPool {
+    jobs: Option<mpsc::SyncSender<RenderJob>>,
+    results: mpsc::Receiver<(usize, Result<()>)>,
+    workers: Vec<thread::JoinHandle<()>>,
+    n_submitted: usize,
+    n_finished: usize,
+    first_error: Option<(usize, Error)>,
+
+    /// Output paths of the jobs that might still be in flight.
+    pending_paths: HashSet<PathBuf>,
+}
+
+impl RenderPool {
+    fn new(tera: &tera::Tera, outputs: &Arc<OutputFiles>) -> Self {
+        let n_workers = thread::available_parallelism().map_or(1, |n| n.get());
+
+        // Don't let the queue grow without bound, since each job holds the
+        // full content of a page.
+        let (jobs, job_rx) = mpsc::sync_channel::<RenderJob>(2 * n_workers);
+        let job_rx = Arc::new(Mutex::new(job_rx));
+        let (result_tx, results) = mpsc::channel();
+
+        let workers = (0..n_workers)
+            .map(|_| {
+                let mut tera = tera.clone();
+                let job_rx = job_rx.clone();
+                let result_tx = result_tx.clone();
+                let outputs = outputs.clone();
+
+                thread::spawn(move || loop {
+                    let job = match job_rx.lock().unwrap().recv() {
+                        Ok(j) => j,
+                        Err(_) => return,
+                    };
+
+                    let index = job.index;
+                    let result = job.run(&mut tera, &outputs);
+
+                    if result_tx.send((index, result)).is_err() {
+                        return;
+                    }
+                })
+            })
+            .collect();
+
+        RenderPool {
+            jobs: Some(jobs),
+            results,
+            workers,
+            n_submitted: 0,
+            n_finished: 0,
+            first_error: None,
+            pending_paths: HashSet::new(),
         }
+    }
 
-        // Clear the output path, because we don't want people to be accidentally
-        // overwriting the same file by failing to update it.
+    fn submit(&mut self, mut job: RenderJob) {
+        if let Some(p) = job.out_path.as_ref() {
+            if !self.pending_paths.insert(p.clone()) {
+                self.wait();
+                self.pending_paths.clear();
+                self.pending_paths.insert(p.clone());
+            }
+        }
 
-        self.next_output_path.clear();
+        job.index = self.n_submitted;
+        self.n_submitted += 1;
+
+        // If this fails, the workers have died, which `finish()` will notice.
+        let _ = self.jobs.as_ref().unwrap().send(job);
+    }
+
+    /// Wait for all submitted jobs to finish.
+    fn wait(&mut self) {
+        while self.n_finished < self.n_submitted {
+            let Ok((index, result)) = self.results.recv() else {
+                return;
+            };
+
+            self.n_finished += 1;
+
+            if let Err(e) = result {
+                if self.first_error.as_ref().is_none_or(|(i, _)| index < *i) {
+                    self.first_error = Some((index, e));
+                }
+            }
+        }
+    }
+
+    fn finish(mut self) -> Result<()> {
+        self.wait();
+        self.jobs = None;
+
+        for w in self.workers.drain(..) {
+            if let Err(e) = w.join() {
+                std::panic::resume_unwind(e);
+            }
+        }
+
+        if let Some((_, e)) = self.first_error.take() {
+            return Err(e);
+        }
+
+        if self.n_finished < self.n_submitted {
+            bail!("HTML rendering workers exited before finishing their work");
+        }
 
         Ok(())
     }
 }
+
+impl Drop for RenderPool {
+    fn drop(&mut self) {
+        // If we're bailing out early, let the workers finish what they're
+        // doing, so that they don't keep writing files after we've returned.
+        self.jobs = None;
+
+        for w in self.workers.drain(..) {
+            let _ = w.join();
+        }
+    }
+}
@@ -38,16 +38,31 @@ pub struct XdvipdfmxEngine {
     paper_spec: String,
     enable_compression: bool,
     deterministic_tags: bool,
+    flush_pages: bool,
     build_date: SystemTime,
+    statistics: Vec<(&'static str, u64)>,
 }
 
+/// The statistics reported by [`XdvipdfmxEngine::statistics()`].
+const STATISTICS: &[&str] = &[
+    "pdf_objects",
+    "pdf_bytes_written",
+    "pdf_streams_compressed",
+    "pdf_bytes_before_compression",
+    "pdf_bytes_after_compression",
+    "pdf_imports_shared",
+    "pdf_import_bytes_saved",
+];
+
 impl Default for XdvipdfmxEngine {
     fn default() -> Self {
         XdvipdfmxEngine {
             paper_spec: "letter".to_owned(),
             enable_compression: true,
             deterministic_tags: false,
+            flush_pages: false,
             build_date: SystemTime::UNIX_EPOCH,
+            statistics: Vec::new(),
         }
     }
 }
@@ -75,6 +90,20 @@ impl XdvipdfmxEngine {
         self
     }
 
+    /// Set whether pages are written out as soon as they are finished.
+    ///
+    /// The default is false, in which case the engine keeps every page
+    /// dictionary in memory until the end of the document, so that memory
+    /// use grows with the page count. If this is set to true, each page is
+    /// flushed to the output as soon as it is complete, keeping memory use
+    /// roughly constant for very long documents. The page tree is shaped a
+    /// bit differently, and annotations targeting an already written page
+    /// are dropped with a warning.
+    pub fn enable_page_flushing(&mut self, flush_pages: bool) -> &mut Self {
+        self.flush_pages = flush_pages;
+        self
+    }
+
     /// Sets the build date embedded in the output artifacts
     ///
     /// The default value is the Unix epoch, which is almost certainly not what
@@ -93,6 +122,18 @@ impl XdvipdfmxEngine {
         self
     }
 
+    /// Get statistics about the output of the most recent call to
+    /// [`process()`](Self::process), as `(name, value)` pairs.
+    ///
+    /// These cover the number of indirect objects and bytes in the PDF file,
+    /// how much stream data went into and came out of the compressor, and how
+    /// many objects imported from included PDFs were dropped in favor of
+    /// identical ones, saving how many bytes. If the engine has not been run,
+    /// the list is empty.
+    pub fn statistics(&self) -> &[(&'static str, u64)] {
+        &self.statistics
+    }
+
     /// Run xdvipdfmx.
     ///
     /// The *launcher* parameter gives overarching environmental context in
@@ -118,6 +159,7 @@ impl XdvipdfmxEngine {
             paperspec: paperspec_str.as_c_str().as_ptr(),
             enable_compression: u8::from(self.enable_compression),
             deterministic_tags: u8::from(self.deterministic_tags),
+            flush_pages: u8::from(self.flush_pages),
             build_date: self
                 .build_date
                 .duration_since(SystemTime::UNIX_EPOCH)
@@ -135,6 +177,19 @@ impl XdvipdfmxEngine {
                 c_api::tt_engine_xdvipdfmx_main(state, &config, cdvi.as_ptr(), cpdf.as_ptr())
             };
 
+            self.statistics.clear();
+
+            for name in STATISTICS {
+                let cname = CString::new(*name).unwrap();
+                let mut value = 0;
+
+                // SAFETY: This is called while the global lock is held, with a
+                //         valid C-string.
+                if unsafe { c_api::tt_xdvipdfmx_get_stat(cname.as_ptr(), &mut value) } == 0 {
+                    self.statistics.push((*name, value));
+                }
+            }
+
             // At the moment, the only possible return codes are 0 and 99 (= abort).
             if r == 99 {
                 Err(EngineAbortedError::new_abort_indicator().into())
@@ -157,6 +212,7 @@ pub mod c_api {
         pub paperspec: *const libc::c_char,
         pub enable_compression: libc::c_uchar,
         pub deterministic_tags: libc::c_uchar,
+        pub flush_pages: libc::c_uchar,
         pub build_date: u64,
     }
 
@@ -168,6 +224,11 @@ pub mod c_api {
             dviname: *const libc::c_char,
             pdfname: *const libc::c_char,
         ) -> libc::c_int;
+
+        pub fn tt_xdvipdfmx_get_stat(
+            stat_name: *const libc::c_char,
+            value: *mut u64,
+        ) -> libc::c_int;
     }
 }
 
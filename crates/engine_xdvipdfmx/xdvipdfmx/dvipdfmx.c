@@ -328,6 +328,7 @@ dvipdfmx_main (
   bool translate,
   bool compress,
   bool deterministic_tags,
+  bool flush_pages,
   bool quiet,
   unsigned int verbose,
   time_t build_date,
@@ -462,6 +463,7 @@ dvipdfmx_main (
   settings.outline_open_depth = bookmark_open;
   settings.check_gotos        = !(opt_flags & OPT_PDFDOC_NO_DEST_REMOVE);
   settings.enable_manual_thumb = enable_thumbnail;
+  settings.enable_page_flush  = flush_pages;
 
   settings.device.dvi2pts     = dvi2pts;
   settings.device.precision   = pdfdecimaldigits;
@@ -519,6 +521,7 @@ tt_engine_xdvipdfmx_main(
     false, /* translate */
     (bool) config->enable_compression,
     (bool) config->deterministic_tags,
+    (bool) config->flush_pages,
     false, /* quiet */
     0, /* verbose */
     (time_t) config->build_date,
@@ -528,3 +531,31 @@ tt_engine_xdvipdfmx_main(
   ttbc_global_engine_exit();
   return rv;
 }
+
+/* Retrieve statistics about the PDF written by the most recent run. */
+int
+tt_xdvipdfmx_get_stat(const char *stat_name, uint64_t *value)
+{
+  pdf_output_stats stats;
+
+  pdf_get_output_stats(&stats);
+
+  if (streq_ptr(stat_name, "pdf_objects"))
+    *value = stats.objects;
+  else if (streq_ptr(stat_name, "pdf_bytes_written"))
+    *value = stats.bytes_written;
+  else if (streq_ptr(stat_name, "pdf_streams_compressed"))
+    *value = stats.streams_compressed;
+  else if (streq_ptr(stat_name, "pdf_bytes_before_compression"))
+    *value = stats.bytes_before_compression;
+  else if (streq_ptr(stat_name, "pdf_bytes_after_compression"))
+    *value = stats.bytes_after_compression;
+  else if (streq_ptr(stat_name, "pdf_imports_shared"))
+    *value = stats.imports_shared;
+  else if (streq_ptr(stat_name, "pdf_import_bytes_saved"))
+    *value = stats.import_bytes_saved;
+  else
+    return 1; /* unrecognized statistic */
+
+  return 0;
+}
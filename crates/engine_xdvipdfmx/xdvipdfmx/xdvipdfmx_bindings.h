@@ -10,6 +10,7 @@ typedef struct {
   const char *paperspec;
   unsigned char enable_compression;
   unsigned char deterministic_tags;
+  unsigned char flush_pages;
   uint64_t build_date;
 } XdvipdfmxConfig;
 
@@ -22,6 +23,8 @@ extern int tt_engine_xdvipdfmx_main(ttbc_state_t *api,
                                     const char *dviname,
                                     const char *pdfname);
 
+extern int tt_xdvipdfmx_get_stat(const char *stat_name, uint64_t *value);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
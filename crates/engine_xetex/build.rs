@@ -206,6 +206,7 @@ const C_FILES: &[&str] = &[
     "xetex/xetex-output.c",
     "xetex/xetex-pagebuilder.c",
     "xetex/xetex-pic.c",
+    "xetex/xetex-profile.c",
     "xetex/xetex-scaledmath.c",
     "xetex/xetex-shipout.c",
     "xetex/xetex-stringpool.c",
@@ -79,21 +79,47 @@ pub struct TexEngine {
     // though, it's just a proxy for the global constants in the C code.
     halt_on_error: bool,
     initex_mode: bool,
+    preload_format: bool,
     synctex_enabled: bool,
     semantic_pagination_enabled: bool,
     shell_escape_enabled: bool,
+    macro_profile_enabled: bool,
+    hash_extra: u32,
     build_date: SystemTime,
+    statistics: Vec<(&'static str, u64)>,
 }
 
+/// The statistics reported by [`TexEngine::statistics()`].
+const STATISTICS: &[&str] = &[
+    "mem_top",
+    "mem_lo_max",
+    "mem_hi_min",
+    "mem_end",
+    "hash_entries",
+    "hash_entries_used",
+    "strings",
+    "strings_used",
+    "string_chars",
+    "string_chars_used",
+    "fonts_loaded",
+    "shaping_calls",
+    "hyph_cache_hits",
+    "hyph_cache_misses",
+];
+
 impl Default for TexEngine {
     fn default() -> Self {
         TexEngine {
             halt_on_error: true,
             initex_mode: false,
+            preload_format: false,
             synctex_enabled: false,
             semantic_pagination_enabled: false,
             shell_escape_enabled: false,
+            macro_profile_enabled: false,
+            hash_extra: 600_000,
             build_date: SystemTime::UNIX_EPOCH,
+            statistics: Vec::new(),
         }
     }
 }
@@ -117,6 +143,19 @@ impl TexEngine {
         self
     }
 
+    /// Configure "initex" mode to start from an existing format file.
+    ///
+    /// Normally, initex mode starts from a blank engine state. If this option
+    /// is enabled, the engine will first load the format file passed to
+    /// [`process()`](Self::process), so that the input can extend that format
+    /// and `\dump` the result as a new one. This is how document-specific
+    /// preamble formats are created. The setting has no effect outside of
+    /// initex mode. The default is false.
+    pub fn preload_format(&mut self, preload: bool) -> &mut Self {
+        self.preload_format = preload;
+        self
+    }
+
     /// Configure the engine to produce SyncTeX data.
     ///
     /// The default is false.
@@ -148,6 +187,34 @@ impl TexEngine {
         self
     }
 
+    /// Configure the engine to profile macro expansion.
+    ///
+    /// If enabled, the engine records how much time is spent expanding each
+    /// macro, broken down by the chain of macros and input files it was called
+    /// from. At the end of the run it writes out `<jobname>.macros.folded`,
+    /// with one line per call chain in the "folded stacks" format used by
+    /// flame graph tools, and `<jobname>.macros.tsv`, with call counts and
+    /// inclusive and exclusive times per macro, input file, and line. All
+    /// times are in microseconds.
+    ///
+    /// The default is false.
+    pub fn macro_profile(&mut self, enabled: bool) -> &mut Self {
+        self.macro_profile_enabled = enabled;
+        self
+    }
+
+    /// Configure the number of control sequences that can be defined beyond
+    /// the engine's built-in hash table.
+    ///
+    /// Once these extra entries are used up, new control sequences share the
+    /// slots of the built-in table, until it is full. A format file records
+    /// how many extra entries it uses, and loading it raises the setting to at
+    /// least that number. The default is 600,000.
+    pub fn hash_extra(&mut self, size: u32) -> &mut Self {
+        self.hash_extra = size;
+        self
+    }
+
     /// Sets the date and time used by the TeX engine. This affects things like
     /// LaTeX's \today command.
     ///
@@ -159,6 +226,19 @@ impl TexEngine {
         self
     }
 
+    /// Get statistics about the most recent call to
+    /// [`process()`](Self::process), as `(name, value)` pairs.
+    ///
+    /// These cover the high-water marks of the engine's main memory
+    /// (`mem_lo_max` grows up from the bottom of `mem` and `mem_hi_min` down
+    /// from `mem_end`), how full the control-sequence hash table and string
+    /// pool got relative to their capacities, the number of fonts loaded, the
+    /// number of calls to the text shaper, and the hit rate of the
+    /// hyphenation cache. If the engine has not been run, the list is empty.
+    pub fn statistics(&self) -> &[(&'static str, u64)] {
+        &self.statistics
+    }
+
     /// Process a document using the current engine configuration.
     ///
     /// The *launcher* parameter gives overarching environmental context in
@@ -168,7 +248,8 @@ impl TexEngine {
     /// preloaded engine state. It must be findable in the I/O stack, using the
     /// special hooks that are provided for handing format files, which allow
     /// updates to the file format to be handed (see [`FORMAT_SERIAL`]). If in
-    /// "initex" mode, this parameter will be ignored.
+    /// "initex" mode, this parameter will be ignored, unless
+    /// [`preload_format()`](Self::preload_format) has been enabled.
     ///
     /// The *input_file_name* is used to name the "primary input file". The I/O
     /// system has special hooks for opening this primary input, so be aware
@@ -198,11 +279,23 @@ impl TexEngine {
                 );
                 tt_xetex_set_int_variable(c"halt_on_error_p".as_ptr(), self.halt_on_error.into());
                 tt_xetex_set_int_variable(c"in_initex_mode".as_ptr(), self.initex_mode.into());
+                tt_xetex_set_int_variable(
+                    c"initex_preload_format".as_ptr(),
+                    self.preload_format.into(),
+                );
                 tt_xetex_set_int_variable(c"synctex_enabled".as_ptr(), self.synctex_enabled.into());
                 tt_xetex_set_int_variable(
                     c"semantic_pagination_enabled".as_ptr(),
                     self.semantic_pagination_enabled.into(),
                 );
+                tt_xetex_set_int_variable(
+                    c"macro_profile_enabled".as_ptr(),
+                    self.macro_profile_enabled.into(),
+                );
+                tt_xetex_set_int_variable(
+                    c"hash_extra".as_ptr(),
+                    self.hash_extra.try_into().unwrap_or(libc::c_int::MAX),
+                );
 
                 tt_engine_xetex_main(
                     state,
@@ -215,6 +308,18 @@ impl TexEngine {
                 )
             };
 
+            self.statistics.clear();
+
+            for name in STATISTICS {
+                let cname = CString::new(*name).unwrap();
+                let mut value = 0;
+
+                // SAFETY: This is called with a valid C-string while the global lock is held.
+                if unsafe { c_api::tt_xetex_get_stat(cname.as_ptr(), &mut value) } == 0 {
+                    self.statistics.push((*name, value));
+                }
+            }
+
             match r {
                 0 => Ok(TexOutcome::Spotless),
                 1 => Ok(TexOutcome::Warnings),
@@ -239,6 +344,8 @@ pub mod c_api {
             value: libc::c_int,
         ) -> libc::c_int;
 
+        pub fn tt_xetex_get_stat(stat_name: *const libc::c_char, value: *mut u64) -> libc::c_int;
+
         pub fn tt_engine_xetex_main(
             api: &mut CoreBridgeState,
             dump_name: *const libc::c_char,
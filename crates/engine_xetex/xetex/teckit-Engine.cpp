@@ -120,6 +120,21 @@ Stage::lookaheadCount() const
 	return 0;
 }
 
+static void
+setTriggers(Byte* triggers, UInt32 first, UInt32 last)
+{
+	for (UInt32 c = first; c <= last; ++c)
+		triggers[c >> 3] |= 1 << (c & 7);
+}
+
+bool
+Stage::addTriggers(Byte* /*triggers*/) const
+	/* mark the BMP characters that this stage might change, or return false
+	   if it might change anything at all */
+{
+	return false;
+}
+
 #include "teckit-NormalizationData.c"
 
 Normalizer::Normalizer(bool compose)
@@ -180,6 +195,64 @@ Normalizer::Reset()
 	oBufSafe = 0;
 }
 
+bool
+Normalizer::recomposes(UInt32 c) const
+	/* whether composing the canonical decomposition of c gives back c */
+{
+	UInt32	last = c;
+	UInt32	prefix = decomposeOne(last);
+	if (prefix == 0xffff)
+		return true;
+
+	// composition only ever starts from a starter
+	UInt32	plane = prefix >> 16;
+	UInt32	page = (prefix >> 8) & 0xff;
+	UInt32	ch = prefix & 0xff;
+	if (ccCharClass[ccPageMaps[ccPlaneMap[plane]][page]][ch] != 0)
+		return false;
+	UInt16	li = cLCharIndex[cLPageMaps[cLPlaneMap[plane]][page]][ch];
+	plane = last >> 16;
+	page = (last >> 8) & 0xff;
+	ch = last & 0xff;
+	UInt16	ri = cRCharIndex[cRPageMaps[cRPlaneMap[plane]][page]][ch];
+
+	return cComposites[li][ri] == c && recomposes(prefix);
+}
+
+bool
+Normalizer::isStable(UInt32 c) const
+	/* whether c is a starter that is left alone by this normalizer, and can't
+	   interact with its neighbors: text made of stable characters is already
+	   normalized */
+{
+	UInt32	plane = c >> 16;
+	UInt32	page = (c >> 8) & 0xff;
+	UInt32	ch = c & 0xff;
+	if (ccCharClass[ccPageMaps[ccPlaneMap[plane]][page]][ch] != 0)
+		return false;
+
+	if (!bCompose) {
+		UInt32	d = c;
+		return c - SBase >= SCount && decomposeOne(d) == 0xffff;
+	}
+
+	// Hangul vowels and trailing consonants compose with what precedes them
+	if (c - VBase < VCount || (c > TBase && c - TBase < TCount))
+		return false;
+	if (cRCharIndex[cRPageMaps[cRPlaneMap[plane]][page]][ch] != 0)
+		return false;
+	return recomposes(c);
+}
+
+bool
+Normalizer::addTriggers(Byte* triggers) const
+{
+	for (UInt32 c = 0; c < 0x10000; ++c)
+		if (!isStable(c))
+			setTriggers(triggers, c, c);
+	return true;
+}
+
 void
 Normalizer::decompose(UInt32 c)
 {
@@ -191,7 +264,7 @@ Normalizer::decompose(UInt32 c)
 }
 
 UInt32
-Normalizer::decomposeOne(UInt32& c)
+Normalizer::decomposeOne(UInt32& c) const
 {
 	UInt32	plane = c >> 16;
 	UInt32	page = (c >> 8) & 0xff;
@@ -318,7 +391,11 @@ Normalizer::growOutBuf()
 void
 Normalizer::compose()
 {
-	// search for compositions in oBuffer up to oBufEnd
+	// search for compositions in oBuffer up to oBufEnd; if it's empty,
+	// oBuffer[0] may be left over from earlier text (even kEndOfText)
+	if (oBufEnd == 0)
+		return;
+
 	UInt32	starterPos = 0;
 
 	UInt32	c = oBuffer[0];
@@ -471,6 +548,37 @@ Pass::lookaheadCount() const
 			iBufEnd - iBufPtr;
 }
 
+bool
+Pass::addTriggers(Byte* triggers) const
+{
+	if (!bInputIsUnicode || !bOutputIsUnicode)
+		return false;
+
+	// characters that aren't in the page maps use the first lookup entry,
+	// which must leave them alone
+	if (READ(lookupBase->rules.type) != kLookupType_Unmapped)
+		return false;
+	if (reinterpret_cast<const Byte*>(lookupBase) == pageBase)
+		return true;	// pass with no rules
+
+	const UInt8*	pageMap = pageBase;
+	if (bSupplementaryChars)
+		pageMap = READ(planeMap[0]) == 0xff ? 0 : pageBase + 256 * READ(planeMap[0]);
+	if (pageMap == 0)
+		return true;
+
+	const UInt16*	charMapBase = reinterpret_cast<const UInt16*>(pageBase + 256 * numPageMaps);
+	for (UInt32 c = 0; c < 0x10000; ++c) {
+		UInt8	page = READ(pageMap[c >> 8]);
+		if (page == 0xff)
+			continue;
+		UInt16	charIndex = READ(charMapBase[256 * page + (c & 0xff)]);
+		if (READ(lookupBase[charIndex].rules.type) != kLookupType_Unmapped)
+			setTriggers(triggers, c, c);
+	}
+	return true;
+}
+
 UInt32
 Pass::inputChar(long inIndex)
 	// Called by DoMapping or match to read the character at a given location
@@ -1728,6 +1836,23 @@ Converter::GetNamePtr(UInt16 nameID, const Byte*& outNamePtr, UInt32& outNameLen
 	return getNamePtrFromTable(table, nameID, outNamePtr, outNameLen);
 }
 
+TECkit_Status
+Converter::GetTriggers(Byte* outTriggers) const
+{
+	memset(outTriggers, 0, kTriggerBitsSize);
+	if (status != kStatus_NoError || inputForm < kForm_UTF8 || inputForm > kForm_UTF32LE
+			|| outputForm < kForm_UTF8 || outputForm > kForm_UTF32LE)
+		return kStatus_InvalidForm;
+
+	for (const Stage* s = finalStage; s != this; s = s->prevStage)
+		if (!s->addTriggers(outTriggers))
+			return kStatus_InvalidForm;
+
+	setTriggers(outTriggers, 0xd800, 0xdfff);
+	setTriggers(outTriggers, 0xfeff, 0xfeff);	// in case it's taken as a byte order mark
+	return kStatus_NoError;
+}
+
 TECkit_Status
 Converter::ConvertBufferOpt(
 	const Byte* inBuffer, UInt32 inLength, UInt32* inUsed,
@@ -2007,6 +2132,19 @@ TECkit_GetConverterFlags(
 	return status;
 }
 
+TECkit_Status
+WINAPI
+TECkit_GetConverterTriggers(
+	TECkit_Converter	converter,
+	Byte*				triggers)
+{
+	TECkit_Status	status = kStatus_InvalidConverter;
+	Converter*	cnv = reinterpret_cast<Converter*>(converter);
+	if (Converter::Validate(cnv))
+		status = cnv->GetTriggers(triggers);
+	return status;
+}
+
 TECkit_Status
 WINAPI
 TECkit_ResetConverter(
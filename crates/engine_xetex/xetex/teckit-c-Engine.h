@@ -267,6 +267,27 @@ TECkit_FlushOpt(
 	UInt32				inOptions,
 	UInt32*				lookaheadCount);
 
+/*
+	***** Tectonic extension *****
+
+	Find the UTF-16 code units that a Unicode-to-Unicode converter might not
+	copy through unchanged. On success, bit (c & 7) of triggers[c >> 3] is set
+	for each such code unit c, and any text that contains none of them is
+	converted to itself, so it needn't be run through the converter at all.
+	Surrogates are always included, since only the BMP is examined in detail.
+
+	Returns kStatus_InvalidForm if the converter doesn't map Unicode to Unicode
+	or might change any text at all.
+*/
+
+#define kTriggerBitsSize	8192
+
+TECkit_Status
+WINAPI EXPORTED
+TECkit_GetConverterTriggers(
+	TECkit_Converter	converter,
+	Byte*				triggers);
+
 
 #if defined(__cplusplus)
 }	/* extern "C" */
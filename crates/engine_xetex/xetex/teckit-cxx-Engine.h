@@ -37,6 +37,7 @@ public:
 	virtual void		Reset() = 0;
 
 	virtual UInt32		lookaheadCount() const;
+	virtual bool		addTriggers(Byte* triggers) const;
 
 protected:
 	friend class Converter;
@@ -59,12 +60,15 @@ public:
 	virtual UInt32		getChar();
 
 	virtual void		Reset();
+	virtual bool		addTriggers(Byte* triggers) const;
 
 protected:
+	bool				isStable(UInt32 c) const;
+	bool				recomposes(UInt32 c) const;
 	UInt32				process();
 
 	void				decompose(UInt32 c);
-	UInt32				decomposeOne(UInt32& c);
+	UInt32				decomposeOne(UInt32& c) const;
 
 	void				compose();
 	void				generateChar(UInt32 c);
@@ -90,6 +94,7 @@ public:
 	virtual void		Reset();
 
 	virtual UInt32		lookaheadCount() const;
+	virtual bool		addTriggers(Byte* triggers) const;
 
 protected:
 	UInt32				DoMapping();
@@ -170,6 +175,7 @@ public:
 	bool				IsForward() const;
 	void				GetFlags(UInt32& sourceFlags, UInt32& targetFlags) const;
 	bool				GetNamePtr(UInt16 inNameID, const Byte*& outNamePtr, UInt32& outNameLen) const;
+	TECkit_Status		GetTriggers(Byte* outTriggers) const;
 
 	long				creationStatus() const
 							{ return status; }
@@ -11,6 +11,7 @@
 
 int tt_xetex_set_int_variable (const char *var_name, int value);
 int tt_xetex_set_string_variable (const char *var_name, const char *value);
+int tt_xetex_get_stat (const char *stat_name, uint64_t *value);
 int tt_engine_xetex_main(
     ttbc_state_t *api,
     const char *dump_name,
@@ -28,12 +29,18 @@ tt_xetex_set_int_variable (const char *var_name, int value)
         halt_on_error_p = value;
     else if (streq_ptr(var_name, "in_initex_mode"))
         in_initex_mode = (value != 0);
+    else if (streq_ptr(var_name, "initex_preload_format"))
+        initex_preload_format = (value != 0);
     else if (streq_ptr(var_name, "synctex_enabled"))
         synctex_enabled = (value != 0);
     else if (streq_ptr(var_name, "semantic_pagination_enabled"))
         semantic_pagination_enabled = (value != 0);
+    else if (streq_ptr(var_name, "macro_profile_enabled"))
+        macro_profile_enabled = (value != 0);
     else if (streq_ptr(var_name, "shell_escape_enabled"))
         shell_escape_enabled = (value != 0);
+    else if (streq_ptr(var_name, "hash_extra"))
+        hash_extra = value;
     else
         return 1; /* Uh oh: unrecognized variable */
 
@@ -48,6 +55,47 @@ tt_xetex_set_string_variable (const char *var_name, const char *value)
     return 1;
 }
 
+/* Likewise, this is called by the Rust code to retrieve statistics about the
+ * most recent run of the engine. */
+
+int
+tt_xetex_get_stat (const char *stat_name, uint64_t *value)
+{
+    if (streq_ptr(stat_name, "hyph_cache_hits"))
+        *value = hyph_cache_hits;
+    else if (streq_ptr(stat_name, "hyph_cache_misses"))
+        *value = hyph_cache_misses;
+    else if (streq_ptr(stat_name, "mem_top"))
+        *value = MEM_TOP;
+    else if (streq_ptr(stat_name, "mem_lo_max"))
+        *value = lo_mem_max;
+    else if (streq_ptr(stat_name, "mem_hi_min"))
+        *value = hi_mem_min;
+    else if (streq_ptr(stat_name, "mem_end"))
+        *value = mem_end;
+    else if (streq_ptr(stat_name, "hash_entries"))
+        *value = HASH_SIZE + hash_extra;
+    else if (streq_ptr(stat_name, "hash_entries_used"))
+        *value = hash_entries_used;
+    else if (streq_ptr(stat_name, "strings"))
+        *value = max_strings - init_str_ptr;
+    else if (streq_ptr(stat_name, "strings_used"))
+        *value = str_ptr - init_str_ptr;
+    else if (streq_ptr(stat_name, "string_chars"))
+        *value = pool_size - init_pool_ptr;
+    else if (streq_ptr(stat_name, "string_chars_used"))
+        *value = pool_ptr - init_pool_ptr;
+    else if (streq_ptr(stat_name, "fonts_loaded"))
+        *value = font_ptr - FONT_BASE;
+    else if (streq_ptr(stat_name, "shaping_calls"))
+        *value = shaping_calls;
+    else
+        return 1; /* Uh oh: unrecognized statistic */
+
+    return 0; /* success */
+}
+
+
 int
 tt_engine_xetex_main(
     ttbc_state_t *api,
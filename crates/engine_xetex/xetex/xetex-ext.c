@@ -65,57 +65,155 @@ authorization from the copyright holders.
 #define kGPOS HB_TAG('G','P','O','S')
 
 
+/* Opening an ICU break iterator is expensive, since it has to build its rule
+ * tables, and text that mixes scripts tends to switch
+ * \XeTeXlinebreaklocale back and forth between words. So we keep the
+ * iterators for the last few locales around. */
+
+#define BRK_CACHE_SIZE 8
+
+static struct {
+    char* locale;
+    UBreakIterator* iter;
+} brkCache[BRK_CACHE_SIZE];
+
+static int brkCacheNext = 0;
+
+/* The iterator for the current run of text, or NULL if we're using Graphite
+ * or the fast path below. */
 static UBreakIterator* brkIter = NULL;
-static int brkLocaleStrNum = 0;
+
+/* When the current run can't contain a break opportunity, the one break we
+ * still have to report (at its end), or UBRK_DONE once we have. */
+static bool brkWholeRun = false;
+static int32_t brkWholeRunEnd = UBRK_DONE;
+
+static bool
+locale_matches(const char* locale, str_number s)
+{
+    pool_pointer i;
+    size_t j = 0;
+
+    if (s < 65536L)
+        return false;
+
+    for (i = str_start[s - 65536L]; i < str_start[s + 1 - 65536L]; i++, j++) {
+        if (locale[j] == '\0' || (unsigned char) locale[j] >= 0x80 || (unsigned char) locale[j] != str_pool[i])
+            return false;
+    }
+
+    return locale[j] == '\0';
+}
+
+static UBreakIterator*
+get_break_iterator(int32_t localeStrNum)
+{
+    UErrorCode status = U_ZERO_ERROR;
+    UBreakIterator* iter;
+    char* locale;
+    int i;
+
+    /* Cheap check first, which covers all ASCII locale names ... */
+
+    for (i = 0; i < BRK_CACHE_SIZE; i++) {
+        if (brkCache[i].iter != NULL && locale_matches(brkCache[i].locale, localeStrNum))
+            return brkCache[i].iter;
+    }
+
+    /* ... and an exact one for the rest. */
+
+    locale = gettexstring(localeStrNum);
+
+    for (i = 0; i < BRK_CACHE_SIZE; i++) {
+        if (brkCache[i].iter != NULL && streq_ptr(brkCache[i].locale, locale)) {
+            free(locale);
+            return brkCache[i].iter;
+        }
+    }
+
+    iter = ubrk_open(UBRK_LINE, locale, NULL, 0, &status);
+    if (U_FAILURE(status)) {
+        begin_diagnostic();
+        print_nl('E');
+        print_c_string("rror ");
+        print_int(status);
+        print_c_string(" creating linebreak iterator for locale `");
+        print_c_string(locale);
+        print_c_string("'; trying default locale `en_us'.");
+        end_diagnostic(1);
+        if (iter != NULL)
+            ubrk_close(iter);
+        status = U_ZERO_ERROR;
+        iter = ubrk_open(UBRK_LINE, "en_us", NULL, 0, &status);
+    }
+
+    if (iter == NULL)
+        _tt_abort ("failed to create linebreak iterator, status=%d", (int) status);
+
+    i = brkCacheNext;
+    brkCacheNext = (brkCacheNext + 1) % BRK_CACHE_SIZE;
+
+    if (brkCache[i].iter != NULL) {
+        ubrk_close(brkCache[i].iter);
+        free(brkCache[i].locale);
+    }
+
+    brkCache[i].locale = locale;
+    brkCache[i].iter = iter;
+    return iter;
+}
+
+/* Runs of ASCII letters and digits have no line break opportunities in any
+ * locale (UAX #14 rules LB23, LB28 and LB29), so there's no need to ask ICU
+ * about them. */
+static bool
+run_has_no_breaks(const uint16_t* text, int32_t textLength)
+{
+    int32_t i;
+
+    for (i = 0; i < textLength; i++) {
+        uint16_t c = text[i];
+
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')))
+            return false;
+    }
+
+    return true;
+}
 
 void
 linebreak_start(int f, int32_t localeStrNum, uint16_t* text, int32_t textLength)
 {
     UErrorCode status = U_ZERO_ERROR;
-    char* locale = (char*)gettexstring(localeStrNum);
 
-    if (font_area[f] == OTGR_FONT_FLAG && streq_ptr(locale, "G")) {
+    brkIter = NULL;
+    brkWholeRun = false;
+
+    if (font_area[f] == OTGR_FONT_FLAG && locale_matches("G", localeStrNum)) {
         XeTeXLayoutEngine engine = (XeTeXLayoutEngine) font_layout_engine[f];
         if (initGraphiteBreaking(engine, text, textLength))
             /* user asked for Graphite line breaking and the font supports it */
             return;
     }
 
-    if ((localeStrNum != brkLocaleStrNum) && (brkIter != NULL)) {
-        ubrk_close(brkIter);
-        brkIter = NULL;
-    }
-
-    if (brkIter == NULL) {
-        brkIter = ubrk_open(UBRK_LINE, locale, NULL, 0, &status);
-        if (U_FAILURE(status)) {
-            begin_diagnostic();
-            print_nl('E');
-            print_c_string("rror ");
-            print_int(status);
-            print_c_string(" creating linebreak iterator for locale `");
-            print_c_string(locale);
-            print_c_string("'; trying default locale `en_us'.");
-            end_diagnostic(1);
-            if (brkIter != NULL)
-                ubrk_close(brkIter);
-            status = U_ZERO_ERROR;
-            brkIter = ubrk_open(UBRK_LINE, "en_us", NULL, 0, &status);
-        }
-        free(locale);
-        brkLocaleStrNum = localeStrNum;
+    if (run_has_no_breaks(text, textLength)) {
+        brkWholeRun = true;
+        brkWholeRunEnd = textLength;
+        return;
     }
 
-    if (brkIter == NULL)
-        _tt_abort ("failed to create linebreak iterator, status=%d", (int) status);
-
+    brkIter = get_break_iterator(localeStrNum);
     ubrk_setText(brkIter, (UChar*) text, textLength, &status);
 }
 
 int
 linebreak_next(int f)
 {
-    if (brkIter != NULL)
+    if (brkWholeRun) {
+        int32_t offs = brkWholeRunEnd;
+        brkWholeRunEnd = UBRK_DONE;
+        return offs;
+    } else if (brkIter != NULL)
         return ubrk_next((UBreakIterator*)brkIter);
     else {
     	XeTeXLayoutEngine engine = (XeTeXLayoutEngine) font_layout_engine[f];
@@ -183,10 +281,47 @@ print_chars(const unsigned short* str, int len)
         print_char(*(str++));
 }
 
+/* A font mapping: a TECkit converter, plus what we need to avoid running it.
+ * Mappings like tex-text.tec only touch a handful of characters, so for
+ * Unicode-to-Unicode mappings we ask the converter which UTF-16 code units it
+ * might change, and pass words without any of them straight through. Words
+ * that do need converting tend to recur, so we remember the results for the
+ * last few of them; and for byte mappings of TFM fonts, which convert one
+ * character at a time, we remember the results for recent characters. */
+
+#define MAPPING_MEMO_SIZE 64
+#define MAPPING_MEMO_MAX_IN 24
+#define MAPPING_MEMO_MAX_OUT 48
+#define TFM_MAPPING_MEMO_SIZE 256
+
+typedef struct {
+    int in_len; /* 0 if this entry is unused */
+    int out_len;
+    UniChar in[MAPPING_MEMO_MAX_IN];
+    UniChar out[MAPPING_MEMO_MAX_OUT];
+} mapping_memo_entry;
+
+typedef struct {
+    TECkit_Converter cnv;
+
+    /* Bitmap of the code units that the converter might change, or NULL if we
+     * can't tell. */
+    Byte* triggers;
+
+    /* Allocated on first use. */
+    mapping_memo_entry* memo;
+
+    /* For byte mappings: the last result for each character, keyed by the
+     * character modulo the table size. Unused entries have a key of -1. */
+    int32_t tfm_memo_key[TFM_MAPPING_MEMO_SIZE];
+    int tfm_memo_val[TFM_MAPPING_MEMO_SIZE];
+} font_mapping_t;
+
 static void*
 load_mapping_file(const char* s, const char* e, char byteMapping)
 {
     TECkit_Converter cnv = 0;
+    font_mapping_t* fm = NULL;
     char* buffer = xmalloc(e - s + 5);
     rust_input_handle_t map;
 
@@ -228,7 +363,33 @@ load_mapping_file(const char* s, const char* e, char byteMapping)
 
     free(buffer);
 
-    return cnv;
+    if (cnv == NULL)
+        return NULL;
+
+    fm = xcalloc(1, sizeof(font_mapping_t));
+    fm->cnv = cnv;
+
+    if (byteMapping == 0) {
+        fm->triggers = xmalloc(kTriggerBitsSize);
+        if (TECkit_GetConverterTriggers(cnv, fm->triggers) != kStatus_NoError)
+            fm->triggers = mfree(fm->triggers);
+    } else {
+        for (int i = 0; i < TFM_MAPPING_MEMO_SIZE; i++)
+            fm->tfm_memo_key[i] = -1;
+    }
+
+    return fm;
+}
+
+void
+dispose_font_mapping(void* mapping)
+{
+    font_mapping_t* fm = mapping;
+
+    TECkit_DisposeConverter(fm->cnv);
+    free(fm->triggers);
+    free(fm->memo);
+    free(fm);
 }
 
 static char *saved_mapping_name = NULL;
@@ -260,19 +421,25 @@ load_tfm_font_mapping(void)
 }
 
 int
-apply_tfm_font_mapping(void* cnv, int c)
+apply_tfm_font_mapping(void* mapping, int c)
 {
+    font_mapping_t* fm = mapping;
+    int slot = c % TFM_MAPPING_MEMO_SIZE;
     UniChar in = c;
     Byte out[2];
     UInt32 inUsed, outUsed;
+
+    if (fm->tfm_memo_key[slot] == c)
+        return fm->tfm_memo_val[slot];
+
     /* TECkit_Status status; */
-    /* status = */ TECkit_ConvertBuffer((TECkit_Converter)cnv,
+    /* status = */ TECkit_ConvertBuffer(fm->cnv,
             (const Byte*)&in, sizeof(in), &inUsed, out, sizeof(out), &outUsed, 1);
-    TECkit_ResetConverter((TECkit_Converter) cnv);
-    if (outUsed < 1)
-        return 0;
-    else
-        return out[0];
+    TECkit_ResetConverter(fm->cnv);
+
+    fm->tfm_memo_key[slot] = c;
+    fm->tfm_memo_val[slot] = outUsed < 1 ? 0 : out[0];
+    return fm->tfm_memo_val[slot];
 }
 
 double
@@ -1311,37 +1478,88 @@ make_font_def(int32_t f)
     return fontDefLength;
 }
 
+static UInt32 mapped_text_length = 0;
+
+static void
+ensure_mapped_text_length(UInt32 len)
+{
+    if (mapped_text_length < len) {
+        free(mapped_text);
+        mapped_text_length = len;
+        mapped_text = xmalloc(mapped_text_length);
+    }
+}
+
+static mapping_memo_entry*
+mapping_memo_slot(font_mapping_t* fm, const uint16_t* txtPtr, int txtLen)
+{
+    uint32_t h = 2166136261U; /* FNV-1a */
+
+    if (fm->memo == NULL)
+        fm->memo = xcalloc(MAPPING_MEMO_SIZE, sizeof(mapping_memo_entry));
+
+    for (int i = 0; i < txtLen; i++)
+        h = (h ^ txtPtr[i]) * 16777619U;
+
+    return &fm->memo[h % MAPPING_MEMO_SIZE];
+}
+
 int
-apply_mapping(void* pCnv, uint16_t* txtPtr, int txtLen)
+apply_mapping(void* mapping, uint16_t* txtPtr, int txtLen)
 {
-    TECkit_Converter cnv = (TECkit_Converter)pCnv;
+    font_mapping_t* fm = mapping;
+    mapping_memo_entry* memo = NULL;
     UInt32 inUsed, outUsed;
     TECkit_Status status;
-    static UInt32 outLength = 0;
+    int i;
 
     /* allocate outBuffer if not big enough */
-    if (outLength < txtLen * sizeof(UniChar) + 32) {
-        free(mapped_text);
-        outLength = txtLen * sizeof(UniChar) + 32;
-        mapped_text = xmalloc(outLength);
+    ensure_mapped_text_length(txtLen * sizeof(UniChar) + 32);
+
+    /* skip the converter if it wouldn't change anything */
+    if (fm->triggers != NULL) {
+        for (i = 0; i < txtLen; i++) {
+            if (fm->triggers[txtPtr[i] >> 3] & (1 << (txtPtr[i] & 7)))
+                break;
+        }
+
+        if (i == txtLen) {
+            memcpy(mapped_text, txtPtr, txtLen * sizeof(UniChar));
+            return txtLen;
+        }
+    }
+
+    if (txtLen > 0 && txtLen <= MAPPING_MEMO_MAX_IN) {
+        memo = mapping_memo_slot(fm, txtPtr, txtLen);
+
+        if (memo->in_len == txtLen && memcmp(memo->in, txtPtr, txtLen * sizeof(UniChar)) == 0) {
+            memcpy(mapped_text, memo->out, memo->out_len * sizeof(UniChar));
+            return memo->out_len;
+        }
     }
 
     /* try the mapping */
 retry:
-    status = TECkit_ConvertBuffer(cnv,
+    status = TECkit_ConvertBuffer(fm->cnv,
             (Byte*)txtPtr, txtLen * sizeof(UniChar), &inUsed,
-            (Byte*)mapped_text, outLength, &outUsed, true);
-    TECkit_ResetConverter(cnv);
+            (Byte*)mapped_text, mapped_text_length, &outUsed, true);
+    TECkit_ResetConverter(fm->cnv);
 
     switch (status) {
         case kStatus_NoError:
-            txtPtr = (UniChar*)mapped_text;
-            return outUsed / sizeof(UniChar);
+            outUsed /= sizeof(UniChar);
+
+            if (memo != NULL && outUsed <= MAPPING_MEMO_MAX_OUT) {
+                memo->in_len = txtLen;
+                memo->out_len = outUsed;
+                memcpy(memo->in, txtPtr, txtLen * sizeof(UniChar));
+                memcpy(memo->out, mapped_text, outUsed * sizeof(UniChar));
+            }
+
+            return outUsed;
 
         case kStatus_OutputBufferFull:
-            outLength += (txtLen * sizeof(UniChar)) + 32;
-            free(mapped_text);
-            mapped_text = xmalloc(outLength);
+            ensure_mapped_text_length(mapped_text_length + (txtLen * sizeof(UniChar)) + 32);
             goto retry;
 
         default:
@@ -1557,6 +1775,104 @@ store_justified_native_glyphs(void* pNode)
     }
 }
 
+/* Scratch space for measure_native_node(). It only ever grows, so that in
+ * the steady state measuring a word doesn't touch the allocator. `glyphs`,
+ * `advances` and `positions` receive the output of a single run of
+ * layoutChars(); the other arrays accumulate the results for the whole
+ * word. */
+
+static struct {
+    int runCapacity;
+    int wordCapacity;
+    uint32_t* glyphs;
+    float* advances;
+    FloatPoint* positions;
+    FixedPoint* locations;
+    uint16_t* glyphIDs;
+    Fixed* glyphAdvances;
+} measureScratch;
+
+static UBiDi* measureBiDi = NULL;
+
+static void
+reserve_measure_scratch(int runGlyphs, int wordGlyphs)
+{
+    if (runGlyphs > measureScratch.runCapacity) {
+        int n = runGlyphs > 2 * measureScratch.runCapacity ? runGlyphs : 2 * measureScratch.runCapacity;
+        measureScratch.glyphs = xrealloc(measureScratch.glyphs, n * sizeof(uint32_t));
+        measureScratch.advances = xrealloc(measureScratch.advances, n * sizeof(float));
+        measureScratch.positions = xrealloc(measureScratch.positions, (n + 1) * sizeof(FloatPoint));
+        measureScratch.runCapacity = n;
+    }
+
+    if (measureScratch.positions == NULL) {
+        /* layoutChars() may return no glyphs, but getGlyphPositions() still
+         * reports where the pen ended up */
+        measureScratch.positions = xcalloc(1, sizeof(FloatPoint));
+    }
+
+    if (wordGlyphs > measureScratch.wordCapacity) {
+        int n = wordGlyphs > 2 * measureScratch.wordCapacity ? wordGlyphs : 2 * measureScratch.wordCapacity;
+        measureScratch.locations = xrealloc(measureScratch.locations, n * sizeof(FixedPoint));
+        measureScratch.glyphIDs = xrealloc(measureScratch.glyphIDs, n * sizeof(uint16_t));
+        measureScratch.glyphAdvances = xrealloc(measureScratch.glyphAdvances, n * sizeof(Fixed));
+        measureScratch.wordCapacity = n;
+    }
+}
+
+/* Whether text laid out with a default LTR paragraph direction is known to
+ * resolve to a single LTR run, so that we needn't run the BiDi algorithm on
+ * it: that holds as long as it contains no strong RTL characters, Arabic
+ * numbers, or explicit directional formatting characters. The ranges below
+ * are conservative and leave out everything in and around the RTL blocks,
+ * including surrogates. */
+static bool
+text_is_plain_ltr(const uint16_t* text, int32_t len)
+{
+    int32_t i;
+
+    for (i = 0; i < len; i++) {
+        uint16_t c = text[i];
+
+        if (c < 0x0590)
+            continue;
+        if (c >= 0x0900 && c < 0x2000)
+            continue;
+        if (c >= 0x2070 && c < 0xD800)
+            continue;
+        if (c >= 0xE000 && c < 0xFB1D)
+            continue;
+
+        return false;
+    }
+
+    return true;
+}
+
+/* Attach glyph data to a native word node. The node owns its array, which
+ * we reuse when re-measuring a node if it's big enough. */
+static void
+set_node_glyph_info(memory_word* node, int count, const FixedPoint* locations, const uint16_t* glyphIDs)
+{
+    void* glyph_info = native_glyph_info_ptr(node);
+
+    if (glyph_info != NULL && (count == 0 || count > native_glyph_count(node))) {
+        free(glyph_info);
+        glyph_info = NULL;
+    }
+
+    if (count > 0) {
+        if (glyph_info == NULL)
+            glyph_info = xmalloc(count * native_glyph_info_size);
+
+        memcpy(glyph_info, locations, count * sizeof(FixedPoint));
+        memcpy((FixedPoint*) glyph_info + count, glyphIDs, count * sizeof(uint16_t));
+    }
+
+    native_glyph_count(node) = count;
+    native_glyph_info_ptr(node) = glyph_info;
+}
+
 void
 measure_native_node(void* pNode, int use_glyph_metrics)
 {
@@ -1577,125 +1893,67 @@ measure_native_node(void* pNode, int use_glyph_metrics)
 
         XeTeXLayoutEngine engine = (XeTeXLayoutEngine)(font_layout_engine[f]);
 
-        FixedPoint* locations = NULL;
-        uint16_t* glyphIDs;
-        Fixed* glyphAdvances = NULL;
+        FixedPoint* locations;
+        Fixed* glyphAdvances;
         int totalGlyphCount = 0;
+        int nRuns = 1;
+        bool mixed = false;
+        int i, runIndex;
+        int32_t logicalStart = 0, length = txtLen;
+        double x = 0.0, y = 0.0;
 
         /* need to find direction runs within the text, and call layoutChars separately for each */
 
-        UBiDiDirection dir;
-        void* glyph_info = 0;
-        static FloatPoint* positions = 0;
-        static float* advances = 0;
-        static uint32_t* glyphs = 0;
-
-        UBiDi* pBiDi = ubidi_open();
-
-        UErrorCode errorCode = U_ZERO_ERROR;
-        ubidi_setPara(pBiDi, (const UChar*) txtPtr, txtLen, getDefaultDirection(engine), NULL, &errorCode);
-
-        dir = ubidi_getDirection(pBiDi);
-        if (dir == UBIDI_MIXED) {
-            /* we actually do the layout twice here, once to count glyphs and then again to get them;
-               which is inefficient, but i figure that MIXED is a relatively rare occurrence, so i can't be
-               bothered to deal with the memory reallocation headache of doing it differently
-            */
-            int nRuns = ubidi_countRuns(pBiDi, &errorCode);
-            double width = 0;
-            int i, runIndex;
-            int32_t logicalStart, length;
-            for (runIndex = 0; runIndex < nRuns; ++runIndex) {
-                dir = ubidi_getVisualRun(pBiDi, runIndex, &logicalStart, &length);
-                totalGlyphCount += layoutChars(engine, txtPtr, logicalStart, length, txtLen, (dir == UBIDI_RTL));
-            }
+        UBiDiDirection dir = UBIDI_LTR;
+        int defaultDir = getDefaultDirection(engine);
 
-            if (totalGlyphCount > 0) {
-                double x, y;
-                glyph_info = xcalloc(totalGlyphCount, native_glyph_info_size);
-                locations = (FixedPoint*)glyph_info;
-                glyphIDs = (uint16_t*)(locations + totalGlyphCount);
-                glyphAdvances = xcalloc(totalGlyphCount, sizeof(Fixed));
-                totalGlyphCount = 0;
-
-                x = y = 0.0;
-                for (runIndex = 0; runIndex < nRuns; ++runIndex) {
-                    int nGlyphs;
-                    dir = ubidi_getVisualRun(pBiDi, runIndex, &logicalStart, &length);
-                    nGlyphs = layoutChars(engine, txtPtr, logicalStart, length, txtLen,
-                                            (dir == UBIDI_RTL));
-
-                    glyphs = xcalloc(nGlyphs, sizeof(uint32_t));
-                    positions = xcalloc(nGlyphs + 1, sizeof(FloatPoint));
-                    advances = xcalloc(nGlyphs, sizeof(float));
-
-                    getGlyphs(engine, glyphs);
-                    getGlyphAdvances(engine, advances);
-                    getGlyphPositions(engine, positions);
-
-                    for (i = 0; i < nGlyphs; ++i) {
-                        glyphIDs[totalGlyphCount] = glyphs[i];
-                        locations[totalGlyphCount].x = D2Fix(positions[i].x + x);
-                        locations[totalGlyphCount].y = D2Fix(positions[i].y + y);
-                        glyphAdvances[totalGlyphCount] = D2Fix(advances[i]);
-                        ++totalGlyphCount;
-                    }
-                    x += positions[nGlyphs].x;
-                    y += positions[nGlyphs].y;
-
-                    free(glyphs);
-                    free(positions);
-                    free(advances);
-                }
-                width = x;
-            }
+        if (defaultDir != UBIDI_DEFAULT_LTR || !text_is_plain_ltr(txtPtr, txtLen)) {
+            UErrorCode errorCode = U_ZERO_ERROR;
 
-            node_width(node) = D2Fix(width);
-            native_glyph_count(node) = totalGlyphCount;
-            native_glyph_info_ptr(node) = glyph_info;
-        } else {
-            double width = 0;
-            totalGlyphCount = layoutChars(engine, txtPtr, 0, txtLen, txtLen, (dir == UBIDI_RTL));
-
-            glyphs = xcalloc(totalGlyphCount, sizeof(uint32_t));
-            positions = xcalloc(totalGlyphCount + 1, sizeof(FloatPoint));
-            advances = xcalloc(totalGlyphCount, sizeof(float));
-
-            getGlyphs(engine, glyphs);
-            getGlyphAdvances(engine, advances);
-            getGlyphPositions(engine, positions);
-
-            if (totalGlyphCount > 0) {
-                int i;
-                glyph_info = xcalloc(totalGlyphCount, native_glyph_info_size);
-                locations = (FixedPoint*)glyph_info;
-                glyphIDs = (uint16_t*)(locations + totalGlyphCount);
-                glyphAdvances = xcalloc(totalGlyphCount, sizeof(Fixed));
-                for (i = 0; i < totalGlyphCount; ++i) {
-                    glyphIDs[i] = glyphs[i];
-                    glyphAdvances[i] = D2Fix(advances[i]);
-                    locations[i].x = D2Fix(positions[i].x);
-                    locations[i].y = D2Fix(positions[i].y);
-                }
-                width = positions[totalGlyphCount].x;
+            if (measureBiDi == NULL)
+                measureBiDi = ubidi_open();
+
+            ubidi_setPara(measureBiDi, (const UChar*) txtPtr, txtLen, defaultDir, NULL, &errorCode);
+            dir = ubidi_getDirection(measureBiDi);
+            if (dir == UBIDI_MIXED) {
+                mixed = true;
+                nRuns = ubidi_countRuns(measureBiDi, &errorCode);
             }
+        }
+
+        for (runIndex = 0; runIndex < nRuns; ++runIndex) {
+            int nGlyphs;
 
-            node_width(node) = D2Fix(width);
-            native_glyph_count(node) = totalGlyphCount;
-            native_glyph_info_ptr(node) = glyph_info;
+            if (mixed)
+                dir = ubidi_getVisualRun(measureBiDi, runIndex, &logicalStart, &length);
 
-            free(glyphs);
-            free(positions);
-            free(advances);
+            nGlyphs = layoutChars(engine, txtPtr, logicalStart, length, txtLen, (dir == UBIDI_RTL));
+            shaping_calls++;
+            reserve_measure_scratch(nGlyphs, totalGlyphCount + nGlyphs);
+
+            getGlyphs(engine, measureScratch.glyphs);
+            getGlyphAdvances(engine, measureScratch.advances);
+            getGlyphPositions(engine, measureScratch.positions);
+
+            for (i = 0; i < nGlyphs; ++i) {
+                measureScratch.glyphIDs[totalGlyphCount] = measureScratch.glyphs[i];
+                measureScratch.locations[totalGlyphCount].x = D2Fix(measureScratch.positions[i].x + x);
+                measureScratch.locations[totalGlyphCount].y = D2Fix(measureScratch.positions[i].y + y);
+                measureScratch.glyphAdvances[totalGlyphCount] = D2Fix(measureScratch.advances[i]);
+                ++totalGlyphCount;
+            }
+            x += measureScratch.positions[nGlyphs].x;
+            y += measureScratch.positions[nGlyphs].y;
         }
 
-        ubidi_close(pBiDi);
+        locations = measureScratch.locations;
+        glyphAdvances = measureScratch.glyphAdvances;
 
+        node_width(node) = D2Fix(totalGlyphCount > 0 ? x : 0.0);
 
         if (font_letter_space[f] != 0) {
             Fixed lsDelta = 0;
             Fixed lsUnit = font_letter_space[f];
-            int i;
             for (i = 0; i < totalGlyphCount; ++i) {
                 if (glyphAdvances[i] == 0 && lsDelta != 0)
                     lsDelta -= lsUnit;
@@ -1707,7 +1965,8 @@ measure_native_node(void* pNode, int use_glyph_metrics)
                 node_width(node) += lsDelta;
             }
         }
-        free(glyphAdvances);
+
+        set_node_glyph_info(node, totalGlyphCount, locations, measureScratch.glyphIDs);
     } else {
         _tt_abort("bad native font flag in `measure_native_node`");
     }
@@ -136,7 +136,7 @@ int32_t ot_font_get_3(int32_t what, void* engine, int32_t param1, int32_t param2
 
 int makeXDVGlyphArrayData(void* p);
 int make_font_def(int32_t f);
-int apply_mapping(void* cnv, uint16_t* txtPtr, int txtLen);
+int apply_mapping(void* mapping, uint16_t* txtPtr, int txtLen);
 void store_justified_native_glyphs(void* node);
 void measure_native_node(void* node, int use_glyph_metrics);
 Fixed real_get_native_italic_correction(void* node);
@@ -165,6 +165,7 @@ Fixed D2Fix(double d);
 void check_for_tfm_font_mapping(void);
 void* load_tfm_font_mapping(void);
 int apply_tfm_font_mapping(void* mapping, int c);
+void dispose_font_mapping(void* mapping);
 
 int aat_font_get(int what, CFDictionaryRef attrs);
 int aat_font_get_1(int what, CFDictionaryRef attrs, int param);
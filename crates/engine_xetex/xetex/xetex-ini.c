@@ -3,16 +3,10 @@
    Licensed under the MIT License.
 */
 
-/* On Windows this can bring in a `#define INPUT` that clashes with
- * xetex_format.h, so include it first and sanitize: */
-#include "teckit-c-Engine.h"
-#ifdef INPUT
-#undef INPUT
-#endif
-
 #include "xetex-core.h"
 #include "xetex-xetexd.h"
 #include "xetex-synctex.h"
+#include "xetex-profile.h"
 #include "dpx-pdfobj.h" /* pdf_files_{init,close} */
 #include "xetex_bindings.h" /* FORMAT_SERIAL */
 
@@ -29,6 +23,7 @@ int32_t first;
 int32_t last;
 int32_t max_buf_stack;
 bool in_initex_mode;
+bool initex_preload_format;
 int32_t error_line;
 int32_t half_error_line;
 int32_t max_print_line;
@@ -278,6 +273,7 @@ str_number *hyph_word;
 int32_t *hyph_list;
 hyph_pointer *hyph_link;
 int32_t hyph_count;
+uint64_t hyph_cache_hits, hyph_cache_misses;
 int32_t hyph_next;
 trie_opcode trie_used[256];
 unsigned char trie_op_lang[TRIE_OP_SIZE + 1];
@@ -348,6 +344,9 @@ scaled_t delta;
 int synctex_enabled;
 bool used_tectonic_coda_tokens;
 bool semantic_pagination_enabled;
+int macro_profile_enabled;
+uint64_t shaping_calls;
+int32_t hash_entries_used;
 bool gave_char_warning_help;
 
 /* These ought to live in xetex-pagebuilder.c but are shared a lot: */
@@ -1137,6 +1136,7 @@ void init_trie(void)
     }
     trie_trc[0] = '?' ;
     trie_not_ready = false;
+    hyph_cache_reset();
 }
 
 /*:1001*/
@@ -1154,6 +1154,7 @@ new_hyph_exceptions(void)
     pool_pointer u, v;
 
     scan_left_brace();
+    hyph_cache_reset();
 
     if (INTPAR(language) <= 0)
         cur_lang = 0;
@@ -2511,6 +2512,7 @@ load_fmt_file(void)
     hash = yhash - hash_offset;
     hash[HASH_BASE].s0 = 0;
     hash[HASH_BASE].s1 = 0;
+    cs_index_reset();
 
     for (x = HASH_BASE + 1; x <= hash_top; x++)
         hash[x] = hash[HASH_BASE];
@@ -2596,6 +2598,8 @@ load_fmt_file(void)
     else
         rover = x;
 
+    node_cache_reset();
+
     for (k = INT_VAL; k <= INTER_CHAR_VAL; k++) {
         undump_int(x);
         if (x < MIN_HALFWORD || x > lo_mem_max)
@@ -2916,6 +2920,7 @@ load_fmt_file(void)
     }
 
     trie_not_ready = false;
+    hyph_cache_reset();
 
     /* trailer */
 
@@ -3242,6 +3247,7 @@ initialize_more_initex_variables(void)
     lo_mem_max = rover + 1000;
     mem[lo_mem_max].b32.s1 = TEX_NULL;
     mem[lo_mem_max].b32.s0 = TEX_NULL;
+    node_cache_reset();
 
     for (k = PRE_ADJUST_HEAD; k <= MEM_TOP; k++)
         mem[k] = mem[lo_mem_max];
@@ -3484,7 +3490,7 @@ tt_cleanup(void) {
         }
 
         if (font_mapping[font_k] != NULL) {
-            TECkit_DisposeConverter((TECkit_Converter) font_mapping[font_k]);
+            dispose_font_mapping(font_mapping[font_k]);
             font_mapping[font_k] = NULL;
         }
     }
@@ -3511,13 +3517,28 @@ tt_cleanup(void) {
     free(hyph_word);
     free(hyph_list);
     free(hyph_link);
+    hyph_cache_reset();
 
     // initialize_more_variables @ 3277
     free(native_text);
+    profile_reset();
+
+    // Free arrays allocated in load_fmt_file, noting how full the hash table
+    // got first since tt_xetex_get_stat() can't look at it afterwards
+    if (yhash != NULL) {
+        hash_entries_used = hash_high;
+
+        for (int32_t p = HASH_BASE; p < FROZEN_CONTROL_SEQUENCE; p++) {
+            if (hash[p].s1 != 0)
+                hash_entries_used++;
+        }
+    }
 
-    // Free arrays allocated in load_fmt_file
     free(yhash);
+    yhash = NULL;
+    cs_index_reset();
     free(eqtb);
+    node_cache_reset();
     free(mem);
     free(str_start);
     free(str_pool);
@@ -3599,7 +3620,6 @@ tt_run_engine(const char *dump_name, const char *input_file_name, time_t build_d
     error_line = 79;
     half_error_line = 50;
     max_print_line = 79;
-    hash_extra = 600000L;
     expand_depth = 10000;
 
     /* Allocate many of our big arrays. */
@@ -3619,6 +3639,10 @@ tt_run_engine(const char *dump_name, const char *input_file_name, time_t build_d
     hyph_word = xmalloc_array(str_number, hyph_size);
     hyph_list = xmalloc_array(int32_t, hyph_size);
     hyph_link = xmalloc_array(hyph_pointer, hyph_size);
+    hyph_cache_hits = 0;
+    hyph_cache_misses = 0;
+    shaping_calls = 0;
+    hash_entries_used = 0;
 
     /* First bit of initex handling: more allocations. */
 
@@ -3635,6 +3659,7 @@ tt_run_engine(const char *dump_name, const char *input_file_name, time_t build_d
         hash = yhash - hash_offset;
         hash[HASH_BASE].s0 = 0;
         hash[HASH_BASE].s1 = 0;
+        cs_index_reset();
 
         for (hash_used = HASH_BASE + 1; hash_used <= hash_top; hash_used++)
             hash[hash_used] = hash[HASH_BASE];
@@ -3755,7 +3780,11 @@ tt_run_engine(const char *dump_name, const char *input_file_name, time_t build_d
 
     no_new_control_sequence = true;
 
-    if (!in_initex_mode) {
+    /* In "preload" mode, INITEX starts from an existing format rather than
+     * from scratch, so that the input can extend that format and \dump the
+     * result. This is how document-specific preamble formats get built. */
+
+    if (!in_initex_mode || initex_preload_format) {
         if (!load_fmt_file())
             return history;
     }
@@ -192,10 +192,38 @@ conversion_error(int errcode)
 }
 
 
+/* Whether a line is already normalized, so that it needn't go through the
+ * normalizer: that's the case if it contains none of the characters that
+ * the normalizer might change or combine with their neighbors. */
+static bool
+is_normalized(const uint32_t* buf, int len, const Byte* unstable)
+{
+    uint32_t any = 0;
+    int i;
+
+    /* Most lines are pure ASCII, which is left alone by every normalization
+     * form. This loop has no early exit so that the compiler can vectorize
+     * it. */
+    for (i = 0; i < len; i++)
+        any |= buf[i];
+
+    if (any < 0x80)
+        return true;
+
+    for (i = 0; i < len; i++) {
+        if (buf[i] > 0xFFFF || (unstable[buf[i] >> 3] & (1 << (buf[i] & 7))))
+            return false;
+    }
+
+    return true;
+}
+
+
 static void
 apply_normalization(uint32_t* buf, int len, int norm)
 {
     static TECkit_Converter normalizers[2] = { NULL, NULL };
+    static Byte* unstable[2] = { NULL, NULL };
 
     TECkit_Status status;
     UInt32 inUsed, outUsed;
@@ -206,6 +234,18 @@ apply_normalization(uint32_t* buf, int len, int norm)
             &*normPtr);
         if (status != kStatus_NoError)
             _tt_abort ("failed to create normalizer: error code = %d", (int)status);
+
+        unstable[norm - 1] = xmalloc(kTriggerBitsSize);
+        if (TECkit_GetConverterTriggers(*normPtr, unstable[norm - 1]) != kStatus_NoError)
+            unstable[norm - 1] = mfree(unstable[norm - 1]);
+    }
+
+    if (unstable[norm - 1] != NULL && is_normalized(buf, len, unstable[norm - 1])) {
+        if (len > buf_size - first)
+            buffer_overflow();
+        memcpy(&buffer[first], buf, len * sizeof(*buffer));
+        last = first + len;
+        return;
     }
 
     status = TECkit_ConvertBuffer(*normPtr, (Byte*)buf, len * sizeof(UInt32), &inUsed,
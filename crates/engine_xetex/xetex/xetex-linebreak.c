@@ -2007,6 +2007,71 @@ try_break(int32_t pi, small_number break_type)
 }
 
 
+/* Long documents hyphenate the same vocabulary over and over, so we remember
+ * where the hyphens went for recently seen words. An entry is keyed on
+ * everything that determines the outcome of the exception lookup and the
+ * pattern walk: the language, \lefthyphenmin and \righthyphenmin, and the
+ * lowercased word itself. All later uses of `hyf` only look at whether an
+ * entry is odd, so a bitmask of the odd positions is all we need to keep.
+ * The table is direct-mapped and simply thrown away whenever the patterns or
+ * the exceptions change. */
+
+#define HYPH_CACHE_SIZE 4096 /* must be a power of 2 */
+#define HYPH_CACHE_MAX_LENGTH 32
+
+typedef struct {
+    unsigned char len; /* 0 marks an empty slot */
+    unsigned char lang;
+    unsigned char l_hyf;
+    unsigned char r_hyf;
+    uint64_t points;
+    int32_t chars[HYPH_CACHE_MAX_LENGTH];
+} hyph_cache_entry;
+
+static hyph_cache_entry *hyph_cache = NULL;
+
+void
+hyph_cache_reset(void)
+{
+    free(hyph_cache);
+    hyph_cache = NULL;
+}
+
+static hyph_cache_entry *
+hyph_cache_slot(void)
+{
+    uint32_t h = 2166136261U;
+    int32_t j;
+
+    if (hyph_cache == NULL)
+        hyph_cache = xcalloc(HYPH_CACHE_SIZE, sizeof(hyph_cache_entry));
+
+    h = (h ^ cur_lang) * 16777619U;
+    h = (h ^ (uint32_t) (l_hyf << 8 | r_hyf)) * 16777619U;
+
+    for (j = 1; j <= hn; j++)
+        h = (h ^ (uint32_t) hc[j]) * 16777619U;
+
+    h ^= h >> 15;
+    return &hyph_cache[h & (HYPH_CACHE_SIZE - 1)];
+}
+
+static bool
+hyph_cache_matches(const hyph_cache_entry *e)
+{
+    int32_t j;
+
+    if (e->len != hn || e->lang != cur_lang || e->l_hyf != l_hyf || e->r_hyf != r_hyf)
+        return false;
+
+    for (j = 1; j <= hn; j++) {
+        if (e->chars[j - 1] != hc[j])
+            return false;
+    }
+
+    return true;
+}
+
 static void
 hyphenate(void)
 {
@@ -2023,6 +2088,25 @@ hyphenate(void)
     hyph_pointer h;
     str_number k;
     pool_pointer u;
+    hyph_cache_entry *cache_slot = NULL;
+
+    if (hn <= HYPH_CACHE_MAX_LENGTH) {
+        cache_slot = hyph_cache_slot();
+
+        if (hyph_cache_matches(cache_slot)) {
+            hyph_cache_hits++;
+
+            if (cache_slot->points == 0)
+                return;
+
+            for (j = 0; j <= hn; j++)
+                hyf[j] = (cache_slot->points >> j) & 1;
+
+            goto found1;
+        }
+
+        hyph_cache_misses++;
+    }
 
     {
         register int32_t for_end;
@@ -2126,6 +2210,21 @@ not_found:
                 hyf[hn - j] = 0 /*:958 */ ;
             while (j++ < for_end);
     }
+    if (cache_slot != NULL) {
+        cache_slot->len = hn;
+        cache_slot->lang = cur_lang;
+        cache_slot->l_hyf = l_hyf;
+        cache_slot->r_hyf = r_hyf;
+        cache_slot->points = 0;
+
+        for (j = 1; j <= hn; j++)
+            cache_slot->chars[j - 1] = hc[j];
+
+        for (j = l_hyf; j <= hn - r_hyf; j++) {
+            if (odd(hyf[j]))
+                cache_slot->points |= (uint64_t) 1 << j;
+        }
+    }
     {
         register int32_t for_end;
         j = l_hyf;
@@ -43,6 +43,7 @@ XeTeX_pic.c
 #include "dpx-pdfdoc.h"
 #include "dpx-pdfdraw.h"
 #include "dpx-pdfobj.h"
+#include "dpx-pdfximage.h"
 #include "dpx-pngimage.h"
 #include "dpx-jpegimage.h"
 #include "dpx-bmpimage.h"
@@ -83,6 +84,13 @@ count_pdf_file_pages (void)
     if (handle == INVALID_HANDLE)
         return 0;
 
+    /* Tectonic: avoid parsing the file if we already know the answer. */
+    pages = pdf_ximage_get_cached_page_count(handle);
+    if (pages >= 0) {
+        ttstub_input_close(handle);
+        return pages;
+    }
+
     if ((pf = pdf_open(name_of_file, handle)) == NULL) {
         /* TODO: issue warning */
         ttstub_input_close(handle);
@@ -91,6 +99,7 @@ count_pdf_file_pages (void)
 
     pages = pdf_doc_get_page_count(pf);
     pdf_close(pf);
+    pdf_ximage_cache_page_count(handle, pages);
     ttstub_input_close(handle);
     return pages;
 }
@@ -100,18 +109,27 @@ static int
 pdf_get_rect (char *filename, rust_input_handle_t handle, int page_num, int pdf_box, real_rect* box)
 {
     int pages, dpx_options;
-    pdf_file *pf;
+    pdf_file *pf = NULL;
     pdf_obj *page;
     pdf_rect bbox;
     pdf_tmatrix matrix;
     pdf_coord p1, p2, p3, p4;
 
-    if ((pf = pdf_open(filename, handle)) == NULL) {
-        /* TODO: issue warning */
-        return -1;
-    }
+    /* Tectonic: the page count and page boxes may already be known from an
+     * earlier pass, or from xdvipdfmx, in which case we don't need to open the
+     * PDF at all. */
 
-    pages = pdf_doc_get_page_count(pf);
+    pages = pdf_ximage_get_cached_page_count(handle);
+
+    if (pages < 0) {
+        if ((pf = pdf_open(filename, handle)) == NULL) {
+            /* TODO: issue warning */
+            return -1;
+        }
+
+        pages = pdf_doc_get_page_count(pf);
+        pdf_ximage_cache_page_count(handle, pages);
+    }
 
     if (page_num > pages)
         page_num = pages;
@@ -143,15 +161,26 @@ pdf_get_rect (char *filename, rust_input_handle_t handle, int page_num, int pdf_
         break;
     }
 
-    page = pdf_doc_get_page(pf, page_num, dpx_options, &bbox, &matrix, NULL);
-    pdf_close(pf);
+    if (pdf_ximage_get_cached_page_info(handle, page_num, dpx_options, &bbox, &matrix) < 0) {
+        if (pf == NULL && (pf = pdf_open(filename, handle)) == NULL) {
+            /* TODO: issue warning */
+            return -1;
+        }
 
-    if (page == NULL) {
-        /* TODO: issue warning */
-        return -1;
+        page = pdf_doc_get_page(pf, page_num, dpx_options, &bbox, &matrix, NULL);
+
+        if (page == NULL) {
+            /* TODO: issue warning */
+            pdf_close(pf);
+            return -1;
+        }
+
+        pdf_release_obj(page);
+        pdf_ximage_cache_page_info(handle, page_num, dpx_options, &bbox, &matrix);
     }
 
-    pdf_release_obj(page);
+    if (pf != NULL)
+        pdf_close(pf);
 
     /* Image's attribute "bbox" here is affected by /Rotate entry of included
      * PDF page.
@@ -194,12 +223,20 @@ get_image_size_in_inches (rust_input_handle_t handle, double *width, double *hei
     unsigned int width_pix, height_pix;
     double xdensity, ydensity;
 
-    if (check_for_jpeg(handle))
-        err = jpeg_get_bbox(handle, &width_pix, &height_pix, &xdensity, &ydensity);
-    else if (check_for_bmp(handle))
-        err = bmp_get_bbox(handle, &width_pix, &height_pix, &xdensity, &ydensity);
-    else if (check_for_png(handle))
-        err = png_get_bbox(handle, &width_pix, &height_pix, &xdensity, &ydensity);
+    /* Tectonic: use the saved size if we've seen this image before. */
+    if (pdf_ximage_get_cached_bitmap_size(handle, &width_pix, &height_pix, &xdensity, &ydensity) == 0)
+        err = 0;
+    else {
+        if (check_for_jpeg(handle))
+            err = jpeg_get_bbox(handle, &width_pix, &height_pix, &xdensity, &ydensity);
+        else if (check_for_bmp(handle))
+            err = bmp_get_bbox(handle, &width_pix, &height_pix, &xdensity, &ydensity);
+        else if (check_for_png(handle))
+            err = png_get_bbox(handle, &width_pix, &height_pix, &xdensity, &ydensity);
+
+        if (err == 0)
+            pdf_ximage_cache_bitmap_size(handle, width_pix, height_pix, xdensity, ydensity);
+    }
 
     if (err) {
         *width = -1;
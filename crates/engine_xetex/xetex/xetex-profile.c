@@ -0,0 +1,672 @@
+/* tectonic/xetex-profile.c: opt-in profiling of macro expansion
+   Copyright 2026 the Tectonic Project
+   Licensed under the MIT License.
+*/
+
+/* We build a tree of "call paths" as the engine runs. A frame is pushed
+ * whenever a macro's replacement text or an input file goes onto the input
+ * stack, and popped when that level of the input stack is ended; when a macro
+ * is called straight from a file, an extra frame records the line it was
+ * called from. Elapsed time is always charged to the innermost frame, so
+ * each node of the tree ends up with its exclusive time, and inclusive times
+ * follow by summing over subtrees.
+ *
+ * At the end of the run we write out two files through the usual output
+ * API: `<jobname>.macros.folded`, with one line per call path in the
+ * "folded stacks" format understood by flame graph tools, and
+ * `<jobname>.macros.tsv`, with call counts and inclusive and exclusive times
+ * per control sequence, input file, and line. The "calls" of a line are the
+ * macro calls made from it; time spent reading a file outside of any macro is
+ * charged to the file, so lines only have inclusive times. Times are in
+ * microseconds. */
+
+#include "xetex-core.h"
+#include "xetex-xetexd.h"
+#include "xetex-profile.h"
+#include "tectonic_bridge_core.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+enum {
+    PROF_ROOT,
+    PROF_FILE,
+    PROF_LINE,
+    PROF_MACRO,
+};
+
+typedef struct {
+    int32_t parent;
+    int32_t kind;
+    int32_t value; /* file index, line number, or control sequence */
+    uint64_t calls;
+    uint64_t self_ns;
+} prof_node;
+
+typedef struct {
+    int32_t level; /* the value of input_ptr while the frame is active */
+    int32_t saved; /* the node to go back to when it ends */
+} prof_frame;
+
+static prof_node *nodes = NULL;
+static int32_t n_nodes = 0;
+static int32_t nodes_size = 0;
+
+/* open-addressed index of nodes by (parent, kind, value); slots hold node
+ * index + 1 */
+static int32_t *node_index = NULL;
+static uint32_t node_index_size = 0;
+
+static prof_frame *frames = NULL;
+static int32_t n_frames = 0;
+static int32_t frames_size = 0;
+
+static char **file_names = NULL;
+static int32_t n_file_names = 0;
+static int32_t file_names_size = 0;
+
+static int32_t cur_node = 0;
+static uint64_t last_ns = 0;
+
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/* Charge the time since the last event to the current node. */
+static void
+charge(void)
+{
+    uint64_t now = now_ns();
+
+    nodes[cur_node].self_ns += now - last_ns;
+    last_ns = now;
+}
+
+
+static uint32_t
+node_hash(int32_t parent, int32_t kind, int32_t value)
+{
+    uint32_t h = (uint32_t) parent * 0x9E3779B1U;
+
+    h ^= (uint32_t) kind * 0x85EBCA77U;
+    h ^= (uint32_t) value * 0xC2B2AE3DU;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6DU;
+    h ^= h >> 13;
+    return h;
+}
+
+
+static void
+index_node(int32_t n)
+{
+    uint32_t i = node_hash(nodes[n].parent, nodes[n].kind, nodes[n].value) & (node_index_size - 1);
+
+    while (node_index[i] != 0)
+        i = (i + 1) & (node_index_size - 1);
+
+    node_index[i] = n + 1;
+}
+
+
+static int32_t
+child_node(int32_t parent, int32_t kind, int32_t value)
+{
+    uint32_t i;
+    int32_t n;
+
+    i = node_hash(parent, kind, value) & (node_index_size - 1);
+
+    while (node_index[i] != 0) {
+        n = node_index[i] - 1;
+
+        if (nodes[n].parent == parent && nodes[n].kind == kind && nodes[n].value == value)
+            return n;
+
+        i = (i + 1) & (node_index_size - 1);
+    }
+
+    if (n_nodes == nodes_size) {
+        nodes_size *= 2;
+        nodes = xrealloc(nodes, nodes_size * sizeof(prof_node));
+    }
+
+    n = n_nodes++;
+    nodes[n].parent = parent;
+    nodes[n].kind = kind;
+    nodes[n].value = value;
+    nodes[n].calls = 0;
+    nodes[n].self_ns = 0;
+
+    if ((uint32_t) n_nodes * 2 > node_index_size) {
+        int32_t k;
+
+        free(node_index);
+        node_index_size *= 2;
+        node_index = xcalloc(node_index_size, sizeof(int32_t));
+
+        for (k = 0; k < n_nodes; k++)
+            index_node(k);
+    } else {
+        node_index[i] = n + 1;
+    }
+
+    return n;
+}
+
+
+static void
+ensure_started(void)
+{
+    if (nodes != NULL)
+        return;
+
+    nodes_size = 1024;
+    nodes = xmalloc_array(prof_node, nodes_size);
+    node_index_size = 4096;
+    node_index = xcalloc(node_index_size, sizeof(int32_t));
+    frames_size = 64;
+    frames = xmalloc_array(prof_frame, frames_size);
+
+    memset(&nodes[0], 0, sizeof(prof_node));
+    nodes[0].kind = PROF_ROOT;
+    n_nodes = 1;
+    n_frames = 0;
+    cur_node = 0;
+    last_ns = now_ns();
+}
+
+
+static void
+push_frame(int32_t node)
+{
+    if (n_frames == frames_size) {
+        frames_size *= 2;
+        frames = xrealloc(frames, frames_size * sizeof(prof_frame));
+    }
+
+    frames[n_frames].level = input_ptr;
+    frames[n_frames].saved = cur_node;
+    n_frames++;
+
+    nodes[node].calls++;
+    cur_node = node;
+}
+
+
+void
+profile_macro_call(int32_t cs)
+{
+    int32_t parent;
+
+    ensure_started();
+    charge();
+
+    /* The level below the macro's is the one that called it. */
+
+    parent = cur_node;
+    if (input_ptr > 0 && input_stack[input_ptr - 1].state != TOKEN_LIST && nodes[cur_node].kind == PROF_FILE) {
+        parent = child_node(cur_node, PROF_LINE, line);
+        nodes[parent].calls++;
+    }
+
+    push_frame(child_node(parent, PROF_MACRO, cs));
+}
+
+
+void
+profile_start_input(void)
+{
+    char *name;
+    int32_t k;
+
+    ensure_started();
+    charge();
+
+    name = gettexstring(full_source_filename_stack[in_open]);
+
+    for (k = 0; k < n_file_names; k++) {
+        if (streq_ptr(file_names[k], name))
+            break;
+    }
+
+    if (k < n_file_names) {
+        free(name);
+    } else {
+        if (n_file_names == file_names_size) {
+            file_names_size = file_names_size == 0 ? 16 : 2 * file_names_size;
+            file_names = xrealloc(file_names, file_names_size * sizeof(char *));
+        }
+
+        file_names[n_file_names++] = name;
+    }
+
+    push_frame(child_node(cur_node, PROF_FILE, k));
+}
+
+
+void
+profile_end_level(void)
+{
+    if (nodes == NULL)
+        return;
+
+    /* Levels are ended strictly in order, so anything above the current one
+     * is stale; that shouldn't happen, but be robust about it. */
+
+    while (n_frames > 0 && frames[n_frames - 1].level > input_ptr) {
+        n_frames--;
+        cur_node = frames[n_frames].saved;
+    }
+
+    if (n_frames > 0 && frames[n_frames - 1].level == input_ptr) {
+        charge();
+        n_frames--;
+        cur_node = frames[n_frames].saved;
+    }
+}
+
+
+/* Output */
+
+static void
+append(char **buf, size_t *len, size_t *size, const char *s, size_t n)
+{
+    if (*len + n + 1 > *size) {
+        *size = 2 * (*len + n + 1);
+        *buf = xrealloc(*buf, *size);
+    }
+
+    memcpy(*buf + *len, s, n);
+    *len += n;
+    (*buf)[*len] = '\0';
+}
+
+
+static void
+append_usv(char **buf, size_t *len, size_t *size, int32_t c)
+{
+    char u[4];
+    size_t n;
+
+    if (c < 0x80) {
+        u[0] = c;
+        n = 1;
+    } else if (c < 0x800) {
+        u[0] = 0xC0 | (c >> 6);
+        u[1] = 0x80 | (c & 0x3F);
+        n = 2;
+    } else if (c < 0x10000) {
+        u[0] = 0xE0 | (c >> 12);
+        u[1] = 0x80 | ((c >> 6) & 0x3F);
+        u[2] = 0x80 | (c & 0x3F);
+        n = 3;
+    } else {
+        u[0] = 0xF0 | (c >> 18);
+        u[1] = 0x80 | ((c >> 12) & 0x3F);
+        u[2] = 0x80 | ((c >> 6) & 0x3F);
+        u[3] = 0x80 | (c & 0x3F);
+        n = 4;
+    }
+
+    append(buf, len, size, u, n);
+}
+
+
+/* The name of a control sequence, as sprint_cs() would show it with the
+ * default escape character. */
+static char *
+cs_label(int32_t p)
+{
+    char *buf = NULL, *s;
+    size_t len = 0, size = 0;
+    str_number text;
+
+    append(&buf, &len, &size, "", 0);
+
+    if (p < HASH_BASE) {
+        if (p < SINGLE_BASE) {
+            append_usv(&buf, &len, &size, p - ACTIVE_BASE);
+        } else if (p < NULL_CS) {
+            append(&buf, &len, &size, "\\", 1);
+            append_usv(&buf, &len, &size, p - SINGLE_BASE);
+        } else {
+            append(&buf, &len, &size, "\\csname\\endcsname", 17);
+        }
+
+        return buf;
+    }
+
+    if (p >= PRIM_EQTB_BASE && p < FROZEN_NULL_FONT)
+        text = prim[p - PRIM_EQTB_BASE].s1 - 1;
+    else
+        text = hash[p].s1;
+
+    append(&buf, &len, &size, "\\", 1);
+
+    if (text >= 65536L && text < str_ptr) {
+        s = gettexstring(text);
+        append(&buf, &len, &size, s, strlen(s));
+        free(s);
+    } else if (text > 0 && text < 65536L) {
+        append_usv(&buf, &len, &size, text);
+    }
+
+    return buf;
+}
+
+
+static char *
+node_label(int32_t n)
+{
+    char *buf = NULL;
+    size_t len = 0, size = 0;
+    char line_buf[16];
+    const char *file;
+
+    switch (nodes[n].kind) {
+    case PROF_FILE:
+        file = file_names[nodes[n].value];
+        append(&buf, &len, &size, file, strlen(file));
+        break;
+
+    case PROF_LINE:
+        file = file_names[nodes[nodes[n].parent].value];
+        snprintf(line_buf, sizeof(line_buf), ":%d", nodes[n].value);
+        append(&buf, &len, &size, file, strlen(file));
+        append(&buf, &len, &size, line_buf, strlen(line_buf));
+        break;
+
+    case PROF_MACRO:
+        return cs_label(nodes[n].value);
+
+    default:
+        append(&buf, &len, &size, "(engine)", 8);
+        break;
+    }
+
+    return buf;
+}
+
+
+/* Frames are separated by semicolons and the count by the last space, so
+ * keep semicolons and line breaks out of labels. */
+static void
+sanitize_label(char *s)
+{
+    for (; *s; s++) {
+        if (*s == ';')
+            *s = ':';
+        else if ((unsigned char) *s < ' ')
+            *s = '?';
+    }
+}
+
+
+static void
+write_folded(const char *path, char **labels)
+{
+    rust_output_handle_t out;
+    int32_t *chain;
+    int32_t n, k, depth;
+
+    out = ttstub_output_open(path, 0);
+    if (out == INVALID_HANDLE)
+        return;
+
+    chain = xmalloc_array(int32_t, n_nodes);
+
+    for (n = 1; n < n_nodes; n++) {
+        uint64_t us = (nodes[n].self_ns + 500) / 1000;
+
+        if (us == 0)
+            continue;
+
+        depth = 0;
+        for (k = n; k != 0; k = nodes[k].parent)
+            chain[depth++] = k;
+
+        while (depth > 0) {
+            depth--;
+            ttstub_output_write(out, labels[chain[depth]], strlen(labels[chain[depth]]));
+            if (depth > 0)
+                ttstub_output_write(out, ";", 1);
+        }
+
+        ttstub_fprintf(out, " %llu\n", (unsigned long long) us);
+    }
+
+    free(chain);
+    ttstub_output_close(out);
+}
+
+
+/* Rows of the summary, one per control sequence, input file, or line of an
+ * input file. Lines are keyed by their file and line number. */
+typedef struct {
+    int32_t kind;
+    int32_t key1;
+    int32_t key2;
+    int32_t node; /* a representative node, for the label */
+    uint64_t calls;
+    uint64_t incl_ns;
+    uint64_t excl_ns;
+} prof_summary;
+
+
+static void
+summary_key(int32_t n, int32_t *key1, int32_t *key2)
+{
+    if (nodes[n].kind == PROF_LINE) {
+        *key1 = nodes[nodes[n].parent].value;
+        *key2 = nodes[n].value;
+    } else {
+        *key1 = nodes[n].value;
+        *key2 = 0;
+    }
+}
+
+
+static int
+compare_keys(const void *a, const void *b)
+{
+    const prof_summary *x = a, *y = b;
+
+    if (x->kind != y->kind)
+        return x->kind - y->kind;
+    if (x->key1 != y->key1)
+        return x->key1 < y->key1 ? -1 : 1;
+    if (x->key2 != y->key2)
+        return x->key2 < y->key2 ? -1 : 1;
+    return 0;
+}
+
+
+static int
+compare_times(const void *a, const void *b)
+{
+    const prof_summary *x = a, *y = b;
+
+    if (x->incl_ns != y->incl_ns)
+        return x->incl_ns < y->incl_ns ? 1 : -1;
+    return compare_keys(a, b);
+}
+
+
+static const char *
+kind_name(int32_t kind)
+{
+    switch (kind) {
+    case PROF_FILE:
+        return "file";
+    case PROF_LINE:
+        return "line";
+    default:
+        return "macro";
+    }
+}
+
+
+static void
+write_summary(const char *path, uint64_t *total_ns)
+{
+    rust_output_handle_t out;
+    prof_summary *sums;
+    int32_t n_sums = 0, n_merged = 0;
+    int32_t n, k;
+
+    out = ttstub_output_open(path, 0);
+    if (out == INVALID_HANDLE)
+        return;
+
+    sums = xmalloc_array(prof_summary, n_nodes);
+
+    for (n = 1; n < n_nodes; n++) {
+        bool outermost = true;
+        int32_t key1, key2, k1, k2;
+
+        summary_key(n, &key1, &key2);
+
+        /* Only count the inclusive time of the outermost activation of a
+         * recursive macro, or a file or line that's reached again from
+         * itself. */
+
+        for (k = nodes[n].parent; k != 0; k = nodes[k].parent) {
+            if (nodes[k].kind != nodes[n].kind)
+                continue;
+
+            summary_key(k, &k1, &k2);
+
+            if (k1 == key1 && k2 == key2) {
+                outermost = false;
+                break;
+            }
+        }
+
+        sums[n_sums].kind = nodes[n].kind;
+        sums[n_sums].key1 = key1;
+        sums[n_sums].key2 = key2;
+        sums[n_sums].node = n;
+        sums[n_sums].calls = nodes[n].calls;
+        sums[n_sums].excl_ns = nodes[n].self_ns;
+        sums[n_sums].incl_ns = outermost ? total_ns[n] : 0;
+        n_sums++;
+    }
+
+    /* Merge the entries for each control sequence, file, and line, then put
+     * the most expensive first. */
+
+    qsort(sums, n_sums, sizeof(prof_summary), compare_keys);
+
+    for (n = 0; n < n_sums; n++) {
+        if (n_merged > 0 && compare_keys(&sums[n_merged - 1], &sums[n]) == 0) {
+            sums[n_merged - 1].calls += sums[n].calls;
+            sums[n_merged - 1].incl_ns += sums[n].incl_ns;
+            sums[n_merged - 1].excl_ns += sums[n].excl_ns;
+        } else {
+            sums[n_merged++] = sums[n];
+        }
+    }
+
+    qsort(sums, n_merged, sizeof(prof_summary), compare_times);
+
+    ttstub_fprintf(out, "calls\tinclusive_us\texclusive_us\tkind\tname\n");
+
+    for (n = 0; n < n_merged; n++) {
+        char *label = node_label(sums[n].node);
+
+        ttstub_fprintf(out, "%llu\t%llu\t%llu\t%s\t%s\n",
+                       (unsigned long long) sums[n].calls,
+                       (unsigned long long) ((sums[n].incl_ns + 500) / 1000),
+                       (unsigned long long) ((sums[n].excl_ns + 500) / 1000),
+                       kind_name(sums[n].kind),
+                       label);
+        free(label);
+    }
+
+    free(sums);
+    ttstub_output_close(out);
+}
+
+
+void
+profile_finish(void)
+{
+    char **labels;
+    uint64_t *total_ns;
+    char *job, *path;
+    int32_t n;
+
+    if (nodes == NULL || job_name == 0)
+        return;
+
+    charge();
+
+    total_ns = xmalloc_array(uint64_t, n_nodes);
+    labels = xmalloc_array(char *, n_nodes);
+
+    for (n = 0; n < n_nodes; n++) {
+        total_ns[n] = nodes[n].self_ns;
+        labels[n] = node_label(n);
+        sanitize_label(labels[n]);
+    }
+
+    /* Children are always created after their parents. */
+
+    for (n = n_nodes - 1; n > 0; n--)
+        total_ns[nodes[n].parent] += total_ns[n];
+
+    job = gettexstring(job_name);
+    path = xmalloc(strlen(job) + 16);
+
+    sprintf(path, "%s.macros.folded", job);
+    write_folded(path, labels);
+
+    sprintf(path, "%s.macros.tsv", job);
+    write_summary(path, total_ns);
+
+    for (n = 0; n < n_nodes; n++)
+        free(labels[n]);
+
+    free(labels);
+    free(total_ns);
+    free(job);
+    free(path);
+    profile_reset();
+}
+
+
+void
+profile_reset(void)
+{
+    int32_t k;
+
+    for (k = 0; k < n_file_names; k++)
+        free(file_names[k]);
+
+    free(file_names);
+    file_names = NULL;
+    n_file_names = file_names_size = 0;
+
+    free(nodes);
+    nodes = NULL;
+    n_nodes = nodes_size = 0;
+
+    free(node_index);
+    node_index = NULL;
+    node_index_size = 0;
+
+    free(frames);
+    frames = NULL;
+    n_frames = frames_size = 0;
+
+    cur_node = 0;
+}
@@ -0,0 +1,24 @@
+/* tectonic/xetex-profile.h: opt-in profiling of macro expansion
+   Copyright 2026 the Tectonic Project
+   Licensed under the MIT License.
+*/
+
+#ifndef TECTONIC_XETEX_PROFILE_H
+#define TECTONIC_XETEX_PROFILE_H
+
+#include "xetex-core.h"
+
+BEGIN_EXTERN_C
+
+/* The hooks in the engine check `macro_profile_enabled` before calling any
+ * of these, so that the profiler costs a single branch when it's off. */
+
+void profile_macro_call(int32_t cs);
+void profile_start_input(void);
+void profile_end_level(void);
+void profile_finish(void);
+void profile_reset(void);
+
+END_EXTERN_C
+
+#endif /* not TECTONIC_XETEX_PROFILE_H */
@@ -6,6 +6,7 @@
 #include "xetex-core.h"
 #include "xetex-xetexd.h"
 #include "xetex-synctex.h"
+#include "xetex-profile.h"
 
 #include <stdio.h> /* for EOF */
 
@@ -203,6 +204,63 @@ void flush_list(int32_t p)
     }
 }
 
+/* Freed variable-size nodes of the common small sizes (glue, kern, penalty,
+ * box, short native words, ...) are kept on per-size stacks instead of being
+ * handed back to the rover, so that get_node() can usually pop one rather
+ * than walk the free list. A stacked node is chained through its link field,
+ * which is never MAX_HALFWORD, so to the rover it still looks like it is in
+ * use and won't be merged into its neighbours. Everything on the stacks is
+ * returned to the rover before the free list is sorted for dumping, so the
+ * format file is not affected, and before we would grow memory. That is
+ * later than the rover would have merged the nodes, though, so when nodes of
+ * many sizes are freed in no particular order, the free space is more
+ * fragmented and `lo_mem_max` can end up noticeably higher than without the
+ * stacks. */
+
+#define NODE_CACHE_SIZES 32
+
+static int32_t node_cache[NODE_CACHE_SIZES];
+static int32_t node_cache_count = 0;
+
+void node_cache_reset(void)
+{
+    int32_t k;
+
+    for (k = 0; k < NODE_CACHE_SIZES; k++)
+        node_cache[k] = TEX_NULL;
+
+    node_cache_count = 0;
+}
+
+static void
+release_node(int32_t p, int32_t s)
+{
+    int32_t q;
+    mem[p].b32.s0 = s;
+    mem[p].b32.s1 = MAX_HALFWORD;
+    q = mem[rover + 1].b32.s0;
+    mem[p + 1].b32.s0 = q;
+    mem[p + 1].b32.s1 = rover;
+    mem[rover + 1].b32.s0 = p;
+    mem[q + 1].b32.s1 = p;
+}
+
+static void
+node_cache_flush(void)
+{
+    int32_t k, p;
+
+    for (k = 0; k < NODE_CACHE_SIZES; k++) {
+        while (node_cache[k] != TEX_NULL) {
+            p = node_cache[k];
+            node_cache[k] = mem[p].b32.s1;
+            release_node(p, k);
+        }
+    }
+
+    node_cache_count = 0;
+}
+
 int32_t get_node(int32_t s)
 {
     int32_t p;
@@ -210,6 +268,13 @@ int32_t get_node(int32_t s)
     int32_t r;
     int32_t t;
 
+    if (s < NODE_CACHE_SIZES && node_cache[s] != TEX_NULL) {
+        r = node_cache[s];
+        node_cache[s] = mem[r].b32.s1;
+        node_cache_count--;
+        goto found;
+    }
+
 restart:
     p = rover;
 
@@ -243,6 +308,10 @@ restart:
         mem[p].b32.s0 = q - /*:131 */ p;
         p = mem[p + 1].b32.s1;
     } while (!(p == rover));
+    if (node_cache_count > 0) {
+        node_cache_flush();
+        goto restart;
+    }
     if (s == 0x40000000) {
         return MAX_HALFWORD;
     }
@@ -283,14 +352,14 @@ found:
 
 void free_node(int32_t p, int32_t s)
 {
-    int32_t q;
-    mem[p].b32.s0 = s;
-    mem[p].b32.s1 = MAX_HALFWORD;
-    q = mem[rover + 1].b32.s0;
-    mem[p + 1].b32.s0 = q;
-    mem[p + 1].b32.s1 = rover;
-    mem[rover + 1].b32.s0 = p;
-    mem[q + 1].b32.s1 = p;
+    if (s < NODE_CACHE_SIZES) {
+        mem[p].b32.s1 = node_cache[s];
+        node_cache[s] = p;
+        node_cache_count++;
+        return;
+    }
+
+    release_node(p, s);
 }
 
 int32_t new_null_box(void)
@@ -3691,6 +3760,166 @@ void not_native_font_error(int32_t cmd, int32_t c, int32_t f)
 /*:1434*/
 
 
+/* Control-sequence lookup index.
+ *
+ * TeX's hash table has only HASH_PRIME primary buckets, so with the tens of
+ * thousands of control sequences in a modern (expl3) format the collision
+ * chains get long, and every lookup walks them comparing strings. The
+ * positions of control sequences in the table are baked into formats, so we
+ * leave the table alone and keep a growable open-addressed index alongside it
+ * that maps (bucket, name) straight to a table position, using a stronger
+ * hash whose value is cached in each entry. We also track the tail of each
+ * chain, so that inserting a new control sequence doesn't walk the chain
+ * either. The table layout, and hence the format, is exactly what the
+ * classic algorithm produces.
+ *
+ * The index is rebuilt from the table on the first lookup after the table is
+ * (re)allocated; see `cs_index_reset`. */
+
+typedef struct {
+    int32_t p; /* position in `hash`, or 0 if this slot is empty */
+    int32_t bucket; /* the TeX hash bucket that the chain containing `p` starts at */
+    uint32_t hv; /* cached hash of the bucket and name */
+} cs_index_entry;
+
+#define CS_INDEX_INITIAL_SIZE 16384 /* must be a power of two */
+
+static cs_index_entry *cs_index = NULL;
+static uint32_t cs_index_mask = 0;
+static uint32_t cs_index_count = 0;
+static int32_t *cs_chain_tail = NULL;
+
+
+void
+cs_index_reset(void)
+{
+    free(cs_index);
+    cs_index = NULL;
+    free(cs_chain_tail);
+    cs_chain_tail = NULL;
+    cs_index_mask = 0;
+    cs_index_count = 0;
+}
+
+
+/* FNV-1a over the UTF-16 code units of the name, finished with a full
+ * avalanche so that the low bits are good enough to index with. Hashing
+ * code units rather than characters makes this agree with `str_eq_buf`. */
+
+static inline uint32_t
+cs_hash_unit(uint32_t hv, uint32_t unit)
+{
+    hv = (hv ^ (unit & 0xFF)) * 16777619U;
+    return (hv ^ (unit >> 8)) * 16777619U;
+}
+
+
+static inline uint32_t
+cs_hash_finish(uint32_t hv)
+{
+    hv ^= hv >> 16;
+    hv *= 0x85EBCA6BU;
+    hv ^= hv >> 13;
+    hv *= 0xC2B2AE35U;
+    return hv ^ (hv >> 16);
+}
+
+
+static uint32_t
+cs_hash_buf(int32_t j, int32_t l, int32_t bucket)
+{
+    uint32_t hv = 2166136261U ^ (uint32_t) bucket;
+    int32_t k;
+
+    for (k = j; k < j + l; k++) {
+        if (buffer[k] >= 65536L) {
+            hv = cs_hash_unit(hv, 0xD800 + (buffer[k] - 65536L) / 1024);
+            hv = cs_hash_unit(hv, 0xDC00 + (buffer[k] - 65536L) % 1024);
+        } else {
+            hv = cs_hash_unit(hv, buffer[k]);
+        }
+    }
+
+    return cs_hash_finish(hv);
+}
+
+
+static uint32_t
+cs_hash_str(str_number s, int32_t bucket)
+{
+    uint32_t hv = 2166136261U ^ (uint32_t) bucket;
+    pool_pointer k;
+
+    for (k = str_start[s - 65536L]; k < str_start[s + 1 - 65536L]; k++)
+        hv = cs_hash_unit(hv, str_pool[k]);
+
+    return cs_hash_finish(hv);
+}
+
+
+static void
+cs_index_add(int32_t p, int32_t bucket, uint32_t hv)
+{
+    uint32_t slot;
+
+    if (2 * (cs_index_count + 1) > cs_index_mask + 1) {
+        cs_index_entry *old = cs_index;
+        uint32_t old_size = cs_index_mask + 1;
+        uint32_t i;
+
+        cs_index_mask = 2 * old_size - 1;
+        cs_index = xcalloc(cs_index_mask + 1, sizeof(cs_index_entry));
+
+        for (i = 0; i < old_size; i++) {
+            if (old[i].p == 0)
+                continue;
+
+            for (slot = old[i].hv & cs_index_mask; cs_index[slot].p != 0; slot = (slot + 1) & cs_index_mask)
+                ;
+            cs_index[slot] = old[i];
+        }
+
+        free(old);
+    }
+
+    for (slot = hv & cs_index_mask; cs_index[slot].p != 0; slot = (slot + 1) & cs_index_mask)
+        ;
+
+    cs_index[slot].p = p;
+    cs_index[slot].bucket = bucket;
+    cs_index[slot].hv = hv;
+    cs_index_count++;
+}
+
+
+static void
+cs_index_build(void)
+{
+    int32_t h, p;
+
+    cs_index_mask = CS_INDEX_INITIAL_SIZE - 1;
+    cs_index_count = 0;
+    cs_index = xcalloc(CS_INDEX_INITIAL_SIZE, sizeof(cs_index_entry));
+    cs_chain_tail = xmalloc_array(int32_t, HASH_PRIME);
+
+    for (h = 0; h < HASH_PRIME; h++) {
+        p = h + HASH_BASE;
+
+        while (true) {
+            if (hash[p].s1 > 0)
+                cs_index_add(p, h, cs_hash_str(hash[p].s1, h));
+
+            if (hash[p].s0 == 0)
+                break;
+
+            p = hash[p].s0;
+        }
+
+        cs_chain_tail[h] = p;
+    }
+}
+
+
 int32_t
 id_lookup(int32_t j, int32_t l)
 {
@@ -3699,6 +3928,7 @@ id_lookup(int32_t j, int32_t l)
     int32_t p;
     int32_t k;
     int32_t ll;
+    uint32_t hv, slot;
 
     h = 0;
 
@@ -3708,7 +3938,6 @@ id_lookup(int32_t j, int32_t l)
             h = h - 8501;
     }
 
-    p = h + HASH_BASE;
     ll = l;
 
     for (d = 0; d <= l - 1; d++) {
@@ -3716,68 +3945,75 @@ id_lookup(int32_t j, int32_t l)
             ll++;
     }
 
-    while (true) {
-        if (hash[p].s1 > 0) {
-            if (length(hash[p].s1) == ll) {
-                if (str_eq_buf(hash[p].s1, j))
-                    goto found;
-            }
-        }
+    if (cs_index == NULL)
+        cs_index_build();
 
-        if (hash[p].s0 == 0) {
-            if (no_new_control_sequence) {
-                p = UNDEFINED_CONTROL_SEQUENCE;
-            } else { /*269:*/
-                if (hash[p].s1 > 0) {
-                    if (hash_high < hash_extra) {
-                        hash_high++;
-                        hash[p].s0 = hash_high + EQTB_SIZE;
-                        p = hash_high + EQTB_SIZE;
-                    } else {
-                        do {
-                            if (hash_used == HASH_BASE)
-                                overflow("hash size", HASH_SIZE + hash_extra);
-                            hash_used--;
-                        } while (hash[hash_used].s1 != 0);
+    hv = cs_hash_buf(j, l, h);
 
-                        hash[p].s0 = hash_used;
-                        p = hash_used;
-                    }
-                }
+    for (slot = hv & cs_index_mask; cs_index[slot].p != 0; slot = (slot + 1) & cs_index_mask) {
+        p = cs_index[slot].p;
 
-                if (pool_ptr + ll > pool_size)
-                    overflow("pool size", pool_size - init_pool_ptr);
+        if (cs_index[slot].hv == hv && cs_index[slot].bucket == h && length(hash[p].s1) == ll
+            && str_eq_buf(hash[p].s1, j))
+            return p;
+    }
 
-                d = cur_length();
+    if (no_new_control_sequence)
+        return UNDEFINED_CONTROL_SEQUENCE;
 
-                while (pool_ptr > str_start[str_ptr - TOO_BIG_CHAR]) {
-                    pool_ptr--;
-                    str_pool[pool_ptr + l] = str_pool[pool_ptr];
-                }
+    /*269:*/
+    /* Once `hash_extra` is used up, new entries take the heads of empty
+     * buckets, so another bucket's chain may have been appended to this one
+     * since its tail was cached. */
+    p = cs_chain_tail[h];
 
-                for (k = j; k <= j + l - 1; k++) {
-                    if (buffer[k] < 65536L) {
-                        str_pool[pool_ptr] = buffer[k];
-                        pool_ptr++;
-                    } else {
-                        str_pool[pool_ptr] = 0xD800 + (buffer[k] - 65536L) / 1024;
-                        pool_ptr++;
-                        str_pool[pool_ptr] = 0xDC00 + (buffer[k] - 65536L) % 1024;
-                        pool_ptr++;
-                    }
-                }
+    while (hash[p].s0 != 0)
+        p = hash[p].s0;
 
-                hash[p].s1 = make_string();
-                pool_ptr += d;
-            }
-            goto found;
+    if (hash[p].s1 > 0) {
+        if (hash_high < hash_extra) {
+            hash_high++;
+            hash[p].s0 = hash_high + EQTB_SIZE;
+            p = hash_high + EQTB_SIZE;
+        } else {
+            do {
+                if (hash_used == HASH_BASE)
+                    overflow("hash size", HASH_SIZE + hash_extra);
+                hash_used--;
+            } while (hash[hash_used].s1 != 0);
 
+            hash[p].s0 = hash_used;
+            p = hash_used;
         }
+    }
 
-        p = hash[p].s0;
+    if (pool_ptr + ll > pool_size)
+        overflow("pool size", pool_size - init_pool_ptr);
+
+    d = cur_length();
+
+    while (pool_ptr > str_start[str_ptr - TOO_BIG_CHAR]) {
+        pool_ptr--;
+        str_pool[pool_ptr + l] = str_pool[pool_ptr];
     }
 
-found:
+    for (k = j; k <= j + l - 1; k++) {
+        if (buffer[k] < 65536L) {
+            str_pool[pool_ptr] = buffer[k];
+            pool_ptr++;
+        } else {
+            str_pool[pool_ptr] = 0xD800 + (buffer[k] - 65536L) / 1024;
+            pool_ptr++;
+            str_pool[pool_ptr] = 0xDC00 + (buffer[k] - 65536L) % 1024;
+            pool_ptr++;
+        }
+    }
+
+    hash[p].s1 = make_string();
+    pool_ptr += d;
+
+    cs_chain_tail[h] = p;
+    cs_index_add(p, h, hv);
     return p;
 }
 
@@ -4932,6 +5168,9 @@ begin_token_list(int32_t p, uint16_t t)
 
 void end_token_list(void)
 {
+    if (macro_profile_enabled)
+        profile_end_level();
+
     if (cur_input.index >= BACKED_UP) {
         if (cur_input.index <= INSERTED)
             flush_list(cur_input.start);
@@ -5035,6 +5274,9 @@ void begin_file_reading(void)
 void
 end_file_reading(void)
 {
+    if (macro_profile_enabled)
+        profile_end_level();
+
     first = cur_input.start;
     line = line_stack[cur_input.index];
 
@@ -5969,6 +6211,10 @@ macro_call(void)
 
     begin_token_list(ref_count, MACRO);
     cur_input.name = warning_index;
+
+    if (macro_profile_enabled)
+        profile_macro_call(warning_index);
+
     cur_input.loc = mem[r].b32.s1;
 
     if (n > 0) {
@@ -11053,6 +11299,9 @@ start_input(const char *primary_input_name)
 
     synctex_start_input();
 
+    if (macro_profile_enabled)
+        profile_start_input();
+
     line = 1;
     input_line(input_file[cur_input.index]);
     cur_input.limit = last;
@@ -18430,6 +18679,9 @@ close_files_and_terminate(void)
     finalize_dvi_file();
     synctex_terminate(log_opened);
 
+    if (macro_profile_enabled)
+        profile_finish();
+
     if (log_opened) {
         ttstub_output_putc (log_file, '\n');
         ttstub_output_close (log_file);
@@ -394,6 +394,7 @@ extern int32_t first;
 extern int32_t last;
 extern int32_t max_buf_stack;
 extern bool in_initex_mode;
+extern bool initex_preload_format;
 extern int32_t error_line;
 extern int32_t half_error_line;
 extern int32_t max_print_line;
@@ -643,6 +644,7 @@ extern str_number *hyph_word;
 extern int32_t *hyph_list;
 extern hyph_pointer *hyph_link;
 extern int32_t hyph_count;
+extern uint64_t hyph_cache_hits, hyph_cache_misses;
 extern int32_t hyph_next;
 extern trie_opcode trie_used[256];
 extern unsigned char trie_op_lang[TRIE_OP_SIZE + 1];
@@ -722,6 +724,9 @@ extern scaled_t delta;
 extern int synctex_enabled;
 extern bool used_tectonic_coda_tokens;
 extern bool semantic_pagination_enabled;
+extern int macro_profile_enabled;
+extern uint64_t shaping_calls;
+extern int32_t hash_entries_used;
 extern bool gave_char_warning_help;
 
 /*:1683*/
@@ -741,6 +746,7 @@ void show_token_list(int32_t p, int32_t q, int32_t l);
 void runaway(void);
 int32_t get_avail(void);
 void flush_list(int32_t p);
+void node_cache_reset(void);
 int32_t get_node(int32_t s);
 void free_node(int32_t p, int32_t s);
 int32_t new_null_box(void);
@@ -794,6 +800,7 @@ void not_aat_gr_font_error(int32_t cmd, int32_t c, int32_t f);
 void not_ot_font_error(int32_t cmd, int32_t c, int32_t f);
 void not_native_font_error(int32_t cmd, int32_t c, int32_t f);
 void show_eqtb(int32_t n);
+void cs_index_reset(void);
 int32_t id_lookup(int32_t j, int32_t l);
 int32_t prim_lookup(str_number s);
 void restore_trace(int32_t p, str_number s);
@@ -946,6 +953,7 @@ void trie_pack(trie_pointer p);
 void trie_fix(trie_pointer p);
 void init_trie(void);
 void line_break(bool d);
+void hyph_cache_reset(void);
 bool eTeX_enabled(bool b, uint16_t j, int32_t k);
 void show_save_groups(void);
 int32_t prune_page_top(int32_t p, bool s);
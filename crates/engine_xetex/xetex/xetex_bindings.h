@@ -24,6 +24,8 @@ extern "C" {
 
 extern int tt_xetex_set_int_variable(const char *var_name, int value);
 
+extern int tt_xetex_get_stat(const char *stat_name, uint64_t *value);
+
 extern int tt_engine_xetex_main(ttbc_state_t *api,
                                 const char *dump_name,
                                 const char *input_file_name,
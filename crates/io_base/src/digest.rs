@@ -13,6 +13,7 @@ use thiserror::Error as ThisError;
 
 pub use sha2::Digest;
 pub use sha2::Sha256 as DigestComputer;
+use xxhash_rust::xxh3::{xxh3_128, Xxh3Default};
 
 /// Errors that are generic to Tectonic's framework, but not capturable as
 /// IoErrors.
@@ -74,7 +75,7 @@ pub fn create() -> DigestComputer {
 
 /// A wrapper for a fixed-size byte array representing a digest computed with
 /// the default implementation.
-#[derive(Copy, Clone, Debug, Eq, PartialEq)]
+#[derive(Copy, Clone, Debug, Eq, Hash, PartialEq)]
 pub struct DigestData([u8; N_BYTES]);
 
 impl DigestData {
@@ -127,3 +128,73 @@ impl From<DigestComputer> for DigestData {
         result
     }
 }
+
+// Stream digests: XXH3.
+
+/// A fast, non-cryptographic digest of the data that passed through an I/O
+/// stream.
+///
+/// Every byte that the engines read or write goes through one of these, and
+/// they're only used to tell whether a file changed from one pass to the
+/// next, so we use a hash that runs at memory bandwidth rather than SHA256.
+/// Use [`DigestData`] wherever a digest identifies content persistently, as
+/// with bundles and cached formats.
+#[derive(Copy, Clone, Debug, Eq, Hash, PartialEq)]
+pub struct StreamDigest(u128);
+
+impl StreamDigest {
+    /// Create a digest of a zero-size byte stream.
+    pub fn of_nothing() -> StreamDigest {
+        StreamDigest(xxh3_128(&[]))
+    }
+}
+
+impl fmt::Display for StreamDigest {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(f, "{:032x}", self.0)
+    }
+}
+
+/// Computes a [`StreamDigest`] incrementally.
+#[derive(Clone, Default)]
+pub struct StreamDigestComputer(Xxh3Default);
+
+impl StreamDigestComputer {
+    /// Add data to the digest.
+    pub fn update(&mut self, data: &[u8]) {
+        self.0.update(data);
+    }
+
+    /// Get the digest of all of the data added so far.
+    pub fn digest(&self) -> StreamDigest {
+        StreamDigest(self.0.digest128())
+    }
+}
+
+impl fmt::Debug for StreamDigestComputer {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_tuple("StreamDigestComputer")
+            .field(&self.digest())
+            .finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn stream_digest_is_incremental() {
+        let mut dc = StreamDigestComputer::default();
+        assert_eq!(dc.digest(), StreamDigest::of_nothing());
+
+        let data: Vec<u8> = (0..100_000u32).map(|i| (i % 251) as u8).collect();
+
+        for chunk in data.chunks(777) {
+            dc.update(chunk);
+        }
+
+        assert_eq!(dc.digest(), StreamDigest(xxh3_128(&data)));
+        assert_ne!(dc.digest(), StreamDigest::of_nothing());
+    }
+}
@@ -10,7 +10,6 @@
 //! [`OutputHandle`] structs, which add a layer of bookkeeping to allow the
 //! higher levels of Tectonic to determine when the engine needs to be re-run.
 
-use sha2::Digest;
 use std::{
     borrow::Cow,
     fs::File,
@@ -24,7 +23,7 @@ use tectonic_errors::{
 use tectonic_status_base::StatusBackend;
 use thiserror::Error as ThisError;
 
-use crate::digest::DigestData;
+use crate::digest::{StreamDigest, StreamDigestComputer};
 
 pub mod app_dirs;
 pub mod digest;
@@ -91,15 +90,16 @@ pub enum InputOrigin {
 /// implementation for GZip streams, which we wouldn't be allowed to do
 /// because both the trait and the target struct are outside of our crate.
 ///
-/// An important role for the InputHandle struct is computing a cryptographic
-/// digest of the input file. The driver uses this information in order to
-/// figure out if the TeX engine needs rerunning. TeX makes our life more
-/// difficult, though, since it has somewhat funky file access patterns. LaTeX
-/// file opens work by opening a file and immediately closing it, which tests
-/// whether the file exists, and then by opening it again for real. Under the
-/// hood, XeTeX reads a couple of bytes from each file upon open to sniff its
-/// encoding. So we can't just stream data from `read()` calls into the SHA2
-/// computer, since we end up seeking and reading redundant data.
+/// An important role for the InputHandle struct is computing a digest of the
+/// input file (see [`digest::StreamDigest`]). The driver uses this
+/// information in order to figure out if the TeX engine needs rerunning. TeX
+/// makes our life more difficult, though, since it has somewhat funky file
+/// access patterns. LaTeX file opens work by opening a file and immediately
+/// closing it, which tests whether the file exists, and then by opening it
+/// again for real. Under the hood, XeTeX reads a couple of bytes from each
+/// file upon open to sniff its encoding. So we can't just stream data from
+/// `read()` calls into the digest computer, since we end up seeking and
+/// reading redundant data.
 ///
 /// The current system maintains some internal state that, so far, helps us Do
 /// The Right Thing given all this. If there's a seek on the file, we give up
@@ -115,11 +115,12 @@ pub struct InputHandle {
     /// Indicates that the file cannot be written to (provided by a read-only IoProvider) and
     /// therefore it is useless to compute the digest.
     read_only: bool,
-    digest: digest::DigestComputer,
+    digest: StreamDigestComputer,
     origin: InputOrigin,
     ever_read: bool,
     did_unhandled_seek: bool,
     ungetc_char: Option<u8>,
+    bytes_read: u64,
 }
 
 impl InputHandle {
@@ -139,6 +140,7 @@ impl InputHandle {
             ever_read: false,
             did_unhandled_seek: false,
             ungetc_char: None,
+            bytes_read: 0,
         }
     }
 
@@ -157,6 +159,7 @@ impl InputHandle {
             ever_read: false,
             did_unhandled_seek: false,
             ungetc_char: None,
+            bytes_read: 0,
         }
     }
 
@@ -170,6 +173,16 @@ impl InputHandle {
         self.origin
     }
 
+    /// Get the number of bytes that have been read through this handle.
+    ///
+    /// Bytes that are read again after a seek are counted again, and the data
+    /// consumed by [`Self::scan_remainder`] are not counted at all, so this
+    /// measures the I/O done on behalf of the engine rather than the size of
+    /// the file.
+    pub fn bytes_read(&self) -> u64 {
+        self.bytes_read
+    }
+
     /// Consumes the object and returns the underlying readable handle that
     /// it references.
     pub fn into_inner(self) -> Box<dyn InputFeatures> {
@@ -182,8 +195,8 @@ impl InputHandle {
     /// only part of the file is read, not the entire thing. This seems
     /// to happen with biblatex XML state files.
     pub fn scan_remainder(&mut self) -> Result<()> {
-        const BUFSIZE: usize = 1024;
-        let mut buf: [u8; BUFSIZE] = [0; BUFSIZE];
+        const BUFSIZE: usize = 65536;
+        let mut buf = vec![0u8; BUFSIZE];
 
         loop {
             let n = match self.inner.read(&mut buf[..]) {
@@ -207,17 +220,17 @@ impl InputHandle {
         Ok(())
     }
 
-    /// Consumes the object and returns the SHA256 sum of the content that was
+    /// Consumes the object and returns the digest of the content that was
     /// read. No digest is returned if there was ever a seek on the input
     /// stream, since in that case the results will not be reliable. We also
     /// return None if the stream was never read, which is another common
     /// TeX access pattern: files are opened, immediately closed, and then
     /// opened again. Finally, no digest is returned if the file is marked read-only.
-    pub fn into_name_digest(self) -> (String, Option<DigestData>) {
+    pub fn into_name_digest(self) -> (String, Option<StreamDigest>) {
         if self.did_unhandled_seek || !self.ever_read || self.read_only {
             (self.name, None)
         } else {
-            (self.name, Some(DigestData::from(self.digest)))
+            (self.name, Some(self.digest.digest()))
         }
     }
 
@@ -265,6 +278,7 @@ impl Read for InputHandle {
 
         self.ever_read = true;
         let n = self.inner.read(buf)?;
+        self.bytes_read += n as u64;
         if !self.read_only {
             self.digest.update(&buf[..n]);
         }
@@ -329,7 +343,8 @@ impl InputFeatures for InputHandle {
 pub struct OutputHandle {
     name: String,
     inner: Box<dyn Write>,
-    digest: digest::DigestComputer,
+    digest: StreamDigestComputer,
+    bytes_written: u64,
 }
 
 impl OutputHandle {
@@ -338,7 +353,8 @@ impl OutputHandle {
         OutputHandle {
             name: name.into(),
             inner: Box::new(inner),
-            digest: digest::create(),
+            digest: Default::default(),
+            bytes_written: 0,
         }
     }
 
@@ -347,16 +363,21 @@ impl OutputHandle {
         &self.name
     }
 
+    /// Get the number of bytes that have been written through this handle.
+    pub fn bytes_written(&self) -> u64 {
+        self.bytes_written
+    }
+
     /// Consumes the object and returns the underlying writable handle that
     /// it references.
     pub fn into_inner(self) -> Box<dyn Write> {
         self.inner
     }
 
-    /// Consumes the object and returns the SHA256 sum of the content that was
+    /// Consumes the object and returns the digest of the content that was
     /// written.
-    pub fn into_name_digest(self) -> (String, DigestData) {
-        (self.name, DigestData::from(self.digest))
+    pub fn into_name_digest(self) -> (String, StreamDigest) {
+        (self.name, self.digest.digest())
     }
 }
 
@@ -364,6 +385,7 @@ impl Write for OutputHandle {
     fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
         let n = self.inner.write(buf)?;
         self.digest.update(&buf[..n]);
+        self.bytes_written += n as u64;
         Ok(n)
     }
 
@@ -351,6 +351,7 @@ agl_normalized_name (char *glyphname)
 }
 
 static struct ht_table aglmap;
+static int             aglmap_loaded = 0;
 
 static inline void
 hval_free (void *hval)
@@ -358,10 +359,20 @@ hval_free (void *hval)
   agl_release_name((struct agl_name *) hval);
 }
 
+/* The glyph lists are only needed for some kinds of fonts, so they are
+ * loaded on the first lookup rather than at initialization.
+ */
 void
 agl_init_map (void)
 {
   ht_init_table(&aglmap, hval_free);
+  aglmap_loaded = 0;
+}
+
+static void
+agl_load_map (void)
+{
+  aglmap_loaded = 1;
   agl_load_listfile(AGL_EXTRA_LISTFILE, 0);
   if (agl_load_listfile(AGL_PREDEF_LISTFILE, 1) < 0) {
     dpx_warning("Failed to load AGL file \"%s\"...", AGL_PREDEF_LISTFILE);
@@ -375,6 +386,7 @@ void
 agl_close_map (void)
 {
   ht_clear_table(&aglmap);
+  aglmap_loaded = 0;
 }
 
 #define WBUF_SIZE 1024
@@ -500,6 +512,9 @@ agl_lookup_list (const char *glyphname)
   if (!glyphname)
     return NULL;
 
+  if (!aglmap_loaded)
+    agl_load_map();
+
   agln = ht_lookup_table(&aglmap, glyphname, strlen(glyphname));
 
   return agln;
@@ -39,6 +39,7 @@
 #include "dpx-cmap.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -62,6 +63,10 @@ static size_t  bytes_consumed   (CMap *cmap, const unsigned char *instr, size_t
 static void handle_undefined (CMap *cmap,
                               const unsigned char **inbuf, size_t *inbytesleft,
                               unsigned char **outbuf, size_t *outbytesleft);
+static void warn_undefined   (CMap *cmap, const unsigned char *code, size_t len);
+static void decode_char_compiled (CMap *cmap,
+                                  const unsigned char **inbuf, size_t *inbytesleft,
+                                  unsigned char **outbuf, size_t *outbytesleft);
 
 static int  check_range      (CMap *cmap,
                               const unsigned char *srclo, const unsigned char *srchi, size_t srcdim,
@@ -102,6 +107,8 @@ CMap_new (void)
     cmap->mapData->pos  = 0;
     cmap->mapData->data = NEW(MEM_ALLOC_SIZE, unsigned char);
 
+    memset(&cmap->compiled, 0, sizeof(cmap->compiled));
+
     return cmap;
 }
 
@@ -129,6 +136,7 @@ CMap_release (CMap *cmap)
             map = prev;
         }
     }
+    free(cmap->compiled.data);
 
     free(cmap);
 }
@@ -148,7 +156,7 @@ CMap_is_valid (CMap *cmap)
     /* Quick check */
     if (!cmap || !(cmap->name) || cmap->type < CMAP_TYPE_IDENTITY ||
         cmap->type > CMAP_TYPE_CID_TO_CODE || cmap->codespace.num < 1 ||
-        (cmap->type != CMAP_TYPE_IDENTITY && !cmap->mapTbl))
+        (cmap->type != CMAP_TYPE_IDENTITY && !cmap->mapTbl && !cmap->compiled.data))
         return false;
 
     if (cmap->useCMap) {
@@ -226,6 +234,20 @@ handle_undefined (CMap *cmap,
     *inbytesleft  -= len;
 }
 
+static void
+warn_undefined (CMap *cmap, const unsigned char *code, size_t len)
+{
+    size_t i;
+
+    dpx_warning("No character mapping available.");
+    dpx_message(" CMap name: %s\n", CMap_get_name(cmap));
+    dpx_message(" input str: ");
+    dpx_message("<");
+    for (i = 0; i < len; i++)
+        dpx_message("%02x", code[i]);
+    dpx_message(">\n");
+}
+
 void
 CMap_decode_char (CMap *cmap,
                   const unsigned char **inbuf, size_t *inbytesleft,
@@ -251,6 +273,9 @@ CMap_decode_char (CMap *cmap,
         *outbytesleft -= 2;
         *inbytesleft  -= 2;
         return;
+    } else if (cmap->compiled.data) {
+        decode_char_compiled(cmap, inbuf, inbytesleft, outbuf, outbytesleft);
+        return;
     } else if (!cmap->mapTbl) {
         if (cmap->useCMap) {
             CMap_decode_char(cmap->useCMap, inbuf, inbytesleft, outbuf, outbytesleft);
@@ -280,15 +305,7 @@ CMap_decode_char (CMap *cmap,
             return;
         } else {
             /* no mapping available in this CMap */
-            dpx_warning("No character mapping available.");
-            dpx_message(" CMap name: %s\n", CMap_get_name(cmap));
-            dpx_message(" input str: ");
-            dpx_message("<");
-            while (save < p) {
-                dpx_message("%02x", *save);
-                save++;
-            }
-            dpx_message(">\n");
+            warn_undefined(cmap, save, p - save);
             /*
              * We know partial match found up to `count' bytes,
              * but we will not use this information for the sake of simplicity.
@@ -819,6 +836,557 @@ check_range (CMap *cmap,
     return 0;
 }
 
+/************************** CMAP_COMPILED **************************/
+
+/* Tectonic: the CMaps used for CJK text, such as UniJIS-UTF16-H, are big
+ * PostScript files, and parsing them takes a noticeable part of every run.
+ * After parsing a CMap file, we save a compiled form of it with the driver,
+ * which keys it by the contents of the file, and later runs load that instead.
+ *
+ * The compiled form is one block of position-independent data that decoding
+ * works on directly. The mappings are flattened into ranges of consecutive
+ * codes of the same length, sorted so that they can be binary searched. Within
+ * a range, the output for a code is the output for the first code plus the
+ * offset of the code from it, except in .notdef ranges, where it is constant.
+ * All integers are big-endian. The layout is:
+ *
+ *   header      CMAP_COMPILED_HEADER_SIZE bytes:
+ *                 magic (8), type, wmode, minBytesIn, maxBytesIn,
+ *                 minBytesOut, maxBytesOut, number of codespace ranges,
+ *                 start[1..4], size of values, size of strings,
+ *                 CSI supplement (0xffffffff if no CSI), reserved (4 each)
+ *   codespaces  dim (4), codeLo (4), codeHi (4) each
+ *   ranges      dim (1), type (1), output length (2), first code (4),
+ *               last code (4), offset of output in values (4) each
+ *   values      output bytes for the first code of each range
+ *   strings     name, usecmap name, CSI registry and ordering, each
+ *               NUL-terminated and empty if not defined
+ *
+ * Ranges for codes of N bytes are the entries start[N-1] to start[N]-1, with
+ * start[0] = 0. CMaps with codes longer than four bytes aren't compiled. The
+ * codespace ranges include those copied from the usecmap CMap, which is looked
+ * up by name when loading.
+ */
+
+#define CMAP_COMPILED_KEY         "cmap-compiled"
+#define CMAP_COMPILED_MAGIC       "dpxCMap\001"
+#define CMAP_COMPILED_MAX_DIM     4
+#define CMAP_COMPILED_HEADER_SIZE 72
+#define CMAP_COMPILED_CSR_SIZE    12
+#define CMAP_COMPILED_RANGE_SIZE  16
+#define CMAP_COMPILED_NO_CSI      0xffffffffu
+
+struct cmap_range {
+    size_t               dim;
+    int                  type;
+    size_t               len;
+    uint32_t             lo, hi;
+    const unsigned char *value;
+};
+
+static uint32_t
+get_u32 (const unsigned char *p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static void
+put_u32 (unsigned char *p, uint32_t v)
+{
+    p[0] = (v >> 24) & 0xff;
+    p[1] = (v >> 16) & 0xff;
+    p[2] = (v >> 8) & 0xff;
+    p[3] = v & 0xff;
+}
+
+/* Set dst to the len-byte big-endian number base plus offset, wrapping around
+ * like the additions in CMap_add_bfrange() and CMap_add_cidrange().
+ */
+static void
+add_offset (unsigned char *dst, const unsigned char *base, size_t len, uint32_t offset)
+{
+    uint32_t carry = offset;
+    size_t   i;
+
+    for (i = len; i-- > 0; ) {
+        uint32_t sum = base[i] + (carry & 0xff);
+
+        dst[i] = sum & 0xff;
+        carry  = (carry >> 8) + (sum >> 8);
+    }
+}
+
+/* Check whether value is what add_offset() would give for base and offset. */
+static bool
+is_offset_of (const unsigned char *value, const unsigned char *base, size_t len, uint32_t offset)
+{
+    uint32_t carry = offset;
+    size_t   i;
+
+    for (i = len; i-- > 0; ) {
+        uint32_t sum = base[i] + (carry & 0xff);
+
+        if (value[i] != (sum & 0xff))
+            return false;
+        carry = (carry >> 8) + (sum >> 8);
+    }
+
+    return true;
+}
+
+/* Collect the mappings reachable in the subtable t, whose codes are dim bytes
+ * long and start with prefix, in order of code.
+ */
+static int
+collect_mappings (mapDef *t, uint32_t prefix, size_t dim,
+                  struct cmap_range **list, size_t *num, size_t *max)
+{
+    int c;
+
+    for (c = 0; c < 256; c++) {
+        uint32_t code = (prefix << 8) | c;
+
+        if (LOOKUP_CONTINUE(t[c].flag)) {
+            if (dim >= CMAP_COMPILED_MAX_DIM)
+                return -1;
+            if (collect_mappings(t[c].next, code, dim + 1, list, num, max) < 0)
+                return -1;
+        } else if (MAP_DEFINED(t[c].flag)) {
+            struct cmap_range *m;
+            int type = MAP_TYPE(t[c].flag);
+
+            if ((type != MAP_IS_CID && type != MAP_IS_CODE && type != MAP_IS_NOTDEF) ||
+                t[c].len < 1 || t[c].len > 0xffff)
+                return -1;
+
+            if (*num >= *max) {
+                *max += 4096;
+                *list = RENEW(*list, *max, struct cmap_range);
+            }
+
+            m = *list + (*num)++;
+            m->dim   = dim;
+            m->type  = type;
+            m->len   = t[c].len;
+            m->lo    = m->hi = code;
+            m->value = t[c].code;
+        }
+    }
+
+    return 0;
+}
+
+/* Whether the mapping m continues the range r. */
+static bool
+extends_range (const struct cmap_range *r, const struct cmap_range *m)
+{
+    if (m->type != r->type || m->len != r->len || m->lo != r->hi + 1)
+        return false;
+
+    if (r->type == MAP_IS_NOTDEF)
+        return !memcmp(m->value, r->value, r->len);
+
+    return is_offset_of(m->value, r->value, r->len, m->lo - r->lo);
+}
+
+/* Compile cmap as described above. Returns NULL if it can't be compiled. */
+static unsigned char *
+CMap_compile (CMap *cmap, size_t *size)
+{
+    struct cmap_range *mappings = NULL, *ranges;
+    size_t      num_mappings = 0, max_mappings = 0, num_ranges = 0;
+    size_t      start[CMAP_COMPILED_MAX_DIM + 1], values_size = 0, strings_size;
+    size_t      i, dim;
+    const char *strings[4];
+    unsigned char *data, *p;
+
+    if (!cmap->mapTbl || !cmap->name || (cmap->useCMap && !cmap->useCMap->name))
+        return NULL;
+
+    for (i = 0; i < cmap->codespace.num; i++) {
+        if (cmap->codespace.ranges[i].dim > CMAP_COMPILED_MAX_DIM)
+            return NULL;
+    }
+
+    if (collect_mappings(cmap->mapTbl, 0, 1, &mappings, &num_mappings, &max_mappings) < 0) {
+        free(mappings);
+        return NULL;
+    }
+
+    /* Mappings are collected in the order of their bytes, so sorting them
+     * by length only needs a pass for each length.
+     */
+    ranges = NEW(num_mappings + 1, struct cmap_range);
+    start[0] = 0;
+    for (dim = 1; dim <= CMAP_COMPILED_MAX_DIM; dim++) {
+        for (i = 0; i < num_mappings; i++) {
+            struct cmap_range *m = mappings + i;
+
+            if (m->dim != dim)
+                continue;
+
+            if (num_ranges > start[dim-1] && extends_range(ranges + num_ranges - 1, m)) {
+                ranges[num_ranges - 1].hi = m->lo;
+            } else {
+                ranges[num_ranges++] = *m;
+                values_size += m->len;
+            }
+        }
+        start[dim] = num_ranges;
+    }
+    free(mappings);
+
+    strings[0] = cmap->name;
+    strings[1] = cmap->useCMap ? cmap->useCMap->name : "";
+    strings[2] = cmap->CSI ? cmap->CSI->registry : "";
+    strings[3] = cmap->CSI ? cmap->CSI->ordering : "";
+    for (strings_size = 0, i = 0; i < 4; i++)
+        strings_size += strlen(strings[i]) + 1;
+
+    *size = CMAP_COMPILED_HEADER_SIZE + cmap->codespace.num * CMAP_COMPILED_CSR_SIZE +
+        num_ranges * CMAP_COMPILED_RANGE_SIZE + values_size + strings_size;
+    data = NEW(*size, unsigned char);
+    memset(data, 0, *size);
+
+    memcpy(data, CMAP_COMPILED_MAGIC, 8);
+    put_u32(data + 8,  cmap->type);
+    put_u32(data + 12, cmap->wmode);
+    put_u32(data + 16, cmap->profile.minBytesIn);
+    put_u32(data + 20, cmap->profile.maxBytesIn);
+    put_u32(data + 24, cmap->profile.minBytesOut);
+    put_u32(data + 28, cmap->profile.maxBytesOut);
+    put_u32(data + 32, cmap->codespace.num);
+    for (dim = 1; dim <= CMAP_COMPILED_MAX_DIM; dim++)
+        put_u32(data + 32 + 4 * dim, start[dim]);
+    put_u32(data + 52, values_size);
+    put_u32(data + 56, strings_size);
+    put_u32(data + 60, cmap->CSI ? (uint32_t) cmap->CSI->supplement : CMAP_COMPILED_NO_CSI);
+
+    p = data + CMAP_COMPILED_HEADER_SIZE;
+    for (i = 0; i < cmap->codespace.num; i++, p += CMAP_COMPILED_CSR_SIZE) {
+        rangeDef *csr = cmap->codespace.ranges + i;
+
+        put_u32(p, csr->dim);
+        memcpy(p + 4, csr->codeLo, csr->dim);
+        memcpy(p + 8, csr->codeHi, csr->dim);
+    }
+
+    {
+        unsigned char *values = p + num_ranges * CMAP_COMPILED_RANGE_SIZE;
+        size_t         offset = 0;
+
+        for (i = 0; i < num_ranges; i++, p += CMAP_COMPILED_RANGE_SIZE) {
+            struct cmap_range *r = ranges + i;
+
+            p[0] = r->dim;
+            p[1] = r->type;
+            p[2] = (r->len >> 8) & 0xff;
+            p[3] = r->len & 0xff;
+            put_u32(p + 4,  r->lo);
+            put_u32(p + 8,  r->hi);
+            put_u32(p + 12, offset);
+            memcpy(values + offset, r->value, r->len);
+            offset += r->len;
+        }
+        p = values + offset;
+    }
+    free(ranges);
+
+    for (i = 0; i < 4; i++) {
+        size_t len = strlen(strings[i]) + 1;
+
+        memcpy(p, strings[i], len);
+        p += len;
+    }
+
+    return data;
+}
+
+/* Set up cmap from the compiled CMap data, which it takes ownership of. On
+ * failure, the caller should release cmap and parse the CMap file instead.
+ */
+static int
+CMap_load_compiled (CMap *cmap, unsigned char *data, size_t size)
+{
+    const unsigned char *ranges, *values, *p, *end;
+    char       *strings[4];
+    size_t      num_csr, start[CMAP_COMPILED_MAX_DIM + 1], values_size, rest;
+    size_t      i, dim;
+    uint32_t    type, supplement;
+
+    cmap->compiled.data = data;
+
+    if (size < CMAP_COMPILED_HEADER_SIZE || memcmp(data, CMAP_COMPILED_MAGIC, 8))
+        return -1;
+
+    num_csr = get_u32(data + 32);
+    start[0] = 0;
+    for (dim = 1; dim <= CMAP_COMPILED_MAX_DIM; dim++) {
+        start[dim] = get_u32(data + 32 + 4 * dim);
+        if (start[dim] < start[dim-1])
+            return -1;
+    }
+    values_size = get_u32(data + 52);
+
+    rest = size - CMAP_COMPILED_HEADER_SIZE;
+    if (num_csr < 1 || num_csr > rest / CMAP_COMPILED_CSR_SIZE)
+        return -1;
+    rest -= num_csr * CMAP_COMPILED_CSR_SIZE;
+    if (start[CMAP_COMPILED_MAX_DIM] > rest / CMAP_COMPILED_RANGE_SIZE)
+        return -1;
+    rest -= start[CMAP_COMPILED_MAX_DIM] * CMAP_COMPILED_RANGE_SIZE;
+    if (values_size > rest || get_u32(data + 56) != rest - values_size)
+        return -1;
+
+    ranges = data + CMAP_COMPILED_HEADER_SIZE + num_csr * CMAP_COMPILED_CSR_SIZE;
+    values = ranges + start[CMAP_COMPILED_MAX_DIM] * CMAP_COMPILED_RANGE_SIZE;
+
+    p   = values + values_size;
+    end = data + size;
+    for (i = 0; i < 4; i++) {
+        const unsigned char *nul = memchr(p, 0, end - p);
+
+        if (!nul)
+            return -1;
+        strings[i] = (char *) data + (p - data);
+        p = nul + 1;
+    }
+
+    /* Make sure that decoding can't go astray. */
+    for (dim = 1; dim <= CMAP_COMPILED_MAX_DIM; dim++) {
+        uint32_t max_code = dim < 4 ? (1u << (8 * dim)) - 1 : 0xffffffffu;
+
+        for (i = start[dim-1]; i < start[dim]; i++) {
+            const unsigned char *r = ranges + i * CMAP_COMPILED_RANGE_SIZE;
+            size_t   len    = (r[2] << 8) | r[3];
+            uint32_t lo     = get_u32(r + 4);
+            uint32_t hi     = get_u32(r + 8);
+            uint32_t offset = get_u32(r + 12);
+
+            if (r[0] != dim || lo > hi || hi > max_code ||
+                offset > values_size || len > values_size - offset)
+                return -1;
+            if (r[1] == MAP_IS_CODE ? len < 1 :
+                (r[1] != MAP_IS_CID && r[1] != MAP_IS_NOTDEF) || len != 2)
+                return -1;
+            if (i > start[dim-1] && lo <= get_u32(r - CMAP_COMPILED_RANGE_SIZE + 8))
+                return -1;
+        }
+    }
+
+    type = get_u32(data + 8);
+    if (!strings[0][0] || type < CMAP_TYPE_CODE_TO_CID || type > CMAP_TYPE_CID_TO_CODE)
+        return -1;
+
+    CMap_set_name (cmap, strings[0]);
+    CMap_set_type (cmap, type);
+    CMap_set_wmode(cmap, get_u32(data + 12));
+
+    supplement = get_u32(data + 60);
+    if (supplement != CMAP_COMPILED_NO_CSI) {
+        CIDSysInfo csi;
+
+        csi.registry   = strings[2];
+        csi.ordering   = strings[3];
+        csi.supplement = (int) supplement;
+        CMap_set_CIDSysInfo(cmap, &csi);
+    }
+
+    for (i = 0; i < num_csr; i++) {
+        const unsigned char *csr = data + CMAP_COMPILED_HEADER_SIZE + i * CMAP_COMPILED_CSR_SIZE;
+        size_t csr_dim = get_u32(csr);
+
+        if (csr_dim < 1 || csr_dim > CMAP_COMPILED_MAX_DIM ||
+            CMap_add_codespacerange(cmap, csr + 4, csr + 8, csr_dim) < 0)
+            return -1;
+    }
+
+    /* The codespace ranges of the usecmap CMap are already included. */
+    if (strings[1][0]) {
+        int id = CMap_cache_find(strings[1]);
+
+        if (id < 0)
+            return -1;
+        cmap->useCMap = CMap_cache_get(id);
+    }
+
+    cmap->profile.minBytesIn  = get_u32(data + 16);
+    cmap->profile.maxBytesIn  = get_u32(data + 20);
+    cmap->profile.minBytesOut = get_u32(data + 24);
+    cmap->profile.maxBytesOut = get_u32(data + 28);
+
+    cmap->compiled.ranges = ranges;
+    cmap->compiled.values = values;
+    memcpy(cmap->compiled.start, start, sizeof(start));
+
+    return CMap_is_valid(cmap) ? 0 : -1;
+}
+
+/* Find the first range of N-byte codes in the compiled CMap that overlaps the
+ * codes lo to hi, if any.
+ */
+static const unsigned char *
+lookup_compiled (CMap *cmap, size_t dim, uint32_t lo, uint32_t hi)
+{
+    const unsigned char *r;
+    size_t first = cmap->compiled.start[dim-1], last = cmap->compiled.start[dim];
+
+    while (first < last) {
+        size_t mid = first + (last - first) / 2;
+
+        if (get_u32(cmap->compiled.ranges + mid * CMAP_COMPILED_RANGE_SIZE + 8) < lo)
+            first = mid + 1;
+        else
+            last = mid;
+    }
+
+    if (first == cmap->compiled.start[dim])
+        return NULL;
+
+    r = cmap->compiled.ranges + first * CMAP_COMPILED_RANGE_SIZE;
+    return get_u32(r + 4) <= hi ? r : NULL;
+}
+
+/* Whether the compiled CMap has codes longer than dim bytes that start with
+ * the dim-byte code, i.e., whether the lookup table would need more bytes.
+ */
+static bool
+is_prefix_compiled (CMap *cmap, size_t dim, uint32_t code)
+{
+    size_t d;
+
+    for (d = dim + 1; d <= CMAP_COMPILED_MAX_DIM; d++) {
+        int      shift = 8 * (d - dim);
+        uint32_t lo    = code << shift;
+
+        if (lookup_compiled(cmap, d, lo, lo | ((1u << shift) - 1)))
+            return true;
+    }
+
+    return false;
+}
+
+/* The same as the lookup table part of CMap_decode_char(), for compiled CMaps.
+ * The compiled CMap contains exactly the mappings that can be reached in the
+ * lookup table, so the shortest matching code is the one that it would find.
+ */
+static void
+decode_char_compiled (CMap *cmap,
+                      const unsigned char **inbuf, size_t *inbytesleft,
+                      unsigned char **outbuf, size_t *outbytesleft)
+{
+    const unsigned char *r = NULL, *value;
+    size_t   dim, count, len, avail = MIN(*inbytesleft, CMAP_COMPILED_MAX_DIM);
+    uint32_t code = 0;
+
+    for (dim = 1; dim <= avail; dim++) {
+        code = (code << 8) | (*inbuf)[dim-1];
+        r = lookup_compiled(cmap, dim, code, code);
+        if (r)
+            break;
+    }
+    count = dim;
+
+    if (!r && (avail == 0 || (avail < CMAP_COMPILED_MAX_DIM &&
+                              is_prefix_compiled(cmap, avail, code)))) {
+        /* The input ends in the middle of a code. The lookup table then looks
+         * at the entry for the last byte in the next subtable, as if that
+         * byte was repeated, so we do the same.
+         */
+        dim   = avail + 1;
+        count = avail;
+        code  = (code << 8) | (avail > 0 ? (*inbuf)[avail-1] : 0);
+        r = lookup_compiled(cmap, dim, code, code);
+        if (!r && is_prefix_compiled(cmap, dim, code))
+            _tt_abort("%s: Premature end of input string.", CMAP_DEBUG_STR);
+    }
+
+    if (!r) {
+        if (cmap->useCMap) {
+            CMap_decode_char(cmap->useCMap, inbuf, inbytesleft, outbuf, outbytesleft);
+            return;
+        }
+
+        /* Report as many bytes as the lookup table would have looked at. */
+        for (len = 0, code = 0; len < avail; ) {
+            code = (code << 8) | (*inbuf)[len++];
+            if (!is_prefix_compiled(cmap, len, code))
+                break;
+        }
+        warn_undefined(cmap, *inbuf, len);
+        handle_undefined(cmap, inbuf, inbytesleft, outbuf, outbytesleft);
+        return;
+    }
+
+    len   = (r[2] << 8) | r[3];
+    value = cmap->compiled.values + get_u32(r + 12);
+
+    if (r[1] == MAP_IS_NOTDEF)
+        dpx_warning("Character mapped to .notdef found.");
+    if (*outbytesleft < len)
+        _tt_abort("%s: Buffer overflow.", CMAP_DEBUG_STR);
+
+    if (r[1] == MAP_IS_NOTDEF)
+        memcpy(*outbuf, value, len);
+    else
+        add_offset(*outbuf, value, len, code - get_u32(r + 4));
+
+    *outbuf       += len;
+    *outbytesleft -= len;
+    *inbuf        += count;
+    *inbytesleft  -= count;
+}
+
+/* Rebuild the lookup table of a compiled CMap, for code that works on the
+ * table directly, such as CMap_create_stream().
+ */
+void
+CMap_expand_compiled (CMap *cmap)
+{
+    size_t dim, i;
+
+    assert(cmap);
+
+    if (cmap->mapTbl || !cmap->compiled.data)
+        return;
+
+    for (dim = 1; dim <= CMAP_COMPILED_MAX_DIM; dim++) {
+        for (i = cmap->compiled.start[dim-1]; i < cmap->compiled.start[dim]; i++) {
+            const unsigned char *r = cmap->compiled.ranges + i * CMAP_COMPILED_RANGE_SIZE;
+            const unsigned char *value = cmap->compiled.values + get_u32(r + 12);
+            size_t         len = (r[2] << 8) | r[3];
+            uint32_t       lo = get_u32(r + 4), hi = get_u32(r + 8), code;
+            unsigned char  src[CMAP_COMPILED_MAX_DIM], *dst;
+
+            dst = NEW(len, unsigned char);
+            for (code = lo; ; code++) {
+                size_t j;
+
+                for (j = 0; j < dim; j++)
+                    src[j] = (code >> (8 * (dim - 1 - j))) & 0xff;
+
+                switch (r[1]) {
+                case MAP_IS_CID:
+                    add_offset(dst, value, 2, code - lo);
+                    CMap_add_cidchar(cmap, src, dim, (dst[0] << 8) | dst[1]);
+                    break;
+                case MAP_IS_CODE:
+                    add_offset(dst, value, len, code - lo);
+                    CMap_add_bfchar(cmap, src, dim, dst, len);
+                    break;
+                case MAP_IS_NOTDEF:
+                    CMap_add_notdefchar(cmap, src, dim, (value[0] << 8) | value[1]);
+                    break;
+                }
+
+                if (code == hi)
+                    break;
+            }
+            free(dst);
+        }
+    }
+}
+
 /************************** CMAP_CACHE **************************/
 #include "dpx-cmap_read.h"
 
@@ -872,6 +1440,38 @@ CMap_cache_init (void)
     __cache->num += 2;
 }
 
+static int
+load_compiled (CMap *cmap, rust_input_handle_t handle)
+{
+    unsigned char *data;
+    ssize_t        size;
+
+    size = ttstub_input_get_metadata(handle, CMAP_COMPILED_KEY, NULL, 0);
+    if (size < CMAP_COMPILED_HEADER_SIZE)
+        return -1;
+
+    data = NEW(size + 1, unsigned char);
+    if (ttstub_input_get_metadata(handle, CMAP_COMPILED_KEY, (char *) data, size + 1) != size) {
+        free(data);
+        return -1;
+    }
+
+    return CMap_load_compiled(cmap, data, size);
+}
+
+static void
+save_compiled (CMap *cmap, rust_input_handle_t handle)
+{
+    unsigned char *data;
+    size_t         size;
+
+    data = CMap_compile(cmap, &size);
+    if (data) {
+        ttstub_input_put_metadata(handle, CMAP_COMPILED_KEY, (const char *) data, size);
+        free(data);
+    }
+}
+
 CMap *
 CMap_cache_get (int id)
 {
@@ -920,8 +1520,17 @@ CMap_cache_find (const char *cmap_name)
     __cache->num++;
     __cache->cmaps[id] = CMap_new();
 
-    if (CMap_parse(__cache->cmaps[id], handle) < 0)
-        _tt_abort("%s: Parsing CMap file failed.", CMAP_DEBUG_STR);
+    /* Tectonic: use the compiled form of the CMap if there is one. Note that
+     * loading a usecmap CMap may reallocate the cache. */
+    if (load_compiled(__cache->cmaps[id], handle) < 0) {
+        CMap_release(__cache->cmaps[id]);
+        __cache->cmaps[id] = CMap_new();
+
+        if (CMap_parse(__cache->cmaps[id], handle) < 0)
+            _tt_abort("%s: Parsing CMap file failed.", CMAP_DEBUG_STR);
+
+        save_compiled(__cache->cmaps[id], handle);
+    }
 
     ttstub_input_close(handle);
 
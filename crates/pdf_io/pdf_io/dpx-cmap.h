@@ -110,6 +110,8 @@ size_t  CMap_decode (CMap *cmap,
                          const unsigned char **inbuf,  size_t *inbytesleft,
                          unsigned char **outbuf, size_t *outbytesleft);
 
+void CMap_expand_compiled (CMap *cmap);
+
 void  CMap_cache_init  (void);
 CMap *CMap_cache_get   (int id);
 int   CMap_cache_find  (const char *cmap_name);
@@ -98,6 +98,14 @@ struct CMap {
     size_t minBytesOut;
     size_t maxBytesOut;
   } profile;
+  /* Tectonic: compiled form of the mapping table, see dpx-cmap.c. When
+   * present, decoding uses it instead of mapTbl. */
+  struct {
+    unsigned char       *data;   /* The whole compiled CMap             */
+    const unsigned char *ranges; /* Range entries, sorted by dim and lo */
+    const unsigned char *values; /* Output bytes of the range entries   */
+    size_t               start[5]; /* N-byte codes: start[N-1]..start[N] */
+  } compiled;
 };
 
 #endif /* _CMAP_P_H_ */
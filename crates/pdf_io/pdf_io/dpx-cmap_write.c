@@ -318,6 +318,9 @@ CMap_create_stream (CMap *cmap)
   if (cmap->type == CMAP_TYPE_IDENTITY)
     return NULL;
 
+  /* Tectonic: CMaps loaded in compiled form need their lookup table back. */
+  CMap_expand_compiled(cmap);
+
   stream      = pdf_new_stream(STREAM_COMPRESS);
   stream_dict = pdf_stream_dict(stream);
 
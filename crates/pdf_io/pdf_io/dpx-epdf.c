@@ -128,6 +128,10 @@ pdf_include_page (pdf_ximage        *ximage,
   if(!page)
     goto error_silent;
 
+  pdf_ximage_cache_page_count(handle, pdf_doc_get_page_count(pf));
+  pdf_ximage_cache_page_info(handle, options.page_no, options.bbox_type,
+                             &info.bbox, &info.matrix);
+
   catalog = pdf_file_get_catalog(pf);
   markinfo = pdf_deref_obj(pdf_lookup_dict(catalog, "MarkInfo"));
   if (markinfo) {
@@ -635,6 +635,174 @@ fontmap_parse_mapdef_dps (fontmap_rec *mrec,
 static struct ht_table *fontmap = NULL;
 
 #define fontmap_invalid(m) (!(m) || !(m)->map_name || !(m)->font_name)
+
+/*
+ * Font map files loaded in FONTMAP_RMODE_APPEND mode (the big pdftex.map
+ * and friends) are only indexed by TeX font name when loaded. A record is
+ * parsed and appended the first time its name is looked up, inserted or
+ * removed, which gives the same result as appending everything up front
+ * since appending never overrides an existing record.
+ */
+typedef struct fontmap_line
+{
+    const char *line;
+    int         len;
+    int         lpos;
+    int         format;
+} fontmap_line;
+
+typedef struct fontmap_source
+{
+    char            *filename;
+    char            *buffer;
+    struct ht_table  lines;
+
+    struct fontmap_source *next;
+} fontmap_source;
+
+static fontmap_source *deferred_sources   = NULL;
+static int             resolving_deferred = 0;
+
+static void
+fontmap_append_line (const char *filename, int lpos,
+                     const char *line, int llen, int format)
+{
+    fontmap_rec *mrec;
+
+    mrec  = NEW(1, fontmap_rec);
+    pdf_init_fontmap_record(mrec);
+
+    /* format > 0: DVIPDFM, format <= 0: DVIPS/pdfTeX */
+    if (pdf_read_fontmap_line(mrec, line, llen, format)) {
+        dpx_warning("Invalid map record in fontmap line %d from %s.", lpos, filename);
+        dpx_warning("-- Ignore the current input buffer: %s", line);
+    } else {
+        pdf_append_fontmap_record(mrec->map_name, mrec);
+    }
+    pdf_clear_fontmap_record(mrec);
+    free(mrec);
+}
+
+static void
+fontmap_resolve_deferred (const char *tfm_name)
+{
+    fontmap_source *src;
+
+    /* Records are resolved source by source, in load order. */
+    if (resolving_deferred || !tfm_name)
+        return;
+
+    resolving_deferred = 1;
+    for (src = deferred_sources; src; src = src->next) {
+        fontmap_line *ml, ent;
+
+        ml = ht_lookup_table(&src->lines, tfm_name, strlen(tfm_name));
+        if (!ml)
+            continue;
+        ent = *ml;
+        ht_remove_table(&src->lines, tfm_name, strlen(tfm_name));
+        fontmap_append_line(src->filename, ent.lpos, ent.line, ent.len, ent.format);
+    }
+    resolving_deferred = 0;
+}
+
+static int
+fontmap_index_file (const char *filename, rust_input_handle_t handle)
+{
+    fontmap_source  *src, **tail;
+    char            *p, *endptr, *next;
+    size_t           size;
+    int              lpos = 0, format = 0;
+
+    size = ttstub_input_get_size(handle);
+
+    src = NEW(1, fontmap_source);
+    src->buffer = NEW(size + 1, char);
+    if (ttstub_input_read(handle, src->buffer, size) != (ssize_t) size) {
+        dpx_warning("Couldn't read font map file \"%s\".", filename);
+        free(src->buffer);
+        free(src);
+        return -1;
+    }
+    src->buffer[size] = '\0';
+    src->filename = mstrdup(filename);
+    ht_init_table(&src->lines, free);
+    src->next = NULL;
+
+    /* Subfont records are appended right away and must see this file's
+     * earlier lines, so the source is registered before scanning. */
+    for (tail = &deferred_sources; *tail; tail = &((*tail)->next));
+    *tail = src;
+
+    for (p = src->buffer, endptr = p + size; p < endptr; p = next) {
+        const char *cp, *lend;
+        char       *q, *key;
+        int         m;
+
+        for (q = p; q < endptr && *q != '\n' && *q != '\r'; q++);
+        next = q + 1;
+        if (q < endptr && *q == '\r' && next < endptr && *next == '\n')
+            next++;
+        *q = '\0';
+
+        lpos++;
+        q = strchr(p, '%'); /* we don't have quoted string */
+        if (q)
+            *q = '\0';
+
+        cp   = p;
+        lend = p + strlen(p);
+        skip_blank(&cp, lend);
+        if (cp == lend)
+            continue;
+
+        m = is_pdfm_mapline(cp);
+
+        if (format * m < 0) { /* mismatch */
+            dpx_warning("Found a mismatched fontmap line %d from %s.", lpos, filename);
+            dpx_warning("-- Ignore the current input buffer: %s", cp);
+            continue;
+        } else
+            format += m;
+
+        {
+            const char *kp = cp;
+
+            key = parse_string_value(&kp, lend);
+        }
+
+        if (!key || strchr(key, '@')) {
+            /* Possibly a subfont record, which defines many TFM names. */
+            fontmap_append_line(filename, lpos, cp, (int) (lend - cp), format);
+        } else if (!ht_lookup_table(&src->lines, key, strlen(key))) {
+            fontmap_line *ml;
+
+            ml = NEW(1, fontmap_line);
+            ml->line   = cp;
+            ml->len    = (int) (lend - cp);
+            ml->lpos   = lpos;
+            ml->format = format;
+            ht_insert_table(&src->lines, key, strlen(key), ml);
+        }
+        free(key);
+    }
+
+    return 0;
+}
+
+static void
+fontmap_close_sources (void)
+{
+    while (deferred_sources) {
+        fontmap_source *src = deferred_sources;
+
+        deferred_sources = src->next;
+        ht_clear_table(&src->lines);
+        free(src->buffer);
+        free(src->filename);
+        free(src);
+    }
+}
 static char *
 chop_sfd_name (const char *tex_name, char **sfd_name)
 {
@@ -720,6 +888,8 @@ pdf_append_fontmap_record (const char *kp, const fontmap_rec *vp)
     if (dpx_conf.verbose_level > 3)
         dpx_message("fontmap>> append key=\"%s\"...", kp);
 
+    fontmap_resolve_deferred(kp);
+
     fnt_name = chop_sfd_name(kp, &sfd_name);
     if (fnt_name && sfd_name) {
         char  *tfm_name;
@@ -732,6 +902,7 @@ pdf_append_fontmap_record (const char *kp, const fontmap_rec *vp)
             tfm_name = make_subfont_name(kp, sfd_name, subfont_ids[n]);
             if (!tfm_name)
                 continue;
+            fontmap_resolve_deferred(tfm_name);
             mrec = ht_lookup_table(fontmap, tfm_name, strlen(tfm_name));
             if (!mrec) {
                 mrec = NEW(1, fontmap_rec);
@@ -773,6 +944,8 @@ pdf_remove_fontmap_record (const char *kp)
     if (dpx_conf.verbose_level > 3)
         dpx_message("fontmap>> remove key=\"%s\"...", kp);
 
+    fontmap_resolve_deferred(kp);
+
     fnt_name = chop_sfd_name(kp, &sfd_name);
     if (fnt_name && sfd_name) {
         char  *tfm_name;
@@ -789,6 +962,7 @@ pdf_remove_fontmap_record (const char *kp)
                 continue;
             if (dpx_conf.verbose_level > 3)
                 dpx_message(" %s", tfm_name);
+            fontmap_resolve_deferred(tfm_name);
             ht_remove_table(fontmap, tfm_name, strlen(tfm_name));
             free(tfm_name);
         }
@@ -818,6 +992,8 @@ pdf_insert_fontmap_record (const char *kp, const fontmap_rec *vp)
     if (dpx_conf.verbose_level > 3)
         dpx_message("fontmap>> insert key=\"%s\"...", kp);
 
+    fontmap_resolve_deferred(kp);
+
     fnt_name = chop_sfd_name(kp, &sfd_name);
     if (fnt_name && sfd_name) {
         char  *tfm_name;
@@ -838,6 +1014,7 @@ pdf_insert_fontmap_record (const char *kp, const fontmap_rec *vp)
                 continue;
             if (dpx_conf.verbose_level > 3)
                 dpx_message(" %s", tfm_name);
+            fontmap_resolve_deferred(tfm_name);
             mrec = NEW(1, fontmap_rec);
             pdf_init_fontmap_record(mrec);
             mrec->map_name = mstrdup(kp); /* link to this entry */
@@ -967,6 +1144,16 @@ pdf_load_fontmap_file (const char *filename, int mode)
         return  -1;
     }
 
+    if (mode == FONTMAP_RMODE_APPEND) {
+        error = fontmap_index_file(filename, handle);
+        ttstub_input_close(handle);
+
+        if (dpx_conf.verbose_level)
+            dpx_message(">");
+
+        return error;
+    }
+
     while (!error && (p = tt_readline(work_buffer, WORK_BUFFER_SIZE, handle)) != NULL) {
         int m;
 
@@ -1073,8 +1260,10 @@ pdf_lookup_fontmap_record (const char *tfm_name)
 {
     fontmap_rec *mrec = NULL;
 
-    if (fontmap && tfm_name)
+    if (fontmap && tfm_name) {
+        fontmap_resolve_deferred(tfm_name);
         mrec = ht_lookup_table(fontmap, tfm_name, strlen(tfm_name));
+    }
 
     return  mrec;
 }
@@ -1096,6 +1285,7 @@ pdf_close_fontmaps (void)
     }
     fontmap = NULL;
 
+    fontmap_close_sources();
     release_sfd_record();
 }
 
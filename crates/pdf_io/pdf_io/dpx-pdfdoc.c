@@ -56,6 +56,8 @@
 #include "dpx-system.h"
 
 #define PDFDOC_PAGES_ALLOC_SIZE   128u
+#define PDFDOC_LEAVES_ALLOC_SIZE  16u
+#define PDFDOC_LEAF_SIZE          32u
 #define PDFDOC_ARTICLE_ALLOC_SIZE 16
 #define PDFDOC_BEAD_ALLOC_SIZE    16
 
@@ -137,6 +139,17 @@ typedef struct pdf_page
   pdf_obj  *beads;
 } pdf_page;
 
+/*
+ * Bottom-level "Pages" node used in page flushing mode. Finished pages are
+ * written out immediately, so their parent must be known by then.
+ */
+typedef struct pdf_page_leaf
+{
+  pdf_obj     *dict;
+  pdf_obj     *kids;
+  unsigned int count;
+} pdf_page_leaf;
+
 typedef struct pdf_olitem
 {
   pdf_obj *dict;
@@ -193,6 +206,10 @@ typedef struct pdf_doc
     unsigned int num_entries; /* This is not actually total number of pages. */
     unsigned int max_entries;
     pdf_page *entries;
+
+    unsigned int num_leaves;
+    unsigned int max_leaves;
+    pdf_page_leaf *leaves;
   } pages;
 
   struct {
@@ -218,6 +235,7 @@ typedef struct pdf_doc
       double x, y;
     } annot_grow;
     int enable_manual_thumb;
+    int enable_page_flush;
   } options;
 
   struct form_list_node *pending_forms;
@@ -703,6 +721,115 @@ build_page_tree (pdf_doc  *p,
   return self;
 }
 
+/*
+ * Page flushing mode: instead of keeping every page dictionary around until
+ * the page tree is built in pdf_close_document(), each page is written out as
+ * soon as it is finished. Pages are attached to bottom-level "Pages" nodes of
+ * PDFDOC_LEAF_SIZE kids each; only those small nodes and the page references
+ * (needed for outlines, dests and article beads) are kept until the end.
+ */
+static void
+doc_flush_finished_page (pdf_doc *p, pdf_page *page)
+{
+  pdf_page_leaf *leaf;
+  pdf_obj       *page_ref;
+
+  if (p->pages.num_leaves == 0 ||
+      p->pages.leaves[p->pages.num_leaves - 1].count >= PDFDOC_LEAF_SIZE) {
+    if (p->pages.num_leaves >= p->pages.max_leaves) {
+      p->pages.max_leaves += PDFDOC_LEAVES_ALLOC_SIZE;
+      p->pages.leaves = RENEW(p->pages.leaves,
+                              p->pages.max_leaves, pdf_page_leaf);
+    }
+    leaf = &(p->pages.leaves[p->pages.num_leaves++]);
+    leaf->dict  = pdf_new_dict();
+    leaf->kids  = pdf_new_array();
+    leaf->count = 0;
+  } else {
+    leaf = &(p->pages.leaves[p->pages.num_leaves - 1]);
+  }
+
+  if (!page->page_ref)
+    page->page_ref = pdf_ref_obj(page->page_obj);
+  pdf_add_array(leaf->kids, pdf_link_obj(page->page_ref));
+  leaf->count++;
+
+  /* doc_flush_page() drops the page reference; later references to
+   * this page must keep resolving to the same object. */
+  page_ref = pdf_link_obj(page->page_ref);
+  doc_flush_page(p, page, pdf_ref_obj(leaf->dict));
+  page->page_ref = page_ref;
+
+  return;
+}
+
+static void
+doc_close_page_leaf (pdf_page_leaf *leaf, pdf_obj *kids, pdf_obj *parent_ref)
+{
+  pdf_add_dict(leaf->dict, pdf_new_name("Type"),  pdf_new_name("Pages"));
+  pdf_add_dict(leaf->dict, pdf_new_name("Count"), pdf_new_number((double) leaf->count));
+  pdf_add_dict(leaf->dict, pdf_new_name("Parent"), parent_ref);
+  pdf_add_dict(leaf->dict, pdf_new_name("Kids"), leaf->kids);
+
+  pdf_add_array(kids, pdf_ref_obj(leaf->dict));
+  pdf_release_obj(leaf->dict);
+
+  leaf->dict = NULL;
+  leaf->kids = NULL;
+
+  return;
+}
+
+/* Same as build_page_tree() but over the leaf nodes of flushed pages. */
+static pdf_obj *
+build_flushed_page_tree (pdf_doc       *p,
+                         pdf_page_leaf *firstleaf, int num_leaves,
+                         pdf_obj       *parent_ref)
+{
+  pdf_obj *self, *self_ref, *kids;
+  unsigned int count = 0;
+  int      i;
+
+  self = pdf_new_dict();
+  self_ref = parent_ref ? pdf_ref_obj(self) : pdf_ref_obj(p->root.pages);
+
+  for (i = 0; i < num_leaves; i++)
+    count += firstleaf[i].count;
+
+  pdf_add_dict(self, pdf_new_name("Type"),  pdf_new_name("Pages"));
+  pdf_add_dict(self, pdf_new_name("Count"), pdf_new_number((double) count));
+
+  if (parent_ref != NULL)
+    pdf_add_dict(self, pdf_new_name("Parent"), parent_ref);
+
+  kids = pdf_new_array();
+  if (num_leaves <= PAGE_CLUSTER) {
+    for (i = 0; i < num_leaves; i++)
+      doc_close_page_leaf(firstleaf + i, kids, pdf_link_obj(self_ref));
+  } else {
+    for (i = 0; i < PAGE_CLUSTER; i++) {
+      int start, end;
+
+      start = (i*num_leaves)/PAGE_CLUSTER;
+      end   = ((i+1)*num_leaves)/PAGE_CLUSTER;
+      if (end - start > 1) {
+        pdf_obj *subtree;
+
+        subtree = build_flushed_page_tree(p, firstleaf + start, end - start,
+                                          pdf_link_obj(self_ref));
+        pdf_add_array(kids, pdf_ref_obj(subtree));
+        pdf_release_obj(subtree);
+      } else {
+        doc_close_page_leaf(firstleaf + start, kids, pdf_link_obj(self_ref));
+      }
+    }
+  }
+  pdf_add_dict(self, pdf_new_name("Kids"), kids);
+  pdf_release_obj(self_ref);
+
+  return self;
+}
+
 static void
 pdf_doc_init_page_tree (pdf_doc *p, double media_width, double media_height)
 {
@@ -717,6 +844,10 @@ pdf_doc_init_page_tree (pdf_doc *p, double media_width, double media_height)
   p->pages.max_entries = 0;
   p->pages.entries     = NULL;
 
+  p->pages.num_leaves = 0;
+  p->pages.max_leaves = 0;
+  p->pages.leaves     = NULL;
+
   p->pages.bop = NULL;
   p->pages.eop = NULL;
 
@@ -768,10 +899,39 @@ pdf_doc_close_page_tree (pdf_doc *p)
     }
   }
 
+  /*
+   * In page flushing mode, the pages themselves are already written out. We
+   * only need to drop the page references kept for later use.
+   */
+  if (p->options.enable_page_flush) {
+    for (page_no = 1; page_no <= PAGECOUNT(p); page_no++) {
+      pdf_page  *page;
+
+      page = doc_get_page_entry(p, page_no);
+      if (page->annots) {
+        dpx_warning("Annotation attached to already written page #%u ignored.", page_no);
+        pdf_release_obj(page->annots);
+        page->annots = NULL;
+      }
+      /* The "B" entry of the page is optional. */
+      if (page->beads) {
+        pdf_release_obj(page->beads);
+        page->beads = NULL;
+      }
+      pdf_release_obj(page->page_ref);
+      page->page_ref = NULL;
+    }
+  }
+
   /*
    * Connect page tree to root node.
    */
-  page_tree_root = build_page_tree(p, FIRSTPAGE(p), PAGECOUNT(p), NULL);
+  if (p->options.enable_page_flush) {
+    page_tree_root = build_flushed_page_tree(p, p->pages.leaves,
+                                             p->pages.num_leaves, NULL);
+  } else {
+    page_tree_root = build_page_tree(p, FIRSTPAGE(p), PAGECOUNT(p), NULL);
+  }
   pdf_merge_dict (p->root.pages, page_tree_root);
   pdf_release_obj(page_tree_root);
 
@@ -805,6 +965,10 @@ pdf_doc_close_page_tree (pdf_doc *p)
   p->pages.num_entries = 0;
   p->pages.max_entries = 0;
 
+  p->pages.leaves = mfree(p->pages.leaves);
+  p->pages.num_leaves = 0;
+  p->pages.max_leaves = 0;
+
   return;
 }
 
@@ -2180,7 +2344,9 @@ pdf_doc_ref_page (unsigned page_no)
   pdf_page *page;
 
   page = doc_get_page_entry(p, page_no);
-  if (!page->page_obj) {
+  /* In page flushing mode, the page object of a finished page is gone
+   * but its reference is still valid. */
+  if (!page->page_ref) {
     page->page_obj = pdf_new_dict();
     page->page_ref = pdf_ref_obj(page->page_obj);
   }
@@ -2342,6 +2508,13 @@ pdf_doc_finish_page (pdf_doc *p)
       pdf_add_dict(currentpage->page_obj, pdf_new_name("Thumb"), thumb_ref);
   }
 
+  /*
+   * Annotations for the current page are added before we get here, so the
+   * page can be written out right away in page flushing mode.
+   */
+  if (p->options.enable_page_flush)
+    doc_flush_finished_page(p, currentpage);
+
   p->pages.num_entries++;
 
   return;
@@ -2489,6 +2662,7 @@ pdf_open_document (const char *filename,
   pdf_doc_set_bgcolor(NULL);
 
   p->options.enable_manual_thumb = settings.enable_manual_thumb;
+  p->options.enable_page_flush   = settings.enable_page_flush;
 
   /* Create a default name for thumbnail image files */
   if (p->options.enable_manual_thumb) {
@@ -29,6 +29,7 @@
 #include <string.h>
 
 #include "dpx-dpxconf.h"
+#include "dpx-dpxcrypt.h"
 #include "dpx-dpxutil.h"
 #include "dpx-error.h"
 #include "dpx-mem.h"
@@ -158,6 +159,7 @@ typedef struct xref_entry
     unsigned short field3;     /* generation or index              */
     pdf_obj       *direct;     /* used for imported objects        */
     pdf_obj       *indirect;   /* used for imported objects        */
+    unsigned char  importing;  /* Tectonic: see pdf_import_indirect */
 } xref_entry;
 
 struct pdf_file
@@ -169,6 +171,14 @@ struct pdf_file
     int         num_obj;
     int         file_size;
     unsigned int version;
+    /* Tectonic: the contents of the file if we've read it all into memory,
+     * and our position in them. See pdf_file_new(). */
+    char       *data;
+    size_t      pos;
+    /* Tectonic: the sorted offsets of the objects in the file, for
+     * next_object_offset(), or NULL if they need to be worked out again. */
+    uint32_t   *offsets;
+    size_t      num_offsets;
 };
 
 /* Tectonic: no error_out; it's for debugging and breaks I/O encapsulation */
@@ -204,6 +214,9 @@ struct pdf_out {
     size_t      file_position;
     int         line_position;
     size_t      compression_saved;
+    uint64_t    streams_compressed;
+    uint64_t    bytes_before_compression;
+    uint64_t    bytes_after_compression;
   } output;
 
   struct {
@@ -220,6 +233,16 @@ struct pdf_out {
   pdf_obj      *xref_stream;
   pdf_obj      *output_stream;
   pdf_obj      *current_objstm;
+
+  /* Tectonic: references to the objects imported from included PDFs, keyed
+   * by a digest of their content, so that identical fonts, images and so on
+   * are only written once. */
+  struct {
+    struct ht_table table;
+    uint64_t    objects;      /* duplicates that were not written */
+    uint64_t    bytes_saved;  /* ... and the size of their content */
+  } imports;
+
   /* The following flag bits are (8,338,607+1)/8 bytes data
    * each bit represenging if the object is freed.
    * Where the value 8,338,607 is taken from PDF ref. manual, v.1.7,
@@ -238,6 +261,8 @@ static pdf_out pout;
 static int tectonic_pout_initialized = 0;
 static void init_pdf_out_struct (pdf_out *p);
 
+static void release_import_ref (void *ref);
+
 static pdf_out *
 current_output (void)
 {
@@ -269,6 +294,9 @@ init_pdf_out_struct (pdf_out *p)
   p->output.file_position = 0;
   p->output.line_position = 0;
   p->output.compression_saved = 0;
+  p->output.streams_compressed = 0;
+  p->output.bytes_before_compression = 0;
+  p->output.bytes_after_compression = 0;
 
   p->obj.next_label = 1;
   p->obj.max_ind_objects = 0;
@@ -282,14 +310,29 @@ init_pdf_out_struct (pdf_out *p)
   p->output_stream  = NULL;
   p->current_objstm = NULL;
 
+  ht_init_table(&p->imports.table, release_import_ref);
+  p->imports.objects = 0;
+  p->imports.bytes_saved = 0;
+
   p->free_list = NEW((PDF_NUM_INDIRECT_MAX+1)/8, char);
   memset(p->free_list, 0, (PDF_NUM_INDIRECT_MAX+1)/8);
   tectonic_pout_initialized = 1;
 }
 
+/* Tectonic: totals for the most recently finished output file, which outlive
+ * the pdf_out struct so that the driver can ask for them afterwards. */
+static pdf_output_stats last_output_stats;
+
+void
+pdf_get_output_stats (pdf_output_stats *stats)
+{
+  *stats = last_output_stats;
+}
+
 static void
 clean_pdf_out_struct (pdf_out *p)
 {
+  ht_clear_table(&p->imports.table);
   if (p->free_list)
     free(p->free_list);
   memset(p, 0, sizeof(pdf_out));
@@ -426,6 +469,7 @@ add_xref_entry (pdf_out *p, uint32_t label, uint8_t type, uint32_t field2, uint1
     p->xref_table[label].field3 = field3;
     p->xref_table[label].direct   = NULL;
     p->xref_table[label].indirect = NULL;
+    p->xref_table[label].importing = 0;
 }
 
 #define BINARY_MARKER "%\344\360\355\370\n"
@@ -677,10 +721,22 @@ pdf_out_flush (void)
             if (p->options.compression.level > 0) {
                 dpx_message("Compression saved %"PRIuZ" bytes\n", p->output.compression_saved);
             }
+            if (p->imports.objects > 0) {
+                dpx_message("Sharing identical imported objects saved %"PRIu64" bytes\n",
+                            p->imports.bytes_saved);
+            }
         }
 
         dpx_message("%"PRIuZ" bytes written", p->output.file_position);
 
+        last_output_stats.objects = p->obj.next_label - 1;
+        last_output_stats.bytes_written = p->output.file_position;
+        last_output_stats.streams_compressed = p->output.streams_compressed;
+        last_output_stats.bytes_before_compression = p->output.bytes_before_compression;
+        last_output_stats.bytes_after_compression = p->output.bytes_after_compression;
+        last_output_stats.imports_shared = p->imports.objects;
+        last_output_stats.import_bytes_saved = p->imports.bytes_saved;
+
         ttstub_output_close(p->output.handle);
         p->output.handle = INVALID_HANDLE;
         p->output.file_position = 0;
@@ -2099,6 +2155,10 @@ write_stream (pdf_out *p, pdf_stream *stream)
 
         buffer_length = (size_t) buffer_length64;
 
+        p->output.streams_compressed++;
+        p->output.bytes_before_compression += filtered_length;
+        p->output.bytes_after_compression += buffer_length;
+
         free(filtered);
         p->output.compression_saved += filtered_length - buffer_length
             - (filters ? strlen("/FlateDecode "): strlen("/Filter/FlateDecode\n"));
@@ -3030,17 +3090,70 @@ pdf_release_obj (pdf_obj *object)
 
 /* PDF reading starts around here */
 
+/* Tectonic: all reading of PDF files goes through these functions, which
+ * work on the in-memory copy of the file if there is one, so that parsing
+ * doesn't need a call through the bridge for every byte.
+ */
+
+static size_t
+pf_tell (pdf_file *pf)
+{
+    if (pf->data)
+        return pf->pos;
+    return ttstub_input_seek(pf->handle, 0, SEEK_CUR);
+}
+
+static void
+pf_seek (pdf_file *pf, size_t pos)
+{
+    if (pf->data)
+        pf->pos = pos;
+    else
+        ttstub_input_seek(pf->handle, pos, SEEK_SET);
+}
+
+static int
+pf_getc (pdf_file *pf)
+{
+    if (pf->data)
+        return pf->pos < (size_t) pf->file_size ? (unsigned char) pf->data[pf->pos++] : EOF;
+    return ttstub_input_getc(pf->handle);
+}
+
+static void
+pf_ungetc (pdf_file *pf, int c)
+{
+    if (pf->data)
+        pf->pos--;
+    else
+        ttstub_input_ungetc(pf->handle, c);
+}
+
+static size_t
+pf_read (pdf_file *pf, char *buf, size_t len)
+{
+    if (pf->data) {
+        if (pf->pos >= (size_t) pf->file_size)
+            return 0;
+        len = MIN(len, pf->file_size - pf->pos);
+        memcpy(buf, pf->data + pf->pos, len);
+        pf->pos += len;
+        return len;
+    }
+    return ttstub_input_read(pf->handle, buf, len);
+}
+
 /* As each lines may contain null-characters, so outptr here is NOT
  * null-terminated string. Returns -1 for when EOF is already reached, and -2
  * if buffer has no enough space.
  */
 static int
-tt_mfreadln (char *buf, int size, rust_input_handle_t handle)
+tt_mfreadln (char *buf, int size, pdf_file *pf)
 {
     int c;
     int len = 0;
 
-    while ((c = ttstub_input_getc(handle)) != EOF && c != '\n' && c != '\r') {
+    while ((c = pf_getc(pf)) != EOF && c != '\n' && c != '\r') {
         if (len >= size)
             return -2;
         buf[len++] = (char) c;
@@ -3049,8 +3162,8 @@ tt_mfreadln (char *buf, int size, rust_input_handle_t handle)
     if (c == EOF && len == 0)
         return -1;
 
-    if (c == '\r' && (c = ttstub_input_getc(handle)) >= 0 && (c != '\n'))
-        ttstub_input_ungetc(handle, c);
+    if (c == '\r' && (c = pf_getc(pf)) >= 0 && (c != '\n'))
+        pf_ungetc(pf, c);
 
     return len;
 }
@@ -3058,7 +3171,7 @@ tt_mfreadln (char *buf, int size, rust_input_handle_t handle)
 /* Reading external PDF files */
 
 static int
-backup_line (rust_input_handle_t handle)
+backup_line (pdf_file *pf)
 {
     int ch = -1;
 
@@ -3067,11 +3180,11 @@ backup_line (rust_input_handle_t handle)
      * unlikely in the last few bytes where this is likely to be used.
      */
 
-    if (ttstub_input_seek(handle, 0, SEEK_CUR) > 1) {
+    if (pf_tell(pf) > 1) {
         do
-            ttstub_input_seek(handle, -2, SEEK_CUR);
-        while (ttstub_input_seek(handle, 0, SEEK_CUR) > 0 &&
-               (ch = ttstub_input_getc(handle)) >= 0 &&
+            pf_seek(pf, pf_tell(pf) - 2);
+        while (pf_tell(pf) > 0 &&
+               (ch = pf_getc(pf)) >= 0 &&
                (ch != '\n' && ch != '\r' ));
     }
 
@@ -3081,7 +3194,7 @@ backup_line (rust_input_handle_t handle)
 }
 
 static int
-find_xref (rust_input_handle_t handle, int file_size)
+find_xref (pdf_file *pf)
 {
     size_t xref_pos = 0;
     int len, tries = 10;
@@ -3092,15 +3205,15 @@ find_xref (rust_input_handle_t handle, int file_size)
         size_t currentpos;
         int n;
 
-        if (!backup_line(handle)) {
+        if (!backup_line(pf)) {
             tries = 0;
             break;
         }
 
-        currentpos = ttstub_input_seek(handle, 0, SEEK_CUR);
-        n = MIN(strlen("startxref"), file_size - currentpos);
-        ttstub_input_read(handle, work_buffer, n);
-        ttstub_input_seek(handle, currentpos, SEEK_SET);
+        currentpos = pf_tell(pf);
+        n = MIN(strlen("startxref"), pf->file_size - currentpos);
+        pf_read(pf, work_buffer, n);
+        pf_seek(pf, currentpos);
         tries--;
     } while (tries > 0 && !strstartswith(work_buffer, "startxref"));
 
@@ -3108,9 +3221,9 @@ find_xref (rust_input_handle_t handle, int file_size)
         return 0;
 
     /* Skip rest of this line */
-    tt_mfgets(work_buffer, WORK_BUFFER_SIZE, handle);
+    tt_mfreadln(work_buffer, WORK_BUFFER_SIZE, pf);
     /* Next line of input file should contain actual xref location */
-    len = tt_mfreadln(work_buffer, WORK_BUFFER_SIZE, handle);
+    len = tt_mfreadln(work_buffer, WORK_BUFFER_SIZE, pf);
 
     if (len <= 0) {
         dpx_warning("Reading xref location data failed... Not a PDF file?");
@@ -3140,9 +3253,9 @@ parse_trailer (pdf_file *pf)
      * be made a bit more robust sometime.
      */
 
-    cur_pos = ttstub_input_seek(pf->handle, 0, SEEK_CUR);
+    cur_pos = pf_tell(pf);
     nmax = MIN(pf->file_size - cur_pos, WORK_BUFFER_SIZE);
-    nread = ttstub_input_read(pf->handle, work_buffer, nmax);
+    nread = pf_read(pf, work_buffer, nmax);
 
     if (nread == 0 || !strstartswith(work_buffer, "trailer")) {
         dpx_warning("No trailer.  Are you sure this is a PDF file?");
@@ -3166,22 +3279,49 @@ parse_trailer (pdf_file *pf)
  * :-(
  */
 static int
+cmp_offset (const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Tectonic: rather than checking every object, which makes reading all of
+ * the objects of a big file quadratic, look the next offset up in a sorted
+ * list of them.
+ */
+static int
 next_object_offset (pdf_file *pf, uint32_t obj_num)
 {
-    uint32_t next = pf->file_size;  /* Worst case */
-    size_t i;
-    uint32_t curr;
+    uint32_t curr = pf->xref_table[obj_num].field2;
+    size_t lo, hi;
 
-    curr = pf->xref_table[obj_num].field2;
-    /* Check all other type 1 objects to find next one */
-    for (i = 0; i < pf->num_obj; i++) {
-        if (pf->xref_table[i].type == 1 &&
-            pf->xref_table[i].field2 > curr &&
-            pf->xref_table[i].field2 < next)
-            next = pf->xref_table[i].field2;
+    if (!pf->offsets) {
+        size_t i;
+
+        pf->offsets = NEW(pf->num_obj + 1, uint32_t);
+        pf->num_offsets = 0;
+        for (i = 0; i < pf->num_obj; i++) {
+            if (pf->xref_table[i].type == 1 &&
+                pf->xref_table[i].field2 < (uint32_t) pf->file_size)
+                pf->offsets[pf->num_offsets++] = pf->xref_table[i].field2;
+        }
+        qsort(pf->offsets, pf->num_offsets, sizeof(uint32_t), cmp_offset);
+    }
+
+    /* Find the first offset after curr; the file size in the worst case. */
+    lo = 0;
+    hi = pf->num_offsets;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (pf->offsets[mid] <= curr)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
 
-    return  next;
+    return lo < pf->num_offsets ? pf->offsets[lo] : (uint32_t) pf->file_size;
 }
 
 #define checklabel(pf, n, g) ((n) > 0 && (n) < (pf)->num_obj && (       \
@@ -3220,13 +3360,25 @@ pdf_read_object (uint32_t obj_num, uint16_t obj_gen,
     if (length <= 0)
         return NULL;
 
-    buffer = NEW(length + 1, char);
+    if (pf->data) {
+        /* Tectonic: parse the object where it is. */
+        if (limit > (size_t) pf->file_size)
+            limit = pf->file_size;
+        if (offset >= limit)
+            return NULL;
+
+        buffer = NULL;
+        p = pf->data + offset;
+        endptr = pf->data + limit;
+    } else {
+        buffer = NEW(length + 1, char);
 
-    ttstub_input_seek(pf->handle, offset, SEEK_SET);
-    ttstub_input_read(pf->handle, buffer, length);
+        ttstub_input_seek(pf->handle, offset, SEEK_SET);
+        ttstub_input_read(pf->handle, buffer, length);
 
-    p = buffer;
-    endptr = p + length;
+        p = buffer;
+        endptr = p + length;
+    }
 
     /* Check for obj_num and obj_gen */
     {
@@ -3497,10 +3649,13 @@ extend_xref (pdf_file *pf, size_t new_size)
 {
     size_t i;
 
+    pf->offsets = mfree(pf->offsets);
+
     pf->xref_table = RENEW(pf->xref_table, new_size, xref_entry);
     for (i = pf->num_obj; i < new_size; i++) {
         pf->xref_table[i].direct   = NULL;
         pf->xref_table[i].indirect = NULL;
+        pf->xref_table[i].importing = 0;
         pf->xref_table[i].type     = 0;
         pf->xref_table[i].field3 = 0;
         pf->xref_table[i].field2 = 0L;
@@ -3520,8 +3675,9 @@ parse_xref_table (pdf_file *pf, size_t xref_pos)
      * This routine reads one xref segment. It may be called multiple times
      * on the same file.  xref tables sometimes come in pieces.
      */
-    ttstub_input_seek(pf->handle, xref_pos, SEEK_SET);
-    len = tt_mfreadln(buf, 255, pf->handle);
+    pf->offsets = mfree(pf->offsets);
+    pf_seek(pf, xref_pos);
+    len = tt_mfreadln(buf, 255, pf);
 
     /* We should have already checked that "startxref" section exists. So, EOF
      * here (len = -1) is impossible. We don't treat too long line case
@@ -3553,8 +3709,8 @@ parse_xref_table (pdf_file *pf, size_t xref_pos)
         int          i;
         uint32_t     first, obj_gen;
 
-        current_pos = ttstub_input_seek(pf->handle, 0, SEEK_CUR);
-        len = tt_mfreadln(buf, 255, pf->handle);
+        current_pos = pf_tell(pf);
+        len = tt_mfreadln(buf, 255, pf);
         if (len == 0) /* empty line... just skip. */
             continue;
         else if (len < 0) {
@@ -3576,7 +3732,7 @@ parse_xref_table (pdf_file *pf, size_t xref_pos)
              * parse_trailer would fail.
              */
             current_pos += p - buf; /* Jump to the beginning of "trailer" keyword. */
-            ttstub_input_seek(pf->handle, current_pos, SEEK_SET);
+            pf_seek(pf, current_pos);
             break;
         }
 
@@ -3633,7 +3789,7 @@ parse_xref_table (pdf_file *pf, size_t xref_pos)
              * More than one "white-spaces" allowed, can be ended with a comment,
              * and so on.
              */
-            len = tt_mfreadln(buf, 255, pf->handle);
+            len = tt_mfreadln(buf, 255, pf);
             if (len == 0) /* empty line...just skip. */
                 continue;
             else if (len < 0) {
@@ -3746,6 +3902,7 @@ parse_xrefstm_subsec (pdf_file *pf,
     */
     *length -= wsum*size;
 
+    pf->offsets = mfree(pf->offsets);
     if (pf->num_obj < first+size)
         extend_xref(pf, first+size);  /* TODO: change! why? */
 
@@ -3859,7 +4016,7 @@ read_xref (pdf_file *pf)
     pdf_obj *trailer = NULL, *main_trailer = NULL;
     size_t      xref_pos;
 
-    if (!(xref_pos = find_xref(pf->handle, pf->file_size)))
+    if (!(xref_pos = find_xref(pf)))
         goto error;
 
     while (xref_pos) {
@@ -3919,6 +4076,15 @@ error:
 
 static struct ht_table *pdf_files = NULL;
 
+/* Tectonic: included PDF files are read into memory in one go, if they fit
+ * within this many bytes in total, so that parsing them is just a matter of
+ * moving pointers. Beyond that, files are read through their handles as they
+ * are parsed, to bound memory use for documents that include lots of big
+ * files. */
+#define PDF_FILE_DATA_LIMIT (256u << 20)
+
+static size_t pdf_file_data_size = 0;
+
 static pdf_file *
 pdf_file_new (rust_input_handle_t handle)
 {
@@ -3934,6 +4100,26 @@ pdf_file_new (rust_input_handle_t handle)
     pf->num_obj = 0;
     pf->version = 0;
     pf->file_size = ttstub_input_get_size(handle);
+    pf->data = NULL;
+    pf->pos = 0;
+    pf->offsets = NULL;
+    pf->num_offsets = 0;
+
+    if (pf->file_size > 0 && pf->file_size <= PDF_FILE_DATA_LIMIT - pdf_file_data_size) {
+        /* Pad with NULs, since the parsers may look a few bytes past the
+         * end of what they're parsing. */
+        pf->data = NEW(pf->file_size + 8, char);
+        memset(pf->data + pf->file_size, 0, 8);
+
+        ttstub_input_seek(handle, 0, SEEK_SET);
+        if (ttstub_input_read(handle, pf->data, pf->file_size) == pf->file_size) {
+            pdf_file_data_size += pf->file_size;
+            pf->pos = pf->file_size;
+            return pf;
+        }
+
+        pf->data = mfree(pf->data);
+    }
 
     ttstub_input_seek(handle, 0, SEEK_END);
 
@@ -3958,6 +4144,12 @@ pdf_file_free (pdf_file *pf)
     pdf_release_obj(pf->trailer);
     pdf_release_obj(pf->catalog);
 
+    if (pf->data) {
+        pdf_file_data_size -= pf->file_size;
+        free(pf->data);
+    }
+    free(pf->offsets);
+
     free(pf);
 }
 
@@ -3966,6 +4158,9 @@ pdf_files_init (void)
 {
     pdf_files = NEW(1, struct ht_table);
     ht_init_table(pdf_files, (void (*)(void *)) pdf_file_free);
+    /* Tectonic: if a previous run aborted, its files were never freed, so
+     * don't let them count against the in-memory budget forever. */
+    pdf_file_data_size = 0;
 }
 
 int
@@ -4134,6 +4329,148 @@ import_dict (pdf_obj *key, pdf_obj *value, void *pdata)
     return 0;
 }
 
+/* Tectonic: sharing of identical imported objects.
+ *
+ * Documents that include many PDF figures made by the same program tend to
+ * embed the same font subsets, color profiles and so on over and over. Once
+ * an indirect object has been imported, we compute a digest of its content,
+ * and if we have already imported an object with the same digest, we refer
+ * to that one instead of writing another copy. References to other objects
+ * are encoded by their labels in the output file. Objects are imported
+ * depth-first, so the objects that one refers to have already been shared
+ * where possible by the time that it is digested, and whole trees of
+ * identical objects collapse into one.
+ */
+
+#define IMPORT_DIGEST_LEN 32
+
+static void
+release_import_ref (void *ref)
+{
+    pdf_release_obj(ref);
+}
+
+static void
+import_digest_bytes (SHA256_CONTEXT *ctx, const void *data, size_t length)
+{
+    const unsigned char *p = data;
+
+    while (length > 0) {
+        unsigned int n = (unsigned int) MIN(length, 0x40000000);
+
+        SHA256_write(ctx, p, n);
+        p += n;
+        length -= n;
+    }
+}
+
+/* Add OBJECT to the digest, and return the number of bytes of content that it
+ * holds, as an estimate of how much space it takes in the output. */
+static size_t
+import_digest_obj (SHA256_CONTEXT *ctx, pdf_obj *object)
+{
+    unsigned char type = (unsigned char) object->type;
+    size_t size = 0;
+
+    import_digest_bytes(ctx, &type, 1);
+
+    switch (object->type) {
+    case PDF_BOOLEAN:
+        import_digest_bytes(ctx, &((pdf_boolean *) object->data)->value, 1);
+        return 1;
+    case PDF_NUMBER:
+        import_digest_bytes(ctx, &((pdf_number *) object->data)->value, sizeof(double));
+        return sizeof(double);
+    case PDF_STRING:
+    {
+        pdf_string *data = object->data;
+
+        import_digest_bytes(ctx, &data->length, sizeof(data->length));
+        import_digest_bytes(ctx, data->string, data->length);
+        return data->length;
+    }
+    case PDF_NAME:
+    {
+        const char *name = ((pdf_name *) object->data)->name;
+
+        size = strlen(name) + 1;
+        import_digest_bytes(ctx, name, size);
+        return size;
+    }
+    case PDF_ARRAY:
+    {
+        pdf_array *data = object->data;
+        size_t i;
+
+        import_digest_bytes(ctx, &data->size, sizeof(data->size));
+
+        for (i = 0; i < data->size; i++) {
+            if (data->values[i])
+                size += import_digest_obj(ctx, data->values[i]);
+            else
+                import_digest_bytes(ctx, "", 1);
+        }
+
+        return size;
+    }
+    case PDF_DICT:
+    {
+        pdf_dict *data;
+
+        for (data = object->data; data->key != NULL; data = data->next) {
+            size += import_digest_obj(ctx, data->key);
+            size += import_digest_obj(ctx, data->value);
+        }
+
+        import_digest_bytes(ctx, "", 1);
+        return size;
+    }
+    case PDF_STREAM:
+    {
+        pdf_stream *data = object->data;
+
+        size = import_digest_obj(ctx, data->dict);
+        import_digest_bytes(ctx, &data->_flags, sizeof(data->_flags));
+        import_digest_bytes(ctx, &data->stream_length, sizeof(data->stream_length));
+        import_digest_bytes(ctx, data->stream, data->stream_length);
+        return size + data->stream_length;
+    }
+    case PDF_INDIRECT:
+    {
+        pdf_indirect *data = object->data;
+
+        import_digest_bytes(ctx, &data->label, sizeof(data->label));
+        import_digest_bytes(ctx, &data->generation, sizeof(data->generation));
+        return 0;
+    }
+    }
+
+    return 0;
+}
+
+/* Objects that stand for a particular place in the document rather than just
+ * holding data, which mustn't be shared even if their content is the same. */
+static int
+import_is_shareable (pdf_obj *object)
+{
+    pdf_obj *dict, *type;
+
+    if (pdf_obj_typeof(object) == PDF_STREAM)
+        dict = pdf_stream_dict(object);
+    else if (pdf_obj_typeof(object) == PDF_DICT)
+        dict = object;
+    else
+        return 1;
+
+    type = pdf_lookup_dict(dict, "Type");
+    if (!PDF_OBJ_NAMETYPE(type))
+        return 1;
+
+    return !(pdf_match_name(type, "Page") || pdf_match_name(type, "Pages") ||
+             pdf_match_name(type, "Annot") || pdf_match_name(type, "StructElem") ||
+             pdf_match_name(type, "Outlines"));
+}
+
 static pdf_obj *
 pdf_import_indirect (pdf_obj *object)
 {
@@ -4151,7 +4488,12 @@ pdf_import_indirect (pdf_obj *object)
     }
 
     ref = pf->xref_table[obj_num].indirect;
-    if (!ref) {
+    if (ref && pf->xref_table[obj_num].importing) {
+        /* A reference back to an object that we're still importing; its
+         * reserved label is now in use, so it mustn't be replaced by a
+         * shared copy. */
+        pf->xref_table[obj_num].importing = 2;
+    } else if (!ref) {
         pdf_obj *obj, *reserved, *imported;
 
         obj = pdf_get_object(pf, obj_num, obj_gen);
@@ -4171,7 +4513,42 @@ pdf_import_indirect (pdf_obj *object)
         */
         reserved = pdf_new_null(); /* for reservation of label */
         pf->xref_table[obj_num].indirect = ref = pdf_new_ref(p, reserved);
+        pf->xref_table[obj_num].importing = 1;
         imported = pdf_import_object(obj);
+        if (imported && !imported->label && import_is_shareable(imported)) {
+            SHA256_CONTEXT ctx;
+            unsigned char digest[IMPORT_DIGEST_LEN];
+            pdf_obj *shared;
+            size_t size;
+
+            SHA256_init(&ctx);
+            size = import_digest_obj(&ctx, imported);
+            SHA256_final(digest, &ctx);
+
+            shared = ht_lookup_table(&p->imports.table, digest, IMPORT_DIGEST_LEN);
+
+            if (!shared) {
+                ht_append_table(&p->imports.table, digest, IMPORT_DIGEST_LEN,
+                                pdf_link_obj(ref));
+            } else if (pf->xref_table[obj_num].importing == 1) {
+                /* Nothing refers to the label that we reserved, so we can
+                 * give it up. It has to be listed as free in the xref. */
+                add_xref_entry(p, reserved->label, 0, 0, 0);
+                reserved->label = 0;
+                reserved->generation = 0;
+
+                pf->xref_table[obj_num].indirect = pdf_link_obj(shared);
+                pdf_release_obj(ref);
+                ref = shared;
+
+                pdf_release_obj(imported);
+                imported = NULL;
+
+                p->imports.objects++;
+                p->imports.bytes_saved += size;
+            }
+        }
+        pf->xref_table[obj_num].importing = 0;
         if (imported) {
             if (imported->label) {
                 dpx_warning("Imported object already has a label: obj_id=%u", imported->label);
@@ -4397,6 +4774,7 @@ pdf_obj_reset_global_state(void)
     p->output.file_position = 0;
     p->output.line_position = 0;
     p->output.compression_saved = 0;
+    memset(&last_output_stats, 0, sizeof(last_output_stats));
 
     tectonic_pout_initialized = 0;
 }
@@ -72,6 +72,18 @@ pdf_out *pdf_out_init      (const char *filename,
                             int enable_predictor);
 void pdf_out_set_encrypt (int keybits, int32_t permission, const char *opasswd, const char *upasswd, int use_aes, int encrypt_metadata);
 void     pdf_out_flush     (void);
+
+typedef struct pdf_output_stats {
+  uint64_t objects;                  /* indirect objects written */
+  uint64_t bytes_written;
+  uint64_t streams_compressed;
+  uint64_t bytes_before_compression; /* stream data fed to the compressor */
+  uint64_t bytes_after_compression;  /* ... and what came out of it */
+  uint64_t imports_shared;           /* imported objects replaced by identical ones */
+  uint64_t import_bytes_saved;       /* ... and the size of their content */
+} pdf_output_stats;
+
+void     pdf_get_output_stats (pdf_output_stats *stats);
 int pdf_get_version (void);
 int pdf_get_version_major (void);
 int pdf_get_version_minor (void);
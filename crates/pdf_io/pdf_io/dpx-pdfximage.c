@@ -321,6 +321,12 @@ load_image (const char *ident, const char *filename, const char *fullname,
         goto error;
     }
 
+    /* XeTeX can measure these types of images itself, so it can use what we
+     * learned. */
+    if (format == IMAGE_TYPE_JPEG || format == IMAGE_TYPE_PNG || format == IMAGE_TYPE_BMP)
+        pdf_ximage_cache_bitmap_size(handle, I->attr.width, I->attr.height,
+                                     I->attr.xdensity, I->attr.ydensity);
+
     switch (I->subtype) {
     case PDF_XOBJECT_TYPE_IMAGE:
         sprintf(I->res_name, "Im%d", id);
@@ -1006,6 +1012,111 @@ check_for_ps (rust_input_handle_t handle)
     return 0;
 }
 
+/* Tectonic: XeTeX has to parse every image that it includes just to measure
+ * it, on every pass, and then xdvipdfmx parses the same images to embed them.
+ * Both save what they learn with the driver, which keys it by the contents of
+ * the file, so that measuring an image again doesn't require parsing it.
+ * Doubles are saved with enough digits to get exactly the same values back, so
+ * that the output doesn't depend on whether the cache was used.
+ */
+
+#define METADATA_BUF_SIZE 512
+
+static int
+get_cached_string (rust_input_handle_t handle, const char *key, char *buf, size_t size)
+{
+    ssize_t len = ttstub_input_get_metadata(handle, key, buf, size);
+
+    return len >= 0 && (size_t) len < size && strlen(buf) == (size_t) len;
+}
+
+static void
+cache_string (rust_input_handle_t handle, const char *key, const char *value)
+{
+    ttstub_input_put_metadata(handle, key, value, strlen(value));
+}
+
+int
+pdf_ximage_get_cached_page_count (rust_input_handle_t handle)
+{
+    char buf[METADATA_BUF_SIZE];
+    int  count;
+
+    if (!get_cached_string(handle, "pdf-pages", buf, sizeof(buf)))
+        return -1;
+    if (sscanf(buf, "%d", &count) != 1 || count < 0)
+        return -1;
+
+    return count;
+}
+
+void
+pdf_ximage_cache_page_count (rust_input_handle_t handle, int count)
+{
+    char buf[METADATA_BUF_SIZE];
+
+    snprintf(buf, sizeof(buf), "%d", count);
+    cache_string(handle, "pdf-pages", buf);
+}
+
+int
+pdf_ximage_get_cached_page_info (rust_input_handle_t handle, int page_no, int bbox_type,
+                                 pdf_rect *bbox, pdf_tmatrix *matrix)
+{
+    char key[64], buf[METADATA_BUF_SIZE];
+
+    snprintf(key, sizeof(key), "pdf-page:%d:%d", page_no, bbox_type);
+
+    if (!get_cached_string(handle, key, buf, sizeof(buf)))
+        return -1;
+    if (sscanf(buf, "%lf %lf %lf %lf %lf %lf %lf %lf %lf %lf",
+               &bbox->llx, &bbox->lly, &bbox->urx, &bbox->ury,
+               &matrix->a, &matrix->b, &matrix->c, &matrix->d,
+               &matrix->e, &matrix->f) != 10)
+        return -1;
+
+    return 0;
+}
+
+void
+pdf_ximage_cache_page_info (rust_input_handle_t handle, int page_no, int bbox_type,
+                            const pdf_rect *bbox, const pdf_tmatrix *matrix)
+{
+    char key[64], buf[METADATA_BUF_SIZE];
+
+    snprintf(key, sizeof(key), "pdf-page:%d:%d", page_no, bbox_type);
+    snprintf(buf, sizeof(buf), "%.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g",
+             bbox->llx, bbox->lly, bbox->urx, bbox->ury,
+             matrix->a, matrix->b, matrix->c, matrix->d, matrix->e, matrix->f);
+    cache_string(handle, key, buf);
+}
+
+int
+pdf_ximage_get_cached_bitmap_size (rust_input_handle_t handle,
+                                   unsigned int *width, unsigned int *height,
+                                   double *xdensity, double *ydensity)
+{
+    char buf[METADATA_BUF_SIZE];
+
+    if (!get_cached_string(handle, "bitmap-size", buf, sizeof(buf)))
+        return -1;
+    if (sscanf(buf, "%u %u %lf %lf", width, height, xdensity, ydensity) != 4)
+        return -1;
+
+    return 0;
+}
+
+void
+pdf_ximage_cache_bitmap_size (rust_input_handle_t handle,
+                              unsigned int width, unsigned int height,
+                              double xdensity, double ydensity)
+{
+    char buf[METADATA_BUF_SIZE];
+
+    snprintf(buf, sizeof(buf), "%u %u %.17g %.17g", width, height, xdensity, ydensity);
+    cache_string(handle, "bitmap-size", buf);
+}
+
 /* Cannot use _tt_abort() (dpx: "ERROR()") here */
 void
 pdf_error_cleanup_cache (void)
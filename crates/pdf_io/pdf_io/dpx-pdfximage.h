@@ -100,4 +100,19 @@ pdf_ximage_set_attr (int xobj_id,
 
 extern void pdf_error_cleanup_cache(void);
 
+/* Tectonic: image metadata shared between XeTeX and xdvipdfmx through the
+ * driver. The getters return -1 if nothing is saved. */
+int  pdf_ximage_get_cached_page_count (rust_input_handle_t handle);
+void pdf_ximage_cache_page_count      (rust_input_handle_t handle, int count);
+int  pdf_ximage_get_cached_page_info  (rust_input_handle_t handle, int page_no, int bbox_type,
+                                       pdf_rect *bbox, pdf_tmatrix *matrix);
+void pdf_ximage_cache_page_info       (rust_input_handle_t handle, int page_no, int bbox_type,
+                                       const pdf_rect *bbox, const pdf_tmatrix *matrix);
+int  pdf_ximage_get_cached_bitmap_size (rust_input_handle_t handle,
+                                        unsigned int *width, unsigned int *height,
+                                        double *xdensity, double *ydensity);
+void pdf_ximage_cache_bitmap_size      (rust_input_handle_t handle,
+                                        unsigned int width, unsigned int height,
+                                        double xdensity, double ydensity);
+
 #endif /* _PDFXIMAGE_H_ */
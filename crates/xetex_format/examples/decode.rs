@@ -21,6 +21,7 @@ impl Options {
             Commands::Actives(c) => c.execute_actives(),
             Commands::Catcodes(c) => c.execute_catcodes(),
             Commands::ControlSequences(c) => c.execute(),
+            Commands::CsHashStats(c) => c.execute_cshash_stats(),
             Commands::Strings(c) => c.execute_strings(),
         }
     }
@@ -35,6 +36,9 @@ enum Commands {
     #[command(name = "cseqs")]
     /// Dump the control sequences
     ControlSequences(CseqsCommand),
+    #[command(name = "cshash-stats")]
+    /// Report collision-chain statistics for the control-sequence hash table
+    CsHashStats(GenericCommand),
     /// Dump the strings table
     Strings(GenericCommand),
 }
@@ -70,6 +74,14 @@ impl GenericCommand {
         Ok(())
     }
 
+    fn execute_cshash_stats(self) -> Result<()> {
+        let fmt = self.parse()?;
+        let stdout = std::io::stdout();
+        let mut lock = stdout.lock();
+        fmt.dump_cshash_stats(&mut lock)?;
+        Ok(())
+    }
+
     fn execute_strings(self) -> Result<()> {
         let fmt = self.parse()?;
         let stdout = std::io::stdout();
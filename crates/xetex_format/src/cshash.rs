@@ -29,6 +29,52 @@ pub fn initialize_cshash_symbols(symbols: &mut SymbolTable) -> Result<()> {
     Ok(())
 }
 
+/// Statistics about the collision chains of a control-sequence hash table.
+#[derive(Clone, Debug, Default, Eq, PartialEq)]
+pub struct ChainStats {
+    /// The number of primary buckets (`HASH_PRIME`).
+    pub n_buckets: usize,
+
+    /// The number of primary buckets whose chains are nonempty.
+    pub n_used_buckets: usize,
+
+    /// The total number of multi-letter control sequences in the table.
+    pub n_entries: usize,
+
+    /// The length of the longest chain.
+    pub max_chain: usize,
+
+    /// The total number of entries that successful lookups of every control
+    /// sequence in the table would visit, i.e. the sum over all chains of
+    /// `n * (n + 1) / 2`.
+    pub total_probes: usize,
+
+    /// `histogram[n]` is the number of primary buckets with chains of length
+    /// `n`.
+    pub histogram: Vec<usize>,
+}
+
+impl ChainStats {
+    /// The mean number of entries visited by a successful lookup.
+    pub fn mean_probes(&self) -> f64 {
+        if self.n_entries == 0 {
+            0.
+        } else {
+            self.total_probes as f64 / self.n_entries as f64
+        }
+    }
+
+    /// The mean length of the nonempty chains, which is the number of
+    /// entries visited by an unsuccessful lookup that lands in one.
+    pub fn mean_used_chain(&self) -> f64 {
+        if self.n_used_buckets == 0 {
+            0.
+        } else {
+            self.n_entries as f64 / self.n_used_buckets as f64
+        }
+    }
+}
+
 #[derive(Debug)]
 pub struct ControlSeqHash {
     need_offset_hash: Vec<u8>,
@@ -175,6 +221,49 @@ impl ControlSeqHash {
         }
     }
 
+    /// Compute statistics about the collision chains of the table, as walked
+    /// by TeX's `id_lookup`.
+    pub fn chain_stats(&self) -> ChainStats {
+        let mut stats = ChainStats {
+            n_buckets: self.hash_prime as usize,
+            ..Default::default()
+        };
+
+        for h in 0..self.hash_prime as i32 {
+            let mut p = h + self.hash_base;
+            let mut n = 0;
+
+            loop {
+                let (str_ptr, next_ptr) = self.decode(p);
+
+                if str_ptr > 0 {
+                    n += 1;
+                }
+
+                if next_ptr == 0 {
+                    break;
+                }
+
+                p = next_ptr;
+            }
+
+            if n > 0 {
+                stats.n_used_buckets += 1;
+            }
+
+            if stats.histogram.len() <= n {
+                stats.histogram.resize(n + 1, 0);
+            }
+
+            stats.histogram[n] += 1;
+            stats.n_entries += n;
+            stats.max_chain = stats.max_chain.max(n);
+            stats.total_probes += n * (n + 1) / 2;
+        }
+
+        stats
+    }
+
     /// Similar to TeX's `print_cs`
     pub fn stringify(&self, p: EqtbPointer, strings: &StringTable) -> Option<String> {
         if p < self.hash_base {
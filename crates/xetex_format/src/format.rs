@@ -177,6 +177,36 @@ impl Format {
         Ok(())
     }
 
+    pub fn dump_cshash_stats<W: Write>(&self, stream: &mut W) -> Result<()> {
+        let stats = self.cshash.chain_stats();
+
+        writeln!(
+            stream,
+            "{} multi-letter control sequences in {} buckets ({} used)",
+            stats.n_entries, stats.n_buckets, stats.n_used_buckets
+        )?;
+        writeln!(stream, "longest chain: {}", stats.max_chain)?;
+        writeln!(
+            stream,
+            "mean chain length (nonempty buckets): {:.2}",
+            stats.mean_used_chain()
+        )?;
+        writeln!(
+            stream,
+            "mean entries visited per successful lookup: {:.2}",
+            stats.mean_probes()
+        )?;
+        writeln!(stream, "chain length histogram:")?;
+
+        for (n, count) in stats.histogram.iter().enumerate() {
+            if *count > 0 {
+                writeln!(stream, "    {n:>4}: {count}")?;
+            }
+        }
+
+        Ok(())
+    }
+
     fn cseqs(&self) -> impl Iterator<Item = (String, EqtbPointer)> {
         // This is lame; we shouldn't need to make a big buffer, but I'm too
         // lazy to write real iterater implementation right now.
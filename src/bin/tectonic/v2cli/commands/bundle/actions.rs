@@ -3,14 +3,21 @@ use super::{
     pack::bundlev1::BundleV1,
     select::{picker::FilePicker, spec::BundleSpec},
 };
-use anyhow::{Context, Result};
+use anyhow::{bail, Context, Result};
+use sha2::{Digest, Sha256};
 use std::{
     cmp::Ordering,
     fs::{self, File},
     io::Read,
+    path::Path,
     thread,
     time::Duration,
 };
+use tectonic::{
+    driver::ProcessingSessionBuilder, errors::SyncError, io::format_cache::prebuilt_format_path,
+};
+use tectonic_bundles::ttb_fs::TTBFsBundle;
+use tectonic_status_base::StatusBackend;
 use tracing::{error, info, warn};
 
 pub(super) fn select(cli: &BundleCreateCommand) -> Result<()> {
@@ -99,7 +106,7 @@ pub(super) fn select(cli: &BundleCreateCommand) -> Result<()> {
     Ok(())
 }
 
-pub(super) fn pack(cli: &BundleCreateCommand) -> Result<()> {
+pub(super) fn pack(cli: &BundleCreateCommand, status: &mut dyn StatusBackend) -> Result<()> {
     let mut file = File::open(&cli.bundle_spec)?;
     let mut file_str = String::new();
     file.read_to_string(&mut file_str)?;
@@ -129,9 +136,129 @@ pub(super) fn pack(cli: &BundleCreateCommand) -> Result<()> {
 
     match cli.format {
         BundleFormat::BundleV1 => {
-            BundleV1::make(Box::new(File::create(target)?), build_dir.clone())?
+            BundleV1::make(Box::new(File::create(&target)?), build_dir.clone())?
+        }
+    }
+
+    // Now that we have a bundle, we can use it to generate the formats that it
+    // defines. If there are any, pack again to include them.
+    if add_prebuilt_formats(&build_dir, &target, status)? {
+        fs::remove_file(&target)?;
+
+        match cli.format {
+            BundleFormat::BundleV1 => {
+                BundleV1::make(Box::new(File::create(&target)?), build_dir.clone())?
+            }
         }
     }
 
     Ok(())
 }
+
+/// Generate the formats defined by the bundle at `bundle_path`, save them in
+/// the `formats` directory of the content dir, and add them to `FILELIST`.
+///
+/// Formats are defined by `tectonic-format-<stem>.tex` files. The prebuilt
+/// formats are only usable by engines with the same format serial as this
+/// one; others will just generate their own. `SHA256SUM` is left alone, so
+/// that the bundle hash still identifies the bundle's TeX files. Returns
+/// whether any formats were added.
+fn add_prebuilt_formats(
+    build_dir: &Path,
+    bundle_path: &Path,
+    status: &mut dyn StatusBackend,
+) -> Result<bool> {
+    let content_dir = build_dir.join("content");
+    let filelist_path = content_dir.join("FILELIST");
+
+    // FILELIST lines are `<hash> <path>`. Drop formats left over from a
+    // previous run of this job; they'll be regenerated.
+    let mut filelist: Vec<(String, String)> = fs::read_to_string(&filelist_path)?
+        .lines()
+        .filter_map(|l| l.split_once(' '))
+        .filter(|(_, path)| !path.starts_with("formats/"))
+        .map(|(hash, path)| (hash.to_owned(), path.to_owned()))
+        .collect();
+
+    let stems: Vec<String> = filelist
+        .iter()
+        .filter_map(|(_, path)| {
+            let name = path.rsplit('/').next()?;
+            let stem = name
+                .strip_prefix("tectonic-format-")?
+                .strip_suffix(".tex")?;
+            Some(stem.to_owned())
+        })
+        .collect();
+
+    if stems.is_empty() {
+        info!("bundle doesn't define any formats");
+        return Ok(false);
+    }
+
+    for stem in stems {
+        let fmt_name = format!("{stem}.fmt");
+        info!("generating prebuilt format `{fmt_name}`");
+
+        // The session saves the format into its format cache, under a name
+        // that depends on the bundle hash. Give it an empty cache so that we
+        // can just take whatever shows up there.
+        let cache_dir = tempfile::tempdir()?;
+
+        let mut sb = ProcessingSessionBuilder::default();
+        sb.bundle(Box::new(TTBFsBundle::open(bundle_path)?))
+            .primary_input_buffer(b"")
+            .tex_input_name("texput.tex")
+            .format_name(&fmt_name)
+            .format_cache_path(cache_dir.path())
+            .build_date_from_env(true)
+            .do_not_write_output_files();
+
+        let mut sess = sb.create(status).map_err(SyncError::new)?;
+        sess.generate_format(status).map_err(SyncError::new)?;
+
+        let mut data = None;
+
+        for entry in fs::read_dir(cache_dir.path())? {
+            let path = entry?.path();
+
+            if path.extension().is_some_and(|e| e == "fmt") {
+                data = Some(fs::read(path)?);
+            }
+        }
+
+        let Some(data) = data else {
+            bail!("generating format `{fmt_name}` didn't produce a format file");
+        };
+
+        let fmt_path = prebuilt_format_path(&fmt_name)?;
+        let digest_path = format!("{fmt_path}.sha256");
+        let fmt_hash = hex_sha256(&data);
+        let digest_data = format!("{fmt_hash}\n");
+
+        fs::create_dir_all(content_dir.join("formats"))?;
+        fs::write(content_dir.join(&fmt_path), &data)?;
+        fs::write(content_dir.join(&digest_path), &digest_data)?;
+
+        filelist.push((fmt_hash, fmt_path));
+        filelist.push((hex_sha256(digest_data.as_bytes()), digest_path));
+    }
+
+    filelist.sort_by(|a, b| a.1.cmp(&b.1));
+
+    let mut text = String::new();
+    for (hash, path) in &filelist {
+        text.push_str(&format!("{hash} {path}\n"));
+    }
+    fs::write(&filelist_path, text).context("while writing FILELIST")?;
+
+    Ok(true)
+}
+
+fn hex_sha256(data: &[u8]) -> String {
+    Sha256::digest(data)
+        .iter()
+        .map(|b| format!("{b:02x}"))
+        .collect::<Vec<_>>()
+        .concat()
+}
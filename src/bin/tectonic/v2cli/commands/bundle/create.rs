@@ -92,7 +92,7 @@ impl TectonicCommand for BundleCreateCommand {
         cc.always_stderr = true;
     }
 
-    fn execute(self, _config: PersistentConfig, _status: &mut dyn StatusBackend) -> Result<i32> {
+    fn execute(self, _config: PersistentConfig, status: &mut dyn StatusBackend) -> Result<i32> {
         if self.job.do_select() {
             match super::actions::select(&self) {
                 Ok(_) => {}
@@ -104,7 +104,7 @@ impl TectonicCommand for BundleCreateCommand {
         }
 
         if self.job.do_pack() {
-            match super::actions::pack(&self) {
+            match super::actions::pack(&self, status) {
                 Ok(_) => {}
                 Err(e) => {
                     error!("bundle packer failed with error: {e}");
@@ -1,5 +1,3 @@
-use std::io::Write;
-
 use clap::Parser;
 use tectonic::{
     config::PersistentConfig,
@@ -85,7 +83,7 @@ impl TectonicCommand for DumpCommand {
                 if key.ends_with(&self.filename) {
                     found_any = true;
                     ctry!(
-                        std::io::stdout().write_all(&info.data[..]);
+                        info.write_to(&mut std::io::stdout());
                         "error dumping intermediate file `{}`", key
                     );
                 }
@@ -104,7 +102,7 @@ impl TectonicCommand for DumpCommand {
                 .get(&self.filename)
                 .ok_or_else(|| format!("no such intermediate file `{}`", self.filename))?;
             ctry!(
-                std::io::stdout().write_all(&info.data[..]);
+                info.write_to(&mut std::io::stdout());
                 "error dumping intermediate file `{}`", self.filename
             );
         }
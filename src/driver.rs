@@ -16,7 +16,7 @@
 use byte_unit::{Byte, UnitType};
 use quick_xml::{events::Event, NsReader};
 use std::{
-    collections::{HashMap, HashSet},
+    collections::{BTreeMap, HashMap, HashSet},
     fs::File,
     io::{Cursor, Read, Write},
     path::{Path, PathBuf},
@@ -24,13 +24,14 @@ use std::{
     rc::Rc,
     result::Result as StdResult,
     str::FromStr,
-    time::{Duration, SystemTime},
+    time::{Duration, Instant, SystemTime},
 };
 use tectonic_bridge_core::{CoreBridgeLauncher, DriverHooks, SecuritySettings, SystemRequestError};
 use tectonic_bundles::Bundle;
 use tectonic_engine_spx2html::AssetSpecification;
 use tectonic_io_base::{
-    digest::DigestData,
+    app_dirs,
+    digest::{self, Digest, DigestData, StreamDigest},
     filesystem::{FilesystemIo, FilesystemPrimaryInputIo},
     stdstreams::{BufferedPrimaryIo, GenuineStdoutIo},
     InputHandle, IoProvider, OpenResult, OutputHandle,
@@ -43,8 +44,11 @@ use crate::{
     io::{
         format_cache::FormatCache,
         memory::{MemoryFileCollection, MemoryIo},
+        metadata_cache::MetadataCache,
+        shell_escape_cache::ShellEscapeCache,
         InputOrigin,
     },
+    stats::{FileIoStats, LookupCacheStats, PhaseStats, SessionStats},
     status::StatusBackend,
     tt_error, tt_note, tt_warning,
     unstable_opts::UnstableOptions,
@@ -93,11 +97,11 @@ struct FileSummary {
     /// There's some chance that this will be `None` even if the file was read. Tectonic makes an
     /// effort to compute the digest as the data is being read from the file, but this can fail if
     /// tex decides to seek in the file as it is being written.
-    pub read_digest: Option<DigestData>,
+    pub read_digest: Option<StreamDigest>,
 
     /// If this file was written, this is the digest of its contents at the time it was last
     /// written.
-    pub write_digest: Option<DigestData>,
+    pub write_digest: Option<StreamDigest>,
 
     got_written_to_disk: bool,
 }
@@ -239,6 +243,15 @@ struct BridgeState {
     /// that assume continuity from one to the next.
     shell_escape_work: Option<FilesystemIo>,
 
+    /// If enabled, a persistent cache of the results of shell-escape
+    /// commands.
+    shell_escape_cache: Option<ShellEscapeCache>,
+
+    /// The in-memory files that have been written into the shell-escape work
+    /// directory, so that we only write the ones that have changed before the
+    /// next shell-escape command. See [`Self::sync_shell_escape_work`].
+    shell_escape_synced: HashMap<String, SyncedFile>,
+
     /// I/O for saving any generated format files.
     format_cache: FormatCache,
 
@@ -251,8 +264,71 @@ struct BridgeState {
     /// None.
     format_primary: Option<BufferedPrimaryIo>,
 
+    /// Whether filesystem I/O remains enabled in format-file generation mode.
+    /// This is only the case when building a document-specific preamble
+    /// format, since the preamble may load files from the project directory.
+    format_primary_uses_fs: bool,
+
     /// The I/O events that occurred while processing.
     events: HashMap<String, FileSummary>,
+
+    /// The number of bytes read from and written to each file, over all
+    /// passes. Unlike `events`, this is never reset.
+    file_io: BTreeMap<String, FileIoStats>,
+
+    /// Where each input file was found the last time that it was looked up,
+    /// or `None` if it wasn't found anywhere. See [`Self::resolve_input`].
+    resolutions: HashMap<String, Option<InputSource>>,
+
+    /// How well `resolutions` has been working.
+    lookup_stats: LookupCacheStats,
+
+    /// What the engines have worked out about input files, such as the sizes
+    /// of images, so that they don't have to work it out again.
+    metadata_cache: MetadataCache,
+}
+
+/// One of the I/O providers of a [`BridgeState`]. These are listed in the
+/// order that `bridgestate_ioprovider_cascade!` tries them.
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+enum InputSource {
+    GenuineStdout,
+    FormatPrimary,
+    PrimaryInput,
+    Mem,
+    Filesystem,
+    ShellEscapeWork,
+    ExtraSearchPath(usize),
+    Bundle,
+    FormatCache,
+}
+
+/// A version of an in-memory file that was written into the shell-escape work
+/// directory.
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+struct SyncedFile {
+    /// The [`crate::io::memory::MemoryFileInfo::generation`] of the in-memory
+    /// file that was written.
+    generation: u64,
+
+    /// The size of the file on disk after it was written.
+    len: u64,
+
+    /// The modification time of the file on disk after it was written.
+    mtime: SystemTime,
+}
+
+impl SyncedFile {
+    /// Examine a file that was just written into the work directory.
+    fn new(generation: u64, path: &Path) -> std::io::Result<SyncedFile> {
+        let meta = std::fs::metadata(path)?;
+
+        Ok(SyncedFile {
+            generation,
+            len: meta.len(),
+            mtime: meta.modified()?,
+        })
+    }
 }
 
 impl BridgeState {
@@ -263,11 +339,264 @@ impl BridgeState {
         self.format_primary = Some(BufferedPrimaryIo::from_text(format!(
             "\\input {format_file_name}"
         )));
+        self.format_primary_uses_fs = false;
+        self.invalidate_all_resolutions();
+    }
+
+    /// Enter a variant of "format mode" used to dump a document preamble. The
+    /// primary input is fixed to the given text, but unlike the standard
+    /// format mode, filesystem I/O remains available.
+    fn enter_preamble_format_mode(&mut self, text: Vec<u8>) {
+        self.format_primary = Some(BufferedPrimaryIo::from_buffer(text));
+        self.format_primary_uses_fs = true;
+        self.invalidate_all_resolutions();
     }
 
     /// Leave "format mode".
     fn leave_format_mode(&mut self) {
         self.format_primary = None;
+        self.format_primary_uses_fs = false;
+        self.invalidate_all_resolutions();
+    }
+
+    /// The I/O providers that are currently active, in the order in which
+    /// they should be searched for input files. This must agree with
+    /// `bridgestate_ioprovider_cascade!`.
+    fn input_sources(&self) -> Vec<InputSource> {
+        let mut sources = Vec::new();
+
+        if self.genuine_stdout.is_some() {
+            sources.push(InputSource::GenuineStdout);
+        }
+
+        let use_fs = if self.format_primary.is_some() {
+            sources.push(InputSource::FormatPrimary);
+            self.format_primary_uses_fs
+        } else {
+            sources.push(InputSource::PrimaryInput);
+            true
+        };
+
+        sources.push(InputSource::Mem);
+
+        if use_fs {
+            sources.push(InputSource::Filesystem);
+
+            if self.shell_escape_work.is_some() {
+                sources.push(InputSource::ShellEscapeWork);
+            }
+
+            sources.extend((0..self.extra_search_paths.len()).map(InputSource::ExtraSearchPath));
+        }
+
+        sources.push(InputSource::Bundle);
+        sources.push(InputSource::FormatCache);
+        sources
+    }
+
+    fn input_source_mut(&mut self, source: InputSource) -> Option<&mut dyn IoProvider> {
+        match source {
+            InputSource::GenuineStdout => self
+                .genuine_stdout
+                .as_mut()
+                .map(|p| p as &mut dyn IoProvider),
+            InputSource::FormatPrimary => self
+                .format_primary
+                .as_mut()
+                .map(|p| p as &mut dyn IoProvider),
+            InputSource::PrimaryInput => Some(&mut *self.primary_input),
+            InputSource::Mem => Some(&mut self.mem),
+            InputSource::Filesystem => Some(&mut self.filesystem),
+            InputSource::ShellEscapeWork => self
+                .shell_escape_work
+                .as_mut()
+                .map(|p| p as &mut dyn IoProvider),
+            InputSource::ExtraSearchPath(i) => self
+                .extra_search_paths
+                .get_mut(i)
+                .map(|p| p as &mut dyn IoProvider),
+            InputSource::Bundle => Some(self.bundle.as_ioprovider_mut()),
+            InputSource::FormatCache => Some(&mut self.format_cache),
+        }
+    }
+
+    /// Open an input file through the provider stack, using and updating the
+    /// cache of where files were found.
+    ///
+    /// The engines probe for lots of files that don't exist, under several
+    /// extensions each, and repeat the same probes on every pass. Without the
+    /// cache, each such probe costs a filesystem lookup in every search
+    /// directory plus a bundle lookup. The cache is keyed by the name being
+    /// probed, which includes any extension that the engine added.
+    fn resolve_input(
+        &mut self,
+        name: &str,
+        status: &mut dyn StatusBackend,
+    ) -> OpenResult<(InputHandle, Option<PathBuf>)> {
+        match self.resolutions.get(name).copied() {
+            Some(None) => {
+                self.lookup_stats.negative_hits += 1;
+                return OpenResult::NotAvailable;
+            }
+
+            Some(Some(source)) => {
+                if let Some(p) = self.input_source_mut(source) {
+                    match p.input_open_name_with_abspath(name, status) {
+                        OpenResult::NotAvailable => {}
+                        r => {
+                            self.lookup_stats.hits += 1;
+                            return r;
+                        }
+                    }
+                }
+
+                // The file went away, e.g. because it was removed from the
+                // memory layer. Do a full search.
+            }
+
+            None => {}
+        }
+
+        self.lookup_stats.misses += 1;
+
+        for source in self.input_sources() {
+            let r = match self.input_source_mut(source) {
+                Some(p) => p.input_open_name_with_abspath(name, status),
+                None => continue,
+            };
+
+            match r {
+                OpenResult::NotAvailable => {}
+                OpenResult::Ok(_) => {
+                    self.resolutions.insert(name.to_owned(), Some(source));
+                    return r;
+                }
+                OpenResult::Err(_) => return r,
+            }
+        }
+
+        self.resolutions.insert(name.to_owned(), None);
+        OpenResult::NotAvailable
+    }
+
+    /// Forget where the file `name` was found, because it might have changed.
+    fn invalidate_resolution(&mut self, name: &str) {
+        if self.resolutions.remove(name).is_some() {
+            self.lookup_stats.invalidations += 1;
+        }
+
+        self.metadata_cache.forget(name);
+    }
+
+    /// Forget where all files were found, because the set of providers or
+    /// their contents might have changed in ways that we can't track.
+    fn invalidate_all_resolutions(&mut self) {
+        self.lookup_stats.invalidations += self.resolutions.len() as u64;
+        self.resolutions.clear();
+        self.metadata_cache.forget_all();
+    }
+
+    /// Get the digest of the input file `name` for use with the metadata
+    /// cache. Files are only hashed the first time that they're needed, or
+    /// after they might have changed.
+    fn metadata_digest(
+        &mut self,
+        name: &str,
+        status: &mut dyn StatusBackend,
+    ) -> Option<DigestData> {
+        if let Some(d) = self.metadata_cache.digest(name) {
+            return Some(d);
+        }
+
+        let mut ih = match self.resolve_input(name, status) {
+            OpenResult::Ok((ih, _path)) => ih,
+            _ => return None,
+        };
+
+        let mut dc = digest::create();
+        let mut buf = vec![0u8; 65536];
+
+        loop {
+            match ih.read(&mut buf) {
+                Ok(0) => break,
+                Ok(n) => dc.update(&buf[..n]),
+                Err(_) => return None,
+            }
+        }
+
+        self.event_bytes_transferred(name, ih.bytes_read(), 0);
+
+        let d = DigestData::from(dc);
+        self.metadata_cache.set_digest(name, d);
+        Some(d)
+    }
+
+    /// Whether what is learned about the input file `name` should be saved to
+    /// the persistent metadata cache, and looked up there. Support files from
+    /// the bundle are used by lots of documents, so what is learned about them
+    /// is always worth keeping. Information about other files is only kept if
+    /// requested.
+    fn metadata_persists(&self, name: &str) -> bool {
+        self.unstables.image_metadata_cache
+            || self.resolutions.get(name) == Some(&Some(InputSource::Bundle))
+    }
+
+    /// Write any TeX-created files in the memory cache to the shell-escape
+    /// working directory, since the shell-escape program may need to use
+    /// them. (This is the case for `minted`.) We basically just hope that
+    /// nothing will want to access the actual TeX source, which will live in
+    /// a different directory.
+    ///
+    /// Packages like `minted` run many shell-escape commands, so we only write
+    /// files that have changed since the last time that we wrote them, as told
+    /// by their generation numbers. Since a command might have altered a file
+    /// that we wrote, we also check that the copy on disk still looks the way
+    /// that we left it.
+    fn sync_shell_escape_work(
+        &mut self,
+        status: &mut dyn StatusBackend,
+    ) -> StdResult<(), SystemRequestError> {
+        let work = match self.shell_escape_work.as_ref() {
+            Some(w) => w,
+            None => return Ok(()),
+        };
+
+        for (name, file) in &*self.mem.files.borrow() {
+            // If it's in the `mem` backend, it's of interest here ...
+            // unless it's stdout.
+            if name == self.mem.stdout_key() {
+                continue;
+            }
+
+            let real_path = work.root().join(name);
+
+            if let Some(synced) = self.shell_escape_synced.get(name) {
+                if synced.generation == file.generation
+                    && SyncedFile::new(file.generation, &real_path).ok() == Some(*synced)
+                {
+                    continue;
+                }
+            }
+
+            if let Some(prefix) = real_path.parent() {
+                std::fs::create_dir_all(prefix).map_err(|e| {
+                    tt_error!(status, "failed to create sub directory `{}`", prefix.display(); e.into());
+                    SystemRequestError::Failed
+                })?;
+            }
+
+            let synced = file
+                .export_to(&real_path)
+                .and_then(|_| SyncedFile::new(file.generation, &real_path))
+                .map_err(|e| {
+                    tt_error!(status, "failed to write file `{}`", real_path.display(); e.into());
+                    SystemRequestError::Failed
+                })?;
+
+            self.shell_escape_synced.insert(name.clone(), synced);
+        }
+
+        Ok(())
     }
 
     /// Invoke an external tool as a pass in the processing pipeline.
@@ -407,6 +736,9 @@ impl BridgeState {
             }
         }
 
+        // The tool may have created files that we had previously looked for.
+        self.invalidate_all_resolutions();
+
         // Mark the input files as having been read, and we're done.
 
         for name in &read_files {
@@ -426,6 +758,50 @@ impl BridgeState {
         // Currently, we only consider files in memory as intermediate files.
         return self.mem.files.borrow().keys().cloned().collect();
     }
+
+    /// Compute the digest of a file as it is currently visible through the I/O
+    /// stack, without recording the access as an I/O event. Files that don't
+    /// exist get the digest of an empty file, as in the rerun detection logic.
+    fn current_digest(
+        &mut self,
+        name: &str,
+        status: &mut dyn StatusBackend,
+    ) -> tectonic_errors::Result<DigestData> {
+        let prev_summary = self.events.get(name).cloned();
+
+        let result = match self.input_open_name(name, status) {
+            OpenResult::Ok(mut ih) => {
+                let mut dc = digest::create();
+                let mut buf = vec![0u8; 65536];
+
+                loop {
+                    let n = ih.read(&mut buf[..])?;
+
+                    if n == 0 {
+                        break;
+                    }
+
+                    dc.update(&buf[..n]);
+                }
+
+                Ok(DigestData::from(dc))
+            }
+
+            OpenResult::NotAvailable => Ok(DigestData::of_nothing()),
+            OpenResult::Err(e) => Err(e),
+        };
+
+        match prev_summary {
+            Some(summ) => {
+                self.events.insert(name.to_owned(), summ);
+            }
+            None => {
+                self.events.remove(name);
+            }
+        }
+
+        result
+    }
 }
 
 macro_rules! bridgestate_ioprovider_try {
@@ -445,10 +821,10 @@ macro_rules! bridgestate_ioprovider_cascade {
         }
 
         // See enter_format_mode above. If creating a format file, disable local
-        // filesystem I/O.
+        // filesystem I/O, unless we're dumping a document preamble.
         let use_fs = if let Some(ref mut p) = $self.format_primary {
             bridgestate_ioprovider_try!(p, $($inner)+);
-            false
+            $self.format_primary_uses_fs
         } else {
             bridgestate_ioprovider_try!($self.primary_input, $($inner)+);
             true
@@ -488,6 +864,8 @@ impl IoProvider for BridgeState {
         })();
 
         if let OpenResult::Ok(_) = r {
+            self.invalidate_resolution(name);
+
             if let Some(summ) = self.events.get_mut(name) {
                 summ.access_pattern = match summ.access_pattern {
                     AccessPattern::Read => AccessPattern::ReadThenWritten,
@@ -546,9 +924,7 @@ impl IoProvider for BridgeState {
         name: &str,
         status: &mut dyn StatusBackend,
     ) -> OpenResult<(InputHandle, Option<PathBuf>)> {
-        let r = (|| {
-            bridgestate_ioprovider_cascade!(self, input_open_name_with_abspath(name, status));
-        })();
+        let r = self.resolve_input(name, status);
 
         match r {
             OpenResult::Ok((ref ih, ref _path)) => {
@@ -582,7 +958,7 @@ impl IoProvider for BridgeState {
                     // read again later, the `None` will be overwritten; but what matters
                     // is the contents of the file the very first time it was read.
                     let mut fs = FileSummary::new(AccessPattern::Read, InputOrigin::NotInput);
-                    fs.read_digest = Some(DigestData::of_nothing());
+                    fs.read_digest = Some(StreamDigest::of_nothing());
                     self.events.insert(name.to_owned(), fs);
                 }
             }
@@ -640,7 +1016,7 @@ impl DriverHooks for BridgeState {
         self
     }
 
-    fn event_output_closed(&mut self, name: String, digest: DigestData) {
+    fn event_output_closed(&mut self, name: String, digest: StreamDigest) {
         let summ = self
             .events
             .get_mut(&name)
@@ -648,10 +1024,16 @@ impl DriverHooks for BridgeState {
         summ.write_digest = Some(digest);
     }
 
+    fn event_bytes_transferred(&mut self, name: &str, read: u64, written: u64) {
+        let io = self.file_io.entry(name.to_owned()).or_default();
+        io.bytes_read += read;
+        io.bytes_written += written;
+    }
+
     fn event_input_closed(
         &mut self,
         name: String,
-        digest: Option<DigestData>,
+        digest: Option<StreamDigest>,
         _status: &mut dyn StatusBackend,
     ) {
         let summ = self
@@ -667,6 +1049,37 @@ impl DriverHooks for BridgeState {
         }
     }
 
+    fn metadata_cache_get(
+        &mut self,
+        name: &str,
+        key: &str,
+        status: &mut dyn StatusBackend,
+    ) -> Option<Vec<u8>> {
+        let digest = self.metadata_digest(name, status)?;
+        let persist = self.metadata_persists(name);
+        self.metadata_cache
+            .get(&digest, key, persist)
+            .map(<[u8]>::to_vec)
+    }
+
+    fn metadata_cache_put(
+        &mut self,
+        name: &str,
+        key: &str,
+        value: &[u8],
+        status: &mut dyn StatusBackend,
+    ) {
+        let Some(digest) = self.metadata_digest(name, status) else {
+            return;
+        };
+
+        let persist = self.metadata_persists(name);
+
+        if let Err(e) = self.metadata_cache.put(&digest, key, value, persist) {
+            tt_warning!(status, "couldn't save information about \"{}\" to the metadata cache", name; e);
+        }
+    }
+
     fn sysrq_shell_escape(
         &mut self,
         command: &str,
@@ -678,40 +1091,42 @@ impl DriverHooks for BridgeState {
         #[cfg(windows)]
         const SHELL: &[&str] = &["cmd.exe", "/c"];
 
-        // Write any TeX-created files in the memory cache to the shell-escape
-        // working directory, since the shell-escape program may need to use
-        // them. (This is the case for `minted`.) We basically just hope that
-        // nothing will want to access the actual TeX source, which will live in
-        // a different directory.
-        //
-        // This is suboptimally slow since we'll be rewriting the same files
-        // repeatedly for repeated shell-escape invocations, but I don't feel
-        // like optimizing that I/O right now. Shell-escape is a gnarly hack
-        // anyway!
-
-        if let Some(work) = self.shell_escape_work.as_ref() {
-            for (name, file) in &*self.mem.files.borrow() {
-                // If it's in the `mem` backend, it's of interest here ...
-                // unless it's stdout.
-                if name == self.mem.stdout_key() {
-                    continue;
-                }
+        // The command may create or modify any file in the working directory,
+        // so we can't trust any of our earlier lookups after running it.
+
+        self.invalidate_all_resolutions();
+
+        if self.shell_escape_work.is_some() {
+            self.sync_shell_escape_work(status)?;
+            let work = self.shell_escape_work.as_ref().unwrap();
+
+            // If we've run this command on these files before, we can just
+            // reproduce its results. Problems with the cache aren't fatal:
+            // we'll just run the command.
 
-                let real_path = work.root().join(name);
-                if let Some(prefix) = real_path.parent() {
-                    std::fs::create_dir_all(prefix).map_err(|e| {
-                        tt_error!(status, "failed to create sub directory `{}`", prefix.display(); e.into());
-                        SystemRequestError::Failed
-                    })?;
+            let mut cache_key = None;
+
+            if let Some(cache) = self.shell_escape_cache.as_mut() {
+                let lookup = cache.scan(work.root()).and_then(|state| {
+                    let key = ShellEscapeCache::key(command, &state);
+                    let hit = cache.replay(&key, work.root())?;
+                    Ok((key, state, hit))
+                });
+
+                match lookup {
+                    Ok((_, _, true)) => {
+                        tt_note!(
+                            status,
+                            "reusing cached results of shell command: `{}`",
+                            command
+                        );
+                        return Ok(());
+                    }
+                    Ok((key, state, false)) => cache_key = Some((key, state)),
+                    Err(e) => {
+                        tt_warning!(status, "failed to consult the shell-escape cache"; e);
+                    }
                 }
-                let mut f = File::create(&real_path).map_err(|e| {
-                    tt_error!(status, "failed to create file `{}`", real_path.display(); e.into());
-                    SystemRequestError::Failed
-                })?;
-                f.write_all(&file.data).map_err(|e| {
-                    tt_error!(status, "failed to write file `{}`", real_path.display(); e.into());
-                    SystemRequestError::Failed
-                })?;
             }
 
             // Now we can actually run the command.
@@ -725,7 +1140,17 @@ impl DriverHooks for BridgeState {
                 .status()
             {
                 Ok(s) => match s.code() {
-                    Some(0) => Ok(()),
+                    Some(0) => {
+                        if let (Some(cache), Some((key, state))) =
+                            (self.shell_escape_cache.as_mut(), cache_key)
+                        {
+                            if let Err(e) = cache.record(&key, work.root(), &state) {
+                                tt_warning!(status, "failed to save the results of the shell command in the cache"; e);
+                            }
+                        }
+
+                        Ok(())
+                    }
                     Some(n) => {
                         tt_warning!(status, "command exited with error code {}", n);
                         Err(SystemRequestError::Failed)
@@ -1186,19 +1611,57 @@ impl ProcessingSessionBuilder {
 
         let filesystem = FilesystemIo::new(&filesystem_root, false, true, hidden_input_paths);
 
-        let mem = MemoryIo::new(true);
+        // Since it only ever replays the results of commands that we'd be
+        // running anyway, the shell-escape cache doesn't need its own
+        // security check, but there's no point in having it if shell-escape
+        // is disabled.
+        let shell_escape_cache =
+            if self.unstables.shell_escape_cache && self.security.allow_shell_escape() {
+                match app_dirs::get_user_cache_dir("shell-escape") {
+                    Ok(p) => Some(ShellEscapeCache::new(p)),
+                    Err(e) => {
+                        tt_warning!(status, "couldn't set up the shell-escape cache"; e);
+                        None
+                    }
+                }
+            } else {
+                None
+            };
+
+        let metadata_cache = MetadataCache::new(match app_dirs::get_user_cache_dir("metadata") {
+            Ok(p) => Some(p),
+            Err(e) => {
+                if self.unstables.image_metadata_cache {
+                    tt_warning!(status, "couldn't set up the persistent metadata cache"; e);
+                }
+                None
+            }
+        });
+
+        let mut mem = MemoryIo::new(true);
+
+        if let Some(threshold) = self.unstables.spill_threshold {
+            mem.set_spill_threshold(Some(threshold), None);
+        }
 
-        let bs = BridgeState {
+        let mut bs = BridgeState {
             primary_input: pio,
             mem,
             filesystem,
             extra_search_paths,
             shell_escape_work: None,
+            shell_escape_cache,
+            shell_escape_synced: HashMap::new(),
             format_cache,
             bundle,
             genuine_stdout,
             format_primary: None,
+            format_primary_uses_fs: false,
             events: HashMap::new(),
+            file_io: BTreeMap::new(),
+            resolutions: HashMap::new(),
+            lookup_stats: LookupCacheStats::default(),
+            metadata_cache,
         };
 
         // Now we can do the rest.
@@ -1223,6 +1686,18 @@ impl ProcessingSessionBuilder {
         let mut pdf_path = aux_path.clone();
         pdf_path.set_extension("pdf");
 
+        // The PDF is a final output that's never read back, so if it's going to
+        // land on disk, stream it straight into the destination directory
+        // rather than buffering it in memory.
+        if let (OutputFormat::Pdf, Some(ref out_dir)) = (self.output_format, &output_path) {
+            let pdf_dir = match pdf_path.parent() {
+                Some(p) => out_dir.join(p),
+                None => out_dir.clone(),
+            };
+            bs.mem
+                .stream_output_to_dir(&pdf_path.display().to_string(), &pdf_dir);
+        }
+
         let shell_escape_mode = if !self.security.allow_shell_escape() {
             ShellEscapeMode::Disabled
         } else {
@@ -1265,6 +1740,8 @@ impl ProcessingSessionBuilder {
             html_precomputed_assets: self.html_precomputed_assets,
             html_emit_files: !self.html_do_not_emit_files,
             html_emit_assets: !self.html_do_not_emit_assets,
+            html_changed_files: Vec::new(),
+            phases: Vec::new(),
         })
     }
 }
@@ -1336,6 +1813,12 @@ pub struct ProcessingSession {
     html_precomputed_assets: Option<AssetSpecification>,
     html_emit_files: bool,
     html_emit_assets: bool,
+
+    /// The HTML output files written by the last spx2html pass.
+    html_changed_files: Vec<PathBuf>,
+
+    /// Timings and engine statistics for each pass that has been run.
+    phases: Vec<PhaseStats>,
 }
 
 const DEFAULT_MAX_TEX_PASSES: usize = 6;
@@ -1343,6 +1826,82 @@ const ALWAYS_INTERMEDIATE_EXTENSIONS: &[&str] = &[
     ".snm", ".toc", // generated by Beamer
 ];
 
+/// TeX code appended to a document preamble in order to dump it as a format.
+/// Some formats only provide the `\dump` primitive as `\@@dump`, so we use
+/// whichever is available, taking care to finish the conditional first.
+const PREAMBLE_DUMP_TRAILER: &[u8] = b"\n\\expandafter\\ifx\\csname @@dump\\endcsname\\relax\
+    \\expandafter\\dump\\else\\csname @@dump\\expandafter\\endcsname\\fi\n";
+
+/// Find the byte offset of the `\begin{document}` that ends a LaTeX preamble,
+/// ignoring any occurrences inside of comments.
+fn find_preamble_end(data: &[u8]) -> Option<usize> {
+    const BEGIN_DOCUMENT: &[u8] = b"\\begin{document}";
+
+    let mut line_start = 0;
+
+    for line in data.split(|c| *c == b'\n') {
+        // Trim off any comment. This doesn't handle `\\%` correctly, but
+        // that's quite rare in preambles.
+        let code_len = line
+            .iter()
+            .enumerate()
+            .position(|(i, c)| *c == b'%' && (i == 0 || line[i - 1] != b'\\'))
+            .unwrap_or(line.len());
+
+        if let Some(pos) = line[..code_len]
+            .windows(BEGIN_DOCUMENT.len())
+            .position(|w| w == BEGIN_DOCUMENT)
+        {
+            return Some(line_start + pos);
+        }
+
+        line_start += line.len() + 1;
+    }
+
+    None
+}
+
+/// The files that the shell-escape cache should leave out of its keys, as
+/// `/`-separated paths relative to the shell-escape work directory `root`.
+/// The engines rewrite their main outputs, and the `.aux` and `.log` files, on
+/// every pass, and they are copied into the work directory under their own
+/// names. If the work directory is the project directory, it probably also
+/// contains the outputs of earlier builds, in the output directory
+/// `output_dir`. Commands have no business reading any of these.
+fn shell_escape_ignored_names(
+    root: &Path,
+    aux_path: &str,
+    output_dir: Option<&Path>,
+) -> Vec<String> {
+    let slash_path = |p: &Path| {
+        p.components()
+            .map(|c| c.as_os_str().to_string_lossy())
+            .collect::<Vec<_>>()
+            .join("/")
+    };
+
+    let output_dir = output_dir.and_then(|d| {
+        let d = d.canonicalize().ok()?;
+        let root = root.canonicalize().ok()?;
+        d.strip_prefix(root).ok().map(Path::to_owned)
+    });
+
+    let aux_path = Path::new(aux_path);
+    let mut names = Vec::new();
+
+    for ext in ["aux", "log", "pdf", "xdv", "spx", "synctex.gz"] {
+        let name = aux_path.with_extension(ext);
+
+        if let Some(ref dir) = output_dir {
+            names.push(slash_path(&dir.join(&name)));
+        }
+
+        names.push(slash_path(&name));
+    }
+
+    names
+}
+
 impl ProcessingSession {
     /// Assess whether we need to rerun an engine. This is the case if there
     /// was a file that the engine read and then rewrote, and the rewritten
@@ -1439,6 +1998,20 @@ impl ProcessingSession {
         };
 
         self.bs.shell_escape_work = shell_escape_work;
+        self.bs.shell_escape_synced.clear();
+
+        if let (Some(cache), Some(work)) = (
+            self.bs.shell_escape_cache.as_mut(),
+            self.bs.shell_escape_work.as_ref(),
+        ) {
+            for name in shell_escape_ignored_names(
+                work.root(),
+                &self.tex_aux_path,
+                self.output_path.as_deref(),
+            ) {
+                cache.ignore(&name);
+            }
+        }
 
         // Go-time!
         let result = self.run_inner(status);
@@ -1455,10 +2028,49 @@ impl ProcessingSession {
             }
         }
 
+        if let Some(ref path) = self.unstables.stats_json {
+            if let Err(e) = std::fs::write(path, self.statistics().to_json()) {
+                tt_warning!(status, "couldn't write session statistics to `{}`", path.display(); e.into());
+            }
+        }
+
         // Propagate the actual result.
         result
     }
 
+    /// Generate the format file for this session and save it in the format
+    /// cache, without processing any document.
+    ///
+    /// This is used to make the prebuilt formats that bundles can ship; see
+    /// [`crate::io::format_cache::prebuilt_format_path`]. Unlike [`Self::run`],
+    /// this always runs the engine, even if a format is already available.
+    pub fn generate_format(&mut self, status: &mut dyn StatusBackend) -> Result<()> {
+        self.make_format_pass(status)?;
+        Ok(())
+    }
+
+    /// Gather statistics about the passes that have been run so far: how long
+    /// each took and what the engines reported about themselves, how much data
+    /// was read from and written to each file, and how well the bundle cache
+    /// has been doing.
+    pub fn statistics(&self) -> SessionStats {
+        SessionStats {
+            phases: self.phases.clone(),
+            files: self.bs.file_io.clone(),
+            lookup_cache: self.bs.lookup_stats,
+            bundle_cache: self.bs.bundle.cache_stats(),
+        }
+    }
+
+    /// Note that a pass of the pipeline has finished.
+    fn record_phase(&mut self, name: &str, started: Instant, counters: &[(&'static str, u64)]) {
+        self.phases.push(PhaseStats {
+            name: name.to_owned(),
+            wall_time: started.elapsed(),
+            counters: counters.to_vec(),
+        });
+    }
+
     /// The bulk of the `run` implementation. We need to wrap it to manage the
     /// lifecycle of resources like the shell-escape temporary directory, if
     /// needed.
@@ -1479,8 +2091,30 @@ impl ProcessingSession {
         };
 
         if generate_format {
-            tt_note!(status, "generating format \"{}\"", self.format_name);
-            self.make_format_pass(status)?;
+            // The bundle may ship a prebuilt format for this engine version;
+            // if not, we have to make one ourselves.
+            let installed = match self.bs.format_cache.install_prebuilt(
+                &self.format_name,
+                self.bs.bundle.as_ioprovider_mut(),
+                status,
+            ) {
+                Ok(b) => b,
+                Err(e) => {
+                    tt_warning!(status, "could not install the bundle's prebuilt format \"{}\"", self.format_name; e);
+                    false
+                }
+            };
+
+            if installed {
+                tt_note!(status, "installed prebuilt format \"{}\"", self.format_name);
+            } else {
+                tt_note!(status, "generating format \"{}\"", self.format_name);
+                self.make_format_pass(status)?;
+            }
+        }
+
+        if self.unstables.preamble_format && self.output_format != OutputFormat::Format {
+            self.setup_preamble_format(status);
         }
 
         // Do the meat of the work.
@@ -1628,7 +2262,7 @@ impl ProcessingSession {
                 continue;
             }
 
-            if file.data.is_empty() {
+            if file.is_empty() {
                 status.note_highlighted(
                     "Not writing ",
                     &format!("`{sname}`"),
@@ -1638,7 +2272,7 @@ impl ProcessingSession {
             }
 
             let real_path = root.join(name);
-            let byte_len = Byte::from_u128(file.data.len() as u128).unwrap();
+            let byte_len = Byte::from_u128(file.len() as u128).unwrap();
             status.note_highlighted(
                 "Writing ",
                 &format!("`{}`", real_path.display()),
@@ -1649,8 +2283,9 @@ impl ProcessingSession {
                 std::fs::create_dir_all(parent)?;
             }
 
-            let mut f = File::create(&real_path)?;
-            f.write_all(&file.data)?;
+            // For outputs that were streamed to disk, this just moves the
+            // already-written temporary file into place.
+            file.persist_to(&real_path)?;
             summ.got_written_to_disk = true;
 
             if let Some(ref mut mf_dest) = mf_dest_maybe {
@@ -1685,7 +2320,9 @@ impl ProcessingSession {
             let maybe_biber = self.check_biber_requirement(status)?;
 
             if let Some(biber) = maybe_biber {
+                let started = Instant::now();
                 self.bs.external_tool_pass(&biber, status)?;
+                self.record_phase(&biber.argv[0], started, &[]);
                 Some(RerunReason::Biber)
             } else if self.is_bibtex_needed() {
                 self.bibtex_pass(status)?;
@@ -1767,7 +2404,9 @@ impl ProcessingSession {
             .map(|file| {
                 // We used to use aho-corasick crate here, but it was removed to reduce the code
                 // size.
-                file.data.windows(BIBDATA.len()).any(|s| s == BIBDATA)
+                file.contents()
+                    .map(|data| data.windows(BIBDATA.len()).any(|s| s == BIBDATA))
+                    .unwrap_or(false)
             })
             .unwrap_or(false)
     }
@@ -1787,12 +2426,15 @@ impl ProcessingSession {
         });
         let stem = r?;
 
+        let started = Instant::now();
+        let mut engine = TexEngine::default();
+
         let result = {
             self.bs
                 .enter_format_mode(&format!("tectonic-format-{stem}.tex"));
             let mut launcher =
                 CoreBridgeLauncher::new_with_security(&mut self.bs, status, self.security.clone());
-            let r = TexEngine::default()
+            let r = engine
                 .halt_on_error_mode(true)
                 .initex_mode(true)
                 .shell_escape(self.shell_escape_mode != ShellEscapeMode::Disabled)
@@ -1801,6 +2443,8 @@ impl ProcessingSession {
             r
         };
 
+        self.record_phase("format", started, engine.statistics());
+
         match result {
             Ok(TexOutcome::Spotless) => {}
             Ok(TexOutcome::Warnings) => {
@@ -1831,7 +2475,8 @@ impl ProcessingSession {
             }
 
             // Note that we intentionally pass 'stem', not 'name'.
-            ctry!(self.bs.format_cache.write_format(stem, &file.data, status); "cannot write format file {}", sname);
+            let data = ctry!(file.contents(); "cannot read format file {}", sname);
+            ctry!(self.bs.format_cache.write_format(stem, &data, status); "cannot write format file {}", sname);
         }
 
         // All done. Clear the memory layer since this was a special preparatory step.
@@ -1840,12 +2485,296 @@ impl ProcessingSession {
         Ok(0)
     }
 
+    /// Set up the document-specific "preamble format", if possible.
+    ///
+    /// We split the primary input at its `\begin{document}` and dump the
+    /// engine state after processing everything before that point into a
+    /// format file. The TeX passes then load that format and only process the
+    /// document body. Problems here aren't fatal: we just fall back to
+    /// processing the whole document with the standard format.
+    fn setup_preamble_format(&mut self, status: &mut dyn StatusBackend) {
+        if self.synctex_enabled {
+            // SyncTeX needs to know the true path of the primary input.
+            tt_note!(
+                status,
+                "not using a preamble format since SyncTeX is enabled"
+            );
+            return;
+        }
+
+        if let Err(e) = self.try_setup_preamble_format(status) {
+            tt_warning!(status, "could not set up a preamble format; processing the full document"; e);
+        }
+    }
+
+    fn try_setup_preamble_format(
+        &mut self,
+        status: &mut dyn StatusBackend,
+    ) -> tectonic_errors::Result<()> {
+        let mut data = Vec::new();
+
+        match self.bs.primary_input.input_open_primary(status) {
+            OpenResult::Ok(mut ih) => {
+                ih.read_to_end(&mut data)?;
+            }
+            OpenResult::NotAvailable => {
+                tectonic_errors::anyhow::bail!("the primary input is not available");
+            }
+            OpenResult::Err(e) => return Err(e),
+        }
+
+        let split = match find_preamble_end(&data) {
+            Some(n) => n,
+            None => {
+                tt_note!(
+                    status,
+                    "not using a preamble format since no `\\begin{{document}}` was found"
+                );
+                return Ok(());
+            }
+        };
+
+        let (preamble, body) = data.split_at(split);
+
+        // The format is keyed by the base format and the preamble text. The
+        // files that the preamble reads are tracked in a dependency manifest.
+
+        let base_stem = self.format_name.split('.').next().unwrap_or_default();
+        let mut dc = digest::create();
+        dc.update(self.format_name.as_bytes());
+        dc.update([0u8]);
+        dc.update(preamble);
+        let key = DigestData::from(dc).to_string();
+        let stem = format!("{}-preamble-{}", base_stem, &key[..16]);
+        let fmt_name = format!("{stem}.fmt");
+
+        // If the preamble couldn't be dumped last time, don't keep trying
+        // until one of the files that it read changes.
+        let failed_stem = format!("{stem}-failed");
+
+        if let Some(deps) = self
+            .bs
+            .format_cache
+            .read_dependency_manifest(&failed_stem)?
+        {
+            if self.first_changed_dependency(&deps, status)?.is_none() {
+                tt_note!(
+                    status,
+                    "not using a preamble format since the preamble could not be dumped last time"
+                );
+                return Ok(());
+            }
+        }
+
+        if !self.is_preamble_format_current(&stem, &fmt_name, status)? {
+            tt_note!(status, "generating preamble format \"{}\"", fmt_name);
+            self.make_preamble_format_pass(&stem, &failed_stem, preamble, status)?;
+        }
+
+        // Now swap in the body. We replace the preamble with the same number
+        // of blank lines so that line numbers in diagnostics stay correct.
+
+        let n_lines = preamble.iter().filter(|c| **c == b'\n').count();
+        let mut new_primary = vec![b'\n'; n_lines];
+        new_primary.extend_from_slice(body);
+        self.bs.primary_input = Box::new(BufferedPrimaryIo::from_buffer(new_primary));
+        self.format_name = fmt_name;
+        Ok(())
+    }
+
+    /// Check whether a cached preamble format exists and all of the files
+    /// that went into it are unchanged.
+    fn is_preamble_format_current(
+        &mut self,
+        stem: &str,
+        fmt_name: &str,
+        status: &mut dyn StatusBackend,
+    ) -> tectonic_errors::Result<bool> {
+        let deps = match self.bs.format_cache.read_dependency_manifest(stem)? {
+            Some(d) => d,
+            None => return Ok(false),
+        };
+
+        match self.bs.format_cache.input_open_format(fmt_name, status) {
+            OpenResult::Ok(_) => {}
+            OpenResult::NotAvailable => return Ok(false),
+            OpenResult::Err(e) => return Err(e),
+        }
+
+        if let Some(name) = self.first_changed_dependency(&deps, status)? {
+            tt_note!(
+                status,
+                "preamble format is stale because \"{}\" changed",
+                name
+            );
+            return Ok(false);
+        }
+
+        Ok(true)
+    }
+
+    /// Find the first file in a preamble format dependency manifest whose
+    /// contents are no longer the same, if any.
+    fn first_changed_dependency(
+        &mut self,
+        deps: &[(String, DigestData)],
+        status: &mut dyn StatusBackend,
+    ) -> tectonic_errors::Result<Option<String>> {
+        for (name, digest) in deps {
+            if self.bs.current_digest(name, status)? != *digest {
+                return Ok(Some(name.clone()));
+            }
+        }
+
+        Ok(None)
+    }
+
+    /// Use the TeX engine to dump a document preamble into a format file,
+    /// starting from the session's base format. If that fails, a dependency
+    /// manifest is saved under `failed_stem` so that later sessions know not
+    /// to try again until one of the preamble's inputs changes.
+    fn make_preamble_format_pass(
+        &mut self,
+        stem: &str,
+        failed_stem: &str,
+        preamble: &[u8],
+        status: &mut dyn StatusBackend,
+    ) -> tectonic_errors::Result<()> {
+        let mut text = preamble.to_owned();
+        text.extend_from_slice(PREAMBLE_DUMP_TRAILER);
+
+        // This pass shouldn't affect the rerun logic of the main passes, so
+        // its I/O events are kept separate.
+        let saved_events = std::mem::take(&mut self.bs.events);
+        let prior_files: HashSet<String> = self.bs.mem.files.borrow().keys().cloned().collect();
+
+        let started = Instant::now();
+        let mut engine = TexEngine::default();
+
+        let result = {
+            self.bs.enter_preamble_format_mode(text);
+            let mut launcher =
+                CoreBridgeLauncher::new_with_security(&mut self.bs, status, self.security.clone());
+            let r = engine
+                .halt_on_error_mode(true)
+                .initex_mode(true)
+                .preload_format(true)
+                .shell_escape(self.shell_escape_mode != ShellEscapeMode::Disabled)
+                .process(
+                    &mut launcher,
+                    &self.format_name,
+                    &self.primary_input_tex_path,
+                );
+            self.bs.leave_format_mode();
+            r
+        };
+
+        self.record_phase("preamble-format", started, engine.statistics());
+        let pass_events = std::mem::replace(&mut self.bs.events, saved_events);
+
+        // Pull out the format file and discard everything else that the pass
+        // wrote, such as its log.
+
+        let mut fmt_data = None;
+
+        {
+            let mut mem_files = self.bs.mem.files.borrow_mut();
+            let new_names: Vec<String> = mem_files
+                .keys()
+                .filter(|n| !prior_files.contains(*n))
+                .cloned()
+                .collect();
+
+            for name in new_names {
+                let file = mem_files.remove(&name).unwrap();
+
+                if name.ends_with(".fmt") {
+                    fmt_data = Some(file.into_data()?);
+                }
+            }
+        }
+
+        // Bundle files are covered by the bundle digest that's part of the
+        // format cache key, so we only need to track other inputs. Files that
+        // were probed but didn't exist count too, since their later appearance
+        // could change how the preamble behaves.
+
+        let mut dep_names: Vec<String> = pass_events
+            .iter()
+            .filter(|(name, summ)| {
+                !name.is_empty()
+                    && summ.access_pattern == AccessPattern::Read
+                    && summ.input_origin != InputOrigin::Other
+            })
+            .map(|(name, _)| name.clone())
+            .collect();
+        dep_names.sort();
+
+        let mut deps = Vec::with_capacity(dep_names.len());
+
+        for name in dep_names {
+            let digest = self.bs.current_digest(&name, status)?;
+            deps.push((name, digest));
+        }
+
+        // Files that the preamble writes, such as the streams opened by
+        // `\makeindex` or the output of `filecontents`, wouldn't be written by
+        // passes that load the format, so such a preamble can't be cached.
+
+        let mut written: Vec<&str> = pass_events
+            .iter()
+            .filter(|(name, summ)| {
+                !name.is_empty()
+                    && summ.access_pattern != AccessPattern::Read
+                    && !name.ends_with(".log")
+                    && !name.ends_with(".fmt")
+            })
+            .map(|(name, _)| name.as_str())
+            .collect();
+        written.sort_unstable();
+
+        let problem = match (&result, &fmt_data) {
+            (Err(_), _) | (Ok(TexOutcome::Errors), _) => {
+                Some("the TeX engine issued errors while dumping the preamble".to_owned())
+            }
+            _ if !written.is_empty() => Some(format!(
+                "the preamble writes files ({})",
+                written.join(", ")
+            )),
+            (_, None) => Some("dumping the preamble did not produce a format file".to_owned()),
+            _ => None,
+        };
+
+        if let Some(problem) = problem {
+            self.bs
+                .format_cache
+                .write_dependency_manifest(failed_stem, &deps)?;
+
+            if let Err(e) = result {
+                return Err(e);
+            }
+
+            tectonic_errors::anyhow::bail!("{}", problem);
+        }
+
+        let fmt_data = fmt_data.unwrap();
+
+        self.bs.format_cache.write_format(stem, &fmt_data, status)?;
+        self.bs
+            .format_cache
+            .write_dependency_manifest(stem, &deps)?;
+        Ok(())
+    }
+
     /// Run one pass of the TeX engine.
     fn tex_pass(
         &mut self,
         rerun_explanation: Option<&str>,
         status: &mut dyn StatusBackend,
     ) -> Result<Option<&'static str>> {
+        let started = Instant::now();
+        let mut engine = TexEngine::default();
+
         let result = {
             if let Some(s) = rerun_explanation {
                 status.note_highlighted("Rerunning ", "TeX", &format!(" because {s} ..."));
@@ -1868,12 +2797,13 @@ impl ProcessingSession {
                 ));
             }
 
-            TexEngine::default()
+            engine
                 .halt_on_error_mode(!self.unstables.continue_on_errors)
                 .initex_mode(self.output_format == OutputFormat::Format)
                 .synctex(self.synctex_enabled)
                 .semantic_pagination(self.output_format == OutputFormat::Html)
                 .shell_escape(self.shell_escape_mode != ShellEscapeMode::Disabled)
+                .macro_profile(self.unstables.profile_macros)
                 .build_date(self.build_date)
                 .process(
                     &mut launcher,
@@ -1882,6 +2812,8 @@ impl ProcessingSession {
                 )
         };
 
+        self.record_phase("tex", started, engine.statistics());
+
         let warnings = match result {
             Ok(TexOutcome::Spotless) => None,
             Ok(TexOutcome::Warnings) =>
@@ -1911,14 +2843,18 @@ impl ProcessingSession {
         status: &mut dyn StatusBackend,
         aux_file: &String,
     ) -> Result<i32> {
+        let started = Instant::now();
+        let mut engine = BibtexEngine::new();
+
         let result = {
             status.note_highlighted("Running ", "BibTeX", &format!(" on {aux_file} ..."));
             let mut launcher =
                 CoreBridgeLauncher::new_with_security(&mut self.bs, status, self.security.clone());
-            let mut engine = BibtexEngine::new();
             engine.process(&mut launcher, aux_file, &self.unstables)
         };
 
+        self.record_phase("bibtex", started, engine.statistics());
+
         match result {
             Ok(TexOutcome::Spotless) => {}
             Ok(TexOutcome::Warnings) => {
@@ -1960,27 +2896,36 @@ impl ProcessingSession {
     }
 
     fn xdvipdfmx_pass(&mut self, status: &mut dyn StatusBackend) -> Result<i32> {
-        {
+        let started = Instant::now();
+        let mut engine = XdvipdfmxEngine::default();
+
+        let result = {
             status.note_highlighted("Running ", "xdvipdfmx", " ...");
 
             let mut launcher =
                 CoreBridgeLauncher::new_with_security(&mut self.bs, status, self.security.clone());
-            let mut engine = XdvipdfmxEngine::default();
 
-            engine.build_date(self.build_date);
+            engine
+                .build_date(self.build_date)
+                .enable_page_flushing(self.unstables.flush_pages);
 
             if let Some(ref ps) = self.unstables.paper_size {
                 engine.paper_spec(ps.clone());
             }
 
-            engine.process(&mut launcher, &self.tex_xdv_path, &self.tex_pdf_path)?;
-        }
+            engine.process(&mut launcher, &self.tex_xdv_path, &self.tex_pdf_path)
+        };
+
+        self.record_phase("xdvipdfmx", started, engine.statistics());
+        result?;
 
         self.bs.mem.files.borrow_mut().remove(&self.tex_xdv_path);
         Ok(0)
     }
 
     fn spx2html_pass(&mut self, status: &mut dyn StatusBackend) -> Result<i32> {
+        let started = Instant::now();
+
         {
             let mut engine = Spx2HtmlEngine::default();
 
@@ -2000,14 +2945,52 @@ impl ProcessingSession {
                 engine.precomputed_assets(a.clone());
             }
 
+            if self.unstables.html_incremental {
+                engine.skip_unchanged_files();
+            }
+
             status.note_highlighted("Running ", "spx2html", " ...");
             engine.process_to_filesystem(&mut self.bs, status, &self.tex_xdv_path)?;
+            self.html_changed_files = engine.changed_files().to_vec();
+        }
+
+        if self.unstables.html_incremental {
+            tt_note!(
+                status,
+                "{} HTML output file(s) changed",
+                self.html_changed_files.len()
+            );
         }
 
+        if let Some(ref path) = self.unstables.html_changed_list {
+            let mut list = String::new();
+
+            for p in &self.html_changed_files {
+                list.push_str(&p.to_string_lossy());
+                list.push('\n');
+            }
+
+            if let Err(e) = std::fs::write(path, list) {
+                tt_warning!(status, "couldn't write the list of changed HTML outputs to `{}`", path.display(); e.into());
+            }
+        }
+
+        self.record_phase("spx2html", started, &[]);
+
         self.bs.mem.files.borrow_mut().remove(&self.tex_xdv_path);
         Ok(0)
     }
 
+    /// Get the HTML output files that were written by the last spx2html pass,
+    /// relative to the output directory.
+    ///
+    /// If the [`crate::unstable_opts::UnstableOptions::html_incremental`]
+    /// option is set, files whose contents were already up-to-date are not
+    /// written, and so are not included here.
+    pub fn html_changed_files(&self) -> &[PathBuf] {
+        &self.html_changed_files[..]
+    }
+
     /// Get what was printed to standard output, if anything.
     pub fn get_stdout_content(&self) -> Vec<u8> {
         self.bs
@@ -2015,7 +2998,7 @@ impl ProcessingSession {
             .files
             .borrow()
             .get(self.bs.mem.stdout_key())
-            .map(|mfi| mfi.data.clone())
+            .and_then(|mfi| mfi.contents().ok().map(|data| data.into_owned()))
             .unwrap_or_default()
     }
 
@@ -2119,7 +3102,8 @@ impl ProcessingSession {
             InBiberFileRequirement,
         }
 
-        let curs = Cursor::new(&run_xml_entry.data[..]);
+        let run_xml_data = run_xml_entry.contents()?;
+        let curs = Cursor::new(&run_xml_data[..]);
         let mut reader = NsReader::from_reader(curs);
         let mut buf = Vec::new();
         let mut state = State::Searching;
@@ -2265,3 +3249,22 @@ impl ProcessingSession {
         })
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn preamble_end() {
+        assert_eq!(find_preamble_end(b"\\documentclass{article}\n"), None);
+        assert_eq!(
+            find_preamble_end(b"\\documentclass{article}\n\\begin{document}\nHi\n"),
+            Some(24)
+        );
+        assert_eq!(
+            find_preamble_end(b"% \\begin{document}\n  \\begin{document}"),
+            Some(21)
+        );
+        assert_eq!(find_preamble_end(b"50\\% \\begin{document}"), Some(5));
+    }
+}
@@ -15,7 +15,9 @@ use crate::{errors::Result, unstable_opts::UnstableOptions};
 /// apply any settings that you wish, and eventually run the
 /// [`process()`](Self::process) method.
 #[derive(Default)]
-pub struct BibtexEngine {}
+pub struct BibtexEngine {
+    statistics: Vec<(&'static str, u64)>,
+}
 
 impl BibtexEngine {
     /// Create a new, default engine for running `bibtex`.
@@ -23,6 +25,12 @@ impl BibtexEngine {
         Default::default()
     }
 
+    /// Get statistics about the most recent run of the engine. See
+    /// [`tectonic_engine_bibtex::BibtexEngine::statistics`].
+    pub fn statistics(&self) -> &[(&'static str, u64)] {
+        &self.statistics
+    }
+
     /// Process a document using the current engine configuration.
     ///
     /// The *launcher* parameter gives overarching environmental context in
@@ -45,7 +53,9 @@ impl BibtexEngine {
             real_engine.min_crossrefs(x);
         }
 
-        let real_outcome = real_engine.process(launcher, aux)?;
+        let real_outcome = real_engine.process(launcher, aux);
+        self.statistics = real_engine.statistics().to_vec();
+        let real_outcome = real_outcome?;
 
         match real_outcome {
             BibtexOutcome::Spotless => Ok(TexOutcome::Spotless),
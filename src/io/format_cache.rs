@@ -4,13 +4,38 @@
 //! Code for locally caching compiled format files.
 
 use std::{
-    io::{BufReader, Write},
+    io::{BufRead, BufReader, Read, Write},
     path::PathBuf,
 };
 use tectonic_errors::{anyhow::bail, Result};
 
 use super::{InputHandle, InputOrigin, IoProvider, OpenResult};
-use crate::{digest::DigestData, status::StatusBackend};
+use crate::{
+    digest::{self, Digest, DigestData},
+    status::StatusBackend,
+    tt_warning,
+};
+
+/// Get the path, within a bundle, of the prebuilt format file for the format
+/// `name`.
+///
+/// Bundles may ship format files that were generated when they were packed,
+/// so that users don't need to generate them locally. Since format files
+/// depend on the engine internals, the path includes the engine's
+/// [`crate::FORMAT_SERIAL`]: an engine with a different serial simply won't
+/// find a prebuilt format, and will generate one itself. Each format file is
+/// accompanied by a file with the same name plus `.sha256`, containing the
+/// hex SHA256 digest of the format data.
+pub fn prebuilt_format_path(name: &str) -> Result<String> {
+    let stem = match name.split('.').next() {
+        Some(s) if !s.is_empty() => s,
+        _ => {
+            bail!("incomprehensible format file name \"{}\"", name);
+        }
+    };
+
+    Ok(format!("formats/{}-{}.fmt", stem, crate::FORMAT_SERIAL))
+}
 
 /// A local cache for compiled format files.
 ///
@@ -38,8 +63,15 @@ impl FormatCache {
 
     /// Get an on-disk path name for a given format file. This function simply
     /// produces a path that may or may not exist.
-    #[allow(clippy::manual_split_once)] // requires Rust 1.52 (note that we don't actually define our MSRV)
     fn path_for_format(&mut self, name: &str) -> Result<PathBuf> {
+        self.path_with_extension(name, "fmt")
+    }
+
+    /// Get an on-disk path name for a file associated with a format, using the
+    /// same naming scheme as the format file itself but with a different
+    /// extension.
+    #[allow(clippy::manual_split_once)] // requires Rust 1.52 (note that we don't actually define our MSRV)
+    fn path_with_extension(&mut self, name: &str, extension: &str) -> Result<PathBuf> {
         // Remove all extensions from the format name. PathBuf.file_stem() doesn't
         // do what we want since it only strips one extension, so here we go:
 
@@ -52,13 +84,125 @@ impl FormatCache {
 
         let mut p = self.formats_base.clone();
         p.push(format!(
-            "{}-{}-{}.fmt",
+            "{}-{}-{}.{}",
             self.bundle_digest,
             stem,
-            crate::FORMAT_SERIAL
+            crate::FORMAT_SERIAL,
+            extension
         ));
         Ok(p)
     }
+
+    /// Read the dependency manifest saved alongside a format file.
+    ///
+    /// Formats generated from document preambles depend on files outside of
+    /// the bundle, so they are saved along with a list of the names and
+    /// digests of those files. Returns `Ok(None)` if no manifest exists.
+    pub fn read_dependency_manifest(
+        &mut self,
+        name: &str,
+    ) -> Result<Option<Vec<(String, DigestData)>>> {
+        let path = self.path_with_extension(name, "deps")?;
+
+        let f = match super::try_open_file(path) {
+            OpenResult::Ok(f) => f,
+            OpenResult::NotAvailable => return Ok(None),
+            OpenResult::Err(e) => return Err(e),
+        };
+
+        let mut deps = Vec::new();
+
+        for line in BufReader::new(f).lines() {
+            let line = line?;
+
+            // Lines are "{digest} {name}"; names may contain spaces, digests
+            // can't.
+            let (digest, dep_name) = match line.split_once(' ') {
+                Some(t) => t,
+                None => bail!("malformed format dependency manifest line \"{}\"", line),
+            };
+
+            deps.push((dep_name.to_owned(), digest.parse()?));
+        }
+
+        Ok(Some(deps))
+    }
+
+    /// Save the dependency manifest associated with a format file. See
+    /// [`Self::read_dependency_manifest`].
+    pub fn write_dependency_manifest(
+        &mut self,
+        name: &str,
+        deps: &[(String, DigestData)],
+    ) -> Result<()> {
+        let final_path = self.path_with_extension(name, "deps")?;
+        let mut temp_dest = tempfile::Builder::new()
+            .prefix("format_")
+            .rand_bytes(6)
+            .tempfile_in(&self.formats_base)?;
+
+        for (dep_name, digest) in deps {
+            writeln!(temp_dest, "{digest} {dep_name}")?;
+        }
+
+        temp_dest.persist(final_path)?;
+        Ok(())
+    }
+
+    /// Install a prebuilt format file from a bundle into the cache.
+    ///
+    /// See [`prebuilt_format_path`] for how prebuilt formats are named. The
+    /// format data are only installed if they match the digest that the
+    /// bundle provides alongside them. Returns `Ok(false)` if the bundle has
+    /// no suitable prebuilt format, in which case the caller should generate
+    /// the format itself.
+    pub fn install_prebuilt(
+        &mut self,
+        name: &str,
+        bundle: &mut dyn IoProvider,
+        status: &mut dyn StatusBackend,
+    ) -> Result<bool> {
+        let path = prebuilt_format_path(name)?;
+        let digest_path = format!("{path}.sha256");
+
+        let mut digest_text = String::new();
+
+        match bundle.input_open_name(&digest_path, status) {
+            OpenResult::Ok(mut ih) => {
+                ih.read_to_string(&mut digest_text)?;
+            }
+            OpenResult::NotAvailable => return Ok(false),
+            OpenResult::Err(e) => return Err(e),
+        }
+
+        let expected: DigestData = digest_text.trim().parse()?;
+
+        let mut data = Vec::new();
+
+        match bundle.input_open_name(&path, status) {
+            OpenResult::Ok(mut ih) => {
+                ih.read_to_end(&mut data)?;
+            }
+            OpenResult::NotAvailable => return Ok(false),
+            OpenResult::Err(e) => return Err(e),
+        }
+
+        let mut dc = digest::create();
+        dc.update(&data);
+        let actual = DigestData::from(dc);
+
+        if actual != expected {
+            tt_warning!(
+                status,
+                "prebuilt format file \"{}\" in the bundle is corrupt; ignoring it",
+                path
+            );
+            return Ok(false);
+        }
+
+        self.write_format(name, &data, status)?;
+        Ok(true)
+    }
 }
 
 impl IoProvider for FormatCache {
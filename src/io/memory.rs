@@ -5,36 +5,248 @@
 //! MemoryIo is an IoProvider that stores "files" in in-memory buffers.
 
 use std::{
+    borrow::Cow,
     cell::RefCell,
     collections::HashMap,
+    fs::File,
     io::{self, Cursor, Read, Seek, SeekFrom, Write},
+    path::{Path, PathBuf},
     rc::Rc,
+    sync::atomic::{AtomicU64, Ordering},
     time::SystemTime,
 };
 use tectonic_errors::Result;
 use tectonic_status_base::StatusBackend;
+use tempfile::NamedTempFile;
 
 use super::{
     normalize_tex_path, InputFeatures, InputHandle, InputOrigin, IoProvider, OpenResult,
     OutputHandle,
 };
 
+/// File contents that have been moved out of memory into a temporary file on
+/// disk.
+///
+/// Files can end up here in two ways: either they grew past the spill
+/// threshold of their [`MemoryIo`], or they were registered with
+/// [`MemoryIo::stream_output_to_dir`] so that they are written straight into
+/// their final destination directory. The temporary file is deleted when the
+/// last reference to it goes away, unless it has been persisted.
+#[derive(Debug)]
+pub struct SpilledFile {
+    file: NamedTempFile,
+
+    /// Whether the file was created with the restrictive permissions that
+    /// temporary files get by default, rather than those of a normally created
+    /// file.
+    private: bool,
+}
+
+impl SpilledFile {
+    /// Create a new spill file. Files in the system temporary directory are
+    /// private to the user, but ones created in a specific directory, which
+    /// may well become final outputs, get the same permissions as any other
+    /// new file.
+    fn new_in(dir: Option<&Path>) -> io::Result<SpilledFile> {
+        let file = match dir {
+            Some(d) => {
+                let mut builder = tempfile::Builder::new();
+
+                #[cfg(unix)]
+                {
+                    use std::os::unix::fs::PermissionsExt;
+                    builder.permissions(std::fs::Permissions::from_mode(0o666));
+                }
+
+                builder.tempfile_in(d)?
+            }
+            None => NamedTempFile::new()?,
+        };
+
+        Ok(SpilledFile {
+            file,
+            private: dir.is_none(),
+        })
+    }
+
+    /// Get the current size of the spilled data.
+    pub fn len(&self) -> io::Result<u64> {
+        Ok(self.file.as_file().metadata()?.len())
+    }
+
+    /// Get the path of the temporary file holding the spilled data.
+    pub fn path(&self) -> &Path {
+        self.file.path()
+    }
+
+    /// Read (part of) the data at a given offset. Because several handles may
+    /// share the same underlying file, every access seeks explicitly.
+    fn read_at(&self, pos: u64, buf: &mut [u8]) -> io::Result<usize> {
+        let mut f = self.file.as_file();
+        f.seek(SeekFrom::Start(pos))?;
+        f.read(buf)
+    }
+
+    /// Copy all of the data into a writer. We go through our own file handle
+    /// rather than reopening the file by name, since it may have been renamed.
+    fn copy_to<W: Write + ?Sized>(&self, dest: &mut W) -> io::Result<()> {
+        let mut buf = vec![0u8; 65536];
+        let mut pos = 0;
+
+        loop {
+            let n = self.read_at(pos, &mut buf[..])?;
+
+            if n == 0 {
+                return Ok(());
+            }
+
+            dest.write_all(&buf[..n])?;
+            pos += n as u64;
+        }
+    }
+
+    /// Write all of the data at a given offset.
+    fn write_all_at(&self, pos: u64, buf: &[u8]) -> io::Result<()> {
+        let mut f = self.file.as_file();
+        f.seek(SeekFrom::Start(pos))?;
+        f.write_all(buf)
+    }
+}
+
+impl PartialEq for SpilledFile {
+    fn eq(&self, other: &Self) -> bool {
+        self.path() == other.path()
+    }
+}
+
+impl Eq for SpilledFile {}
+
 /// Information about a file created or used inside the memory-backed I/O
 /// provider.
 #[derive(Clone, Debug, Eq, PartialEq)]
 pub struct MemoryFileInfo {
-    // TODO: smarter buffering structure than Vec<u8>? E.g., linked list of 4k
-    // chunks or something. In the current scheme reallocations will get
-    // expensive.
-    /// Raw file bytes
+    /// Raw file bytes. If the file has been spilled to disk, or was streamed
+    /// there with [`MemoryIo::stream_output_to_dir`], this is empty and the
+    /// contents must be accessed through [`Self::spilled`], or more
+    /// conveniently, through methods like [`Self::contents`].
     pub data: Vec<u8>,
+    /// The on-disk storage of the file contents, if they have been moved out of
+    /// memory.
+    pub spilled: Option<Rc<SpilledFile>>,
     /// Last modification time of the in-memory file
     pub unix_mtime: Option<i64>,
+    /// A number that changes whenever the file contents might have changed.
+    /// Unlike [`Self::unix_mtime`], this has no resolution issues: two
+    /// versions of a file never have the same generation, so it can be used
+    /// to tell which files need to be copied again after a change.
+    pub generation: u64,
+}
+
+impl MemoryFileInfo {
+    /// Get the size of the file contents.
+    pub fn len(&self) -> u64 {
+        match self.spilled {
+            Some(ref s) => s.len().unwrap_or(0),
+            None => self.data.len() as u64,
+        }
+    }
+
+    /// Check whether the file is empty.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Get the file contents. If the file has been spilled to disk, this reads
+    /// the whole thing back into memory, so prefer [`Self::write_to`] or
+    /// [`Self::persist_to`] for potentially large files.
+    pub fn contents(&self) -> io::Result<Cow<'_, [u8]>> {
+        match self.spilled {
+            Some(ref s) => {
+                let mut data = Vec::with_capacity(s.len()? as usize);
+                s.copy_to(&mut data)?;
+                Ok(Cow::Owned(data))
+            }
+            None => Ok(Cow::Borrowed(&self.data[..])),
+        }
+    }
+
+    /// Consume this item and get the file contents as an owned buffer.
+    pub fn into_data(self) -> io::Result<Vec<u8>> {
+        match self.spilled {
+            Some(_) => Ok(self.contents()?.into_owned()),
+            None => Ok(self.data),
+        }
+    }
+
+    /// Stream the file contents into a writer.
+    pub fn write_to<W: Write + ?Sized>(&self, dest: &mut W) -> io::Result<()> {
+        match self.spilled {
+            Some(ref s) => s.copy_to(dest),
+            None => dest.write_all(&self.data),
+        }
+    }
+
+    /// Save the file contents to the given path on disk.
+    ///
+    /// If the contents have been spilled into a temporary file on the same
+    /// filesystem, this is a cheap rename; otherwise the data are copied.
+    /// Files spilled into the system temporary directory are always copied,
+    /// so that the result doesn't end up with their private permissions.
+    pub fn persist_to(&self, path: &Path) -> io::Result<()> {
+        if let Some(s) = self.spilled.as_ref().filter(|s| !s.private) {
+            // The open file handle stays valid after the rename, so the
+            // contents remain readable through this item; and the temporary
+            // file cleanup will silently find nothing to delete. If the rename
+            // fails (e.g., across filesystems), fall back to copying.
+            if std::fs::rename(s.path(), path).is_ok() {
+                return Ok(());
+            }
+        }
+
+        let mut f = File::create(path)?;
+        self.write_to(&mut f)
+    }
+
+    /// Make the file contents available at the given path on disk, leaving
+    /// this item untouched. Any existing file at the path is replaced.
+    ///
+    /// This always copies the data. Hardlinking a spilled file would be
+    /// cheaper, but whoever uses the exported file could then modify our copy,
+    /// and a later [`Self::persist_to`] would move the shared file into place.
+    pub fn export_to(&self, path: &Path) -> io::Result<()> {
+        match std::fs::remove_file(path) {
+            Err(e) if e.kind() != io::ErrorKind::NotFound => return Err(e),
+            _ => {}
+        }
+
+        let mut f = File::create(path)?;
+        self.write_to(&mut f)
+    }
 }
 
 /// A collection of files created or used inside a memory-backed I/O provider.
 pub type MemoryFileCollection = HashMap<String, MemoryFileInfo>;
 
+/// The storage backing an open [`MemoryIoItem`].
+enum ItemState {
+    /// The data live in memory.
+    Memory(Cursor<Vec<u8>>),
+
+    /// The data have been moved to a file on disk. We track our own position
+    /// since the OS-level file offset may be shared with other handles.
+    /// Writes are collected in `pending`, which holds the data just before
+    /// `pos`, so that engines writing a byte at a time don't make a system
+    /// call for each one.
+    Spilled {
+        file: Rc<SpilledFile>,
+        pos: u64,
+        pending: Vec<u8>,
+    },
+}
+
+/// How much written data to collect before passing it on to a spilled file.
+const SPILL_WRITE_BUFFER_SIZE: usize = 65536;
+
 /// When a file is "opened", we create a MemoryIoItem struct that tracks the
 /// data, seek cursor state, etc.
 struct MemoryIoItem {
@@ -43,9 +255,17 @@ struct MemoryIoItem {
     files: Rc<RefCell<MemoryFileCollection>>,
 
     name: String,
-    state: Cursor<Vec<u8>>,
+    state: ItemState,
     unix_mtime: Option<i64>,
+    generation: u64,
     was_modified: bool,
+
+    /// If the in-memory data would grow past this size, move them to disk.
+    spill_threshold: Option<usize>,
+
+    /// The directory in which to create spill files; the system temporary
+    /// directory if None.
+    spill_dir: Option<PathBuf>,
 }
 
 /// Get the current time as a Unix time, in a manner consistent with our Unix
@@ -62,59 +282,193 @@ fn now_as_unix_time() -> i64 {
     dur.as_secs() as i64
 }
 
+/// Get a new file generation number, never returned before in this process.
+fn next_generation() -> u64 {
+    static NEXT: AtomicU64 = AtomicU64::new(1);
+    NEXT.fetch_add(1, Ordering::Relaxed)
+}
+
 impl MemoryIoItem {
     pub fn new(
         files: &Rc<RefCell<MemoryFileCollection>>,
         name: &str,
         truncate: bool,
     ) -> MemoryIoItem {
-        let (cur_data, cur_mtime) = match files.borrow_mut().remove(name) {
+        let (state, cur_mtime, generation) = match files.borrow_mut().remove(name) {
             Some(info) => {
                 if truncate {
-                    (Vec::new(), Some(now_as_unix_time()))
+                    (
+                        ItemState::Memory(Cursor::new(Vec::new())),
+                        Some(now_as_unix_time()),
+                        next_generation(),
+                    )
                 } else {
-                    (info.data, info.unix_mtime)
+                    let state = match info.spilled {
+                        Some(file) => ItemState::Spilled {
+                            file,
+                            pos: 0,
+                            pending: Vec::new(),
+                        },
+                        None => ItemState::Memory(Cursor::new(info.data)),
+                    };
+                    (state, info.unix_mtime, info.generation)
                 }
             }
-            None => (Vec::new(), Some(now_as_unix_time())),
+            None => (
+                ItemState::Memory(Cursor::new(Vec::new())),
+                Some(now_as_unix_time()),
+                next_generation(),
+            ),
         };
 
         MemoryIoItem {
             files: files.clone(),
             name: name.to_owned(),
-            state: Cursor::new(cur_data),
+            state,
             unix_mtime: cur_mtime,
+            generation,
             was_modified: false,
+            spill_threshold: None,
+            spill_dir: None,
+        }
+    }
+
+    /// Move the data of this item out of memory into a temporary file in
+    /// `dir`, or the system temporary directory if None. Subsequent reads and
+    /// writes will go to the file.
+    fn spill(&mut self, dir: Option<&Path>) -> io::Result<()> {
+        if let ItemState::Memory(ref cursor) = self.state {
+            let file = SpilledFile::new_in(dir)?;
+            file.file.as_file().write_all(cursor.get_ref())?;
+            let pos = cursor.position();
+            self.state = ItemState::Spilled {
+                file: Rc::new(file),
+                pos,
+                pending: Vec::new(),
+            };
+        }
+
+        Ok(())
+    }
+
+    /// Write out any data that are waiting to go into the spilled file.
+    fn write_pending(&mut self) -> io::Result<()> {
+        if let ItemState::Spilled {
+            ref file,
+            pos,
+            ref mut pending,
+        } = self.state
+        {
+            if !pending.is_empty() {
+                file.write_all_at(pos - pending.len() as u64, pending)?;
+                pending.clear();
+            }
+        }
+
+        Ok(())
+    }
+
+    fn len(&mut self) -> io::Result<u64> {
+        self.write_pending()?;
+
+        match self.state {
+            ItemState::Memory(ref c) => Ok(c.get_ref().len() as u64),
+            ItemState::Spilled { ref file, .. } => file.len(),
         }
     }
 }
 
 impl Read for MemoryIoItem {
     fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
-        self.state.read(buf)
+        self.write_pending()?;
+
+        match self.state {
+            ItemState::Memory(ref mut c) => c.read(buf),
+            ItemState::Spilled {
+                ref file,
+                ref mut pos,
+                ..
+            } => {
+                let n = file.read_at(*pos, buf)?;
+                *pos += n as u64;
+                Ok(n)
+            }
+        }
     }
 }
 
 impl Write for MemoryIoItem {
     fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
         self.was_modified = true;
-        self.state.write(buf)
+
+        if let (ItemState::Memory(c), Some(threshold)) = (&self.state, self.spill_threshold) {
+            if c.get_ref().len() + buf.len() > threshold {
+                let dir = self.spill_dir.clone();
+                self.spill(dir.as_deref())?;
+            }
+        }
+
+        match self.state {
+            ItemState::Memory(ref mut c) => c.write(buf),
+            ItemState::Spilled {
+                ref file,
+                ref mut pos,
+                ref mut pending,
+            } => {
+                pending.extend_from_slice(buf);
+                *pos += buf.len() as u64;
+
+                if pending.len() >= SPILL_WRITE_BUFFER_SIZE {
+                    file.write_all_at(*pos - pending.len() as u64, pending)?;
+                    pending.clear();
+                }
+
+                Ok(buf.len())
+            }
+        }
     }
 
     fn flush(&mut self) -> io::Result<()> {
-        self.state.flush()
+        self.write_pending()?;
+
+        match self.state {
+            ItemState::Memory(ref mut c) => c.flush(),
+            ItemState::Spilled { ref file, .. } => file.file.as_file().flush(),
+        }
     }
 }
 
 impl Seek for MemoryIoItem {
-    fn seek(&mut self, pos: SeekFrom) -> io::Result<u64> {
-        self.state.seek(pos)
+    fn seek(&mut self, seek: SeekFrom) -> io::Result<u64> {
+        let len = self.len()?;
+
+        match self.state {
+            ItemState::Memory(ref mut c) => c.seek(seek),
+            ItemState::Spilled { ref mut pos, .. } => {
+                let new_pos = match seek {
+                    SeekFrom::Start(n) => Some(n),
+                    SeekFrom::End(d) => len.checked_add_signed(d),
+                    SeekFrom::Current(d) => pos.checked_add_signed(d),
+                };
+
+                match new_pos {
+                    Some(n) => {
+                        *pos = n;
+                        Ok(n)
+                    }
+                    None => Err(io::Error::new(
+                        io::ErrorKind::InvalidInput,
+                        "invalid seek to a negative or overflowing position",
+                    )),
+                }
+            }
+        }
     }
 }
 
 impl InputFeatures for MemoryIoItem {
     fn get_size(&mut self) -> Result<usize> {
-        Ok(self.state.get_ref().len())
+        Ok(self.len()? as usize)
     }
 
     fn get_unix_mtime(&mut self) -> Result<Option<i64>> {
@@ -122,27 +476,38 @@ impl InputFeatures for MemoryIoItem {
     }
 
     fn try_seek(&mut self, pos: SeekFrom) -> Result<u64> {
-        Ok(self.state.seek(pos)?)
+        Ok(self.seek(pos)?)
     }
 }
 
 impl Drop for MemoryIoItem {
     fn drop(&mut self) {
-        let unix_mtime = if self.was_modified {
-            Some(now_as_unix_time())
+        let (unix_mtime, generation) = if self.was_modified {
+            (Some(now_as_unix_time()), next_generation())
         } else {
-            self.unix_mtime
+            (self.unix_mtime, self.generation)
+        };
+
+        // Output handles are flushed when they're closed, so this is just a
+        // fallback, and there's nowhere to report an error anyway.
+        let _ = self.write_pending();
+
+        // Move our data back into the hashmap. Ideally we could "consume" self
+        // but that's not possible in a Drop implementation.
+        let state = std::mem::replace(&mut self.state, ItemState::Memory(Cursor::new(Vec::new())));
+        let (data, spilled) = match state {
+            ItemState::Memory(c) => (c.into_inner(), None),
+            ItemState::Spilled { file, .. } => (Vec::new(), Some(file)),
         };
 
-        // I think split_off() is an efficient way to move our data vector
-        // back into the hashmap? Ideally we could "consume" self but I don't
-        // believe that's possible in a Drop implementation.
         let mut mfiles = self.files.borrow_mut();
         mfiles.insert(
             self.name.clone(),
             MemoryFileInfo {
-                data: self.state.get_mut().split_off(0),
+                data,
+                spilled,
                 unix_mtime,
+                generation,
             },
         );
     }
@@ -153,6 +518,9 @@ pub struct MemoryIo {
     /// Map of file paths to in-memory file data in this I/O provider.
     pub files: Rc<RefCell<MemoryFileCollection>>,
     stdout_allowed: bool,
+    spill_threshold: Option<usize>,
+    spill_dir: Option<PathBuf>,
+    streamed_outputs: HashMap<String, PathBuf>,
 }
 
 impl MemoryIo {
@@ -162,9 +530,35 @@ impl MemoryIo {
         MemoryIo {
             files: Rc::new(RefCell::new(HashMap::new())),
             stdout_allowed,
+            spill_threshold: None,
+            spill_dir: None,
+            streamed_outputs: HashMap::new(),
         }
     }
 
+    /// Set a size above which written files are moved out of memory into
+    /// temporary files, created in `spill_dir` or the system temporary
+    /// directory. By default, files are never spilled.
+    ///
+    /// Spilled files remain fully readable through this provider, but their
+    /// contents aren't available in [`MemoryFileInfo::data`].
+    pub fn set_spill_threshold(&mut self, threshold: Option<usize>, spill_dir: Option<PathBuf>) {
+        self.spill_threshold = threshold;
+        self.spill_dir = spill_dir;
+    }
+
+    /// Arrange for the output file *name* to be written straight into a
+    /// temporary file in the directory *dir*, rather than being buffered in
+    /// memory. This is useful for large final outputs: if the temporary file
+    /// lives next to the eventual destination,
+    /// [`MemoryFileInfo::persist_to`] can put it in place with a cheap rename.
+    /// If the temporary file can't be created when the output is opened, the
+    /// file is buffered in memory as usual.
+    pub fn stream_output_to_dir(&mut self, name: &str, dir: &Path) {
+        self.streamed_outputs
+            .insert(normalize_tex_path(name).into_owned(), dir.to_owned());
+    }
+
     /// Create a new entry into the backing file collection, with automatically generated
     /// modification time.
     pub fn create_entry(&mut self, name: &str, data: Vec<u8>) {
@@ -173,7 +567,9 @@ impl MemoryIo {
             name.to_owned(),
             MemoryFileInfo {
                 data,
+                spilled: None,
                 unix_mtime: Some(now_as_unix_time()),
+                generation: next_generation(),
             },
         );
     }
@@ -192,7 +588,17 @@ impl IoProvider for MemoryIo {
 
         let name = normalize_tex_path(name);
 
-        let oh = OutputHandle::new(name.clone(), MemoryIoItem::new(&self.files, &name, true));
+        let mut item = MemoryIoItem::new(&self.files, &name, true);
+        item.spill_threshold = self.spill_threshold;
+        item.spill_dir.clone_from(&self.spill_dir);
+
+        // If the streaming destination isn't usable (e.g., the output
+        // directory doesn't exist yet), just buffer the file as usual.
+        if let Some(dir) = self.streamed_outputs.get(&*name) {
+            let _ = item.spill(Some(dir));
+        }
+
+        let oh = OutputHandle::new(name.clone(), item);
 
         // `hyperxmp.sty` does a thing where it tries to get today's date by
         // calling \filemoddate on `\jobname.log`. That essentially relies on it
@@ -293,4 +699,186 @@ mod tests {
             assert_eq!(s.len(), 0);
         }
     }
+
+    /// Files that grow past the spill threshold should move to disk but
+    /// otherwise behave exactly like in-memory files.
+    #[test]
+    fn spilled_file() {
+        let mut mem = MemoryIo::new(false);
+        mem.set_spill_threshold(Some(16), None);
+        let name = "big.xdv";
+        let mut sb = NoopStatusBackend::default();
+
+        {
+            let mut h = mem.output_open_name(name).unwrap();
+            for i in 0..10 {
+                writeln!(h, "line {i}").unwrap();
+            }
+        }
+
+        let expected: String = (0..10).map(|i| format!("line {i}\n")).collect();
+
+        {
+            let files = mem.files.borrow();
+            let info = files.get(name).unwrap();
+            assert!(info.spilled.is_some());
+            assert!(info.data.is_empty());
+            assert_eq!(info.len(), expected.len() as u64);
+            assert_eq!(&info.contents().unwrap()[..], expected.as_bytes());
+        }
+
+        {
+            let mut h = mem.input_open_name(name, &mut sb).unwrap();
+            let mut s = String::new();
+            h.read_to_string(&mut s).unwrap();
+            assert_eq!(s, expected);
+        }
+
+        // Small files stay in memory.
+        {
+            let mut h = mem.output_open_name("small.aux").unwrap();
+            writeln!(h, "tiny").unwrap();
+        }
+
+        let files = mem.files.borrow();
+        let info = files.get("small.aux").unwrap();
+        assert!(info.spilled.is_none());
+        assert_eq!(&info.data[..], b"tiny\n");
+    }
+
+    #[test]
+    fn streamed_output() {
+        let dir = tempfile::tempdir().unwrap();
+        let mut mem = MemoryIo::new(false);
+        mem.stream_output_to_dir("out.pdf", dir.path());
+
+        // Engines write a lot of their output a byte at a time.
+        {
+            let mut h = mem.output_open_name("out.pdf").unwrap();
+
+            for b in b"%PDF-1.5\n" {
+                h.write_all(&[*b]).unwrap();
+            }
+
+            h.flush().unwrap();
+        }
+
+        let files = mem.files.borrow();
+        let info = files.get("out.pdf").unwrap();
+        let spilled = info.spilled.as_ref().unwrap();
+        assert_eq!(spilled.path().parent(), Some(dir.path()));
+
+        let dest = dir.path().join("out.pdf");
+        info.persist_to(&dest).unwrap();
+        assert_eq!(std::fs::read(&dest).unwrap(), b"%PDF-1.5\n");
+
+        // The output gets the same permissions as a normally created file.
+        #[cfg(unix)]
+        {
+            use std::os::unix::fs::PermissionsExt;
+            let plain = dir.path().join("plain");
+            File::create(&plain).unwrap();
+            let mode = |p: &Path| std::fs::metadata(p).unwrap().permissions().mode();
+            assert_eq!(mode(&dest), mode(&plain));
+        }
+    }
+
+    /// Writes to spilled files are buffered, but reads and seeks must see
+    /// them.
+    #[test]
+    fn buffered_spill_writes() {
+        let mem = MemoryIo::new(false);
+        let mut item = MemoryIoItem::new(&mem.files, "a.xdv", true);
+        item.spill(None).unwrap();
+
+        for b in b"0123456789" {
+            item.write_all(&[*b]).unwrap();
+        }
+
+        assert_eq!(item.seek(SeekFrom::End(0)).unwrap(), 10);
+        item.seek(SeekFrom::Start(4)).unwrap();
+        item.write_all(b"ab").unwrap();
+        let mut s = String::new();
+        item.read_to_string(&mut s).unwrap();
+        assert_eq!(s, "6789");
+        item.write_all(b"!").unwrap();
+        drop(item);
+
+        let files = mem.files.borrow();
+        let info = files.get("a.xdv").unwrap();
+        assert_eq!(&info.contents().unwrap()[..], b"0123ab6789!");
+    }
+
+    /// Generations should change when a file is rewritten, but not when it
+    /// is just read.
+    #[test]
+    fn generations() {
+        let mut mem = MemoryIo::new(false);
+        let mut sb = NoopStatusBackend::default();
+        let generation = |mem: &MemoryIo| mem.files.borrow().get("a.aux").unwrap().generation;
+
+        {
+            let mut h = mem.output_open_name("a.aux").unwrap();
+            writeln!(h, "one").unwrap();
+        }
+
+        let g1 = generation(&mem);
+
+        {
+            let mut h = mem.input_open_name("a.aux", &mut sb).unwrap();
+            let mut s = String::new();
+            h.read_to_string(&mut s).unwrap();
+        }
+
+        assert_eq!(generation(&mem), g1);
+
+        {
+            let mut h = mem.output_open_name("a.aux").unwrap();
+            writeln!(h, "one").unwrap();
+        }
+
+        assert_ne!(generation(&mem), g1);
+    }
+
+    #[test]
+    fn exported_file() {
+        let dir = tempfile::tempdir().unwrap();
+        let dest = dir.path().join("big.xdv");
+        let mut mem = MemoryIo::new(false);
+        mem.set_spill_threshold(Some(4), Some(dir.path().to_owned()));
+
+        {
+            let mut h = mem.output_open_name("big.xdv").unwrap();
+            h.write_all(b"0123456789").unwrap();
+        }
+
+        mem.files
+            .borrow()
+            .get("big.xdv")
+            .unwrap()
+            .export_to(&dest)
+            .unwrap();
+        assert_eq!(std::fs::read(&dest).unwrap(), b"0123456789");
+
+        // The export is a separate copy.
+        std::fs::write(&dest, b"changed").unwrap();
+        let files = mem.files.borrow();
+        let info = files.get("big.xdv").unwrap();
+        assert_eq!(&info.contents().unwrap()[..], b"0123456789");
+        drop(files);
+
+        // Exporting again replaces the previous export.
+        {
+            let mut h = mem.output_open_name("big.xdv").unwrap();
+            h.write_all(b"abc").unwrap();
+        }
+
+        mem.files
+            .borrow()
+            .get("big.xdv")
+            .unwrap()
+            .export_to(&dest)
+            .unwrap();
+        assert_eq!(std::fs::read(&dest).unwrap(), b"abc");
+    }
 }
@@ -0,0 +1,259 @@
+// Copyright 2026 the Tectonic Project
+// Licensed under the MIT License.
+
+//! A cache of information that the engines have worked out about input files.
+//!
+//! To lay out an included image, XeTeX has to parse it: the header of a bitmap
+//! image, or the page tree of a PDF. It does this again on every pass, and
+//! then xdvipdfmx parses the same files yet again. This cache lets the engines
+//! save what they learned about a file, such as its page count or the
+//! dimensions of one of its pages, so that each file only needs to be parsed
+//! once. xdvipdfmx also uses it to save CMaps in a compiled form that is much
+//! quicker to load than the PostScript source. Entries are keyed by the digest
+//! of the file's contents and a key chosen by the engine. Their contents are
+//! arbitrary bytes, and up to the engines.
+//!
+//! Entries can be saved to disk, so that they are reused by later sessions
+//! too. Each file's entries are stored in their own cache file, named after its
+//! digest, as a sequence of records of the form `{key}\t{length}\n{value}\n`.
+//! The files live in a subdirectory named after [`CACHE_VERSION`].
+
+use std::{
+    collections::{BTreeMap, HashMap},
+    fs,
+    io::Write,
+    path::PathBuf,
+};
+use tectonic_errors::{anyhow::bail, Result};
+
+use crate::digest::DigestData;
+
+/// The version of the on-disk cache. This must be changed whenever an engine
+/// changes what it saves under an existing key, so that entries written by
+/// older versions of Tectonic are ignored rather than misread.
+pub const CACHE_VERSION: &str = "v1";
+
+/// A cache of information about input files, keyed by their digests.
+#[derive(Debug, Default)]
+pub struct MetadataCache {
+    /// Where to save entries so that they persist across sessions, if
+    /// anywhere.
+    base: Option<PathBuf>,
+
+    /// The digests of the files that have been looked up, keyed by name. An
+    /// entry has to be removed if the file might have changed.
+    digests: HashMap<String, DigestData>,
+
+    /// The entries for each file digest.
+    entries: HashMap<DigestData, FileEntries>,
+}
+
+/// The entries saved for one file.
+#[derive(Debug, Default)]
+struct FileEntries {
+    values: BTreeMap<String, Vec<u8>>,
+
+    /// Whether the entries saved on disk have been merged into `values`.
+    loaded: bool,
+}
+
+impl MetadataCache {
+    /// Create a new cache. If `base` is given, entries are loaded from and
+    /// saved to a subdirectory of it, if requested.
+    pub fn new(base: Option<PathBuf>) -> MetadataCache {
+        MetadataCache {
+            base: base.map(|b| b.join(CACHE_VERSION)),
+            ..Default::default()
+        }
+    }
+
+    /// Get the digest that was recorded for the file `name`, if any.
+    pub fn digest(&self, name: &str) -> Option<DigestData> {
+        self.digests.get(name).copied()
+    }
+
+    /// Record the digest of the contents of the file `name`.
+    pub fn set_digest(&mut self, name: &str, digest: DigestData) {
+        self.digests.insert(name.to_owned(), digest);
+    }
+
+    /// Forget the digest of the file `name`, because it might have changed.
+    pub fn forget(&mut self, name: &str) {
+        self.digests.remove(name);
+    }
+
+    /// Forget the digests of all files, because any of them might have
+    /// changed.
+    pub fn forget_all(&mut self) {
+        self.digests.clear();
+    }
+
+    /// Look up the value saved under `key` for the file with digest `digest`.
+    /// If `persist` is true, entries saved on disk by earlier sessions are
+    /// considered too.
+    pub fn get(&mut self, digest: &DigestData, key: &str, persist: bool) -> Option<&[u8]> {
+        self.load(digest, persist)
+            .values
+            .get(key)
+            .map(Vec::as_slice)
+    }
+
+    /// Save `value` under `key` for the file with digest `digest`. If
+    /// `persist` is true and the cache has a `base`, this also rewrites the
+    /// file's entries on disk.
+    pub fn put(
+        &mut self,
+        digest: &DigestData,
+        key: &str,
+        value: &[u8],
+        persist: bool,
+    ) -> Result<()> {
+        if key.is_empty() || key.contains(['\t', '\n']) {
+            bail!("invalid metadata cache entry \"{}\"", key);
+        }
+
+        let entries = &mut self.load(digest, persist).values;
+
+        if entries.get(key).map(Vec::as_slice) == Some(value) {
+            return Ok(());
+        }
+
+        entries.insert(key.to_owned(), value.to_owned());
+
+        let Some(base) = self.base.as_ref().filter(|_| persist) else {
+            return Ok(());
+        };
+
+        let mut text = Vec::new();
+
+        for (k, v) in &self.entries[digest].values {
+            writeln!(text, "{k}\t{}", v.len())?;
+            text.extend_from_slice(v);
+            text.push(b'\n');
+        }
+
+        let path = digest.create_two_part_path(base)?;
+        let mut temp = tempfile::Builder::new()
+            .prefix("entry_")
+            .rand_bytes(6)
+            .tempfile_in(path.parent().unwrap())?;
+        temp.write_all(&text)?;
+        temp.persist(path)?;
+        Ok(())
+    }
+
+    /// Get the entries for the file with digest `digest`. If `persist` is
+    /// true, the entries on disk are merged in first, if they haven't been
+    /// already; entries made during this session take precedence. A cache
+    /// file that can't be read is treated as empty, and reading stops at the
+    /// first malformed record, since that just means that the engines will
+    /// have to parse the file again.
+    fn load(&mut self, digest: &DigestData, persist: bool) -> &mut FileEntries {
+        let entries = self.entries.entry(*digest).or_default();
+
+        let Some(base) = self.base.as_ref().filter(|_| persist && !entries.loaded) else {
+            return entries;
+        };
+
+        entries.loaded = true;
+        let hex = digest.to_string();
+
+        if let Ok(data) = fs::read(base.join(&hex[..2]).join(&hex[2..])) {
+            let mut rest = &data[..];
+
+            while let Some((k, v, r)) = parse_record(rest) {
+                entries.values.entry(k).or_insert_with(|| v.to_owned());
+                rest = r;
+            }
+        }
+
+        entries
+    }
+}
+
+/// Parse one `{key}\t{length}\n{value}\n` record from the start of `data`,
+/// returning the key, the value, and the rest of the data.
+fn parse_record(data: &[u8]) -> Option<(String, &[u8], &[u8])> {
+    let nl = data.iter().position(|&b| b == b'\n')?;
+    let header = std::str::from_utf8(&data[..nl]).ok()?;
+    let (key, len) = header.split_once('\t')?;
+    let len = len.parse::<usize>().ok()?;
+    let rest = &data[nl + 1..];
+
+    if rest.len() <= len || rest[len] != b'\n' {
+        return None;
+    }
+
+    Some((key.to_owned(), &rest[..len], &rest[len + 1..]))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::digest::Digest;
+
+    fn digest_of(data: &[u8]) -> DigestData {
+        let mut dc = crate::digest::create();
+        dc.update(data);
+        DigestData::from(dc)
+    }
+
+    #[test]
+    fn persistence() {
+        let base = tempfile::tempdir().unwrap();
+        let a = digest_of(b"a");
+        let b = digest_of(b"b");
+
+        let c = digest_of(b"c");
+        let blob = b"\0binary\nvalue\t\n";
+
+        let mut cache = MetadataCache::new(Some(base.path().to_owned()));
+        assert_eq!(cache.get(&a, "pages", true), None);
+        cache.put(&a, "pages", b"3", true).unwrap();
+        cache.put(&a, "page:1:1", b"0 0 612 792", true).unwrap();
+        cache.put(&a, "cmap", blob, true).unwrap();
+        cache.put(&b, "pages", b"1", true).unwrap();
+        cache.put(&c, "pages", b"2", false).unwrap();
+        assert_eq!(cache.get(&a, "pages", true), Some(&b"3"[..]));
+        assert_eq!(cache.get(&c, "pages", true), Some(&b"2"[..]));
+        assert!(cache.put(&a, "bad\tkey", b"x", true).is_err());
+        assert!(cache.put(&a, "bad\nkey", b"x", true).is_err());
+
+        // A new session sees the entries that were saved.
+        let mut cache = MetadataCache::new(Some(base.path().to_owned()));
+        assert_eq!(cache.get(&a, "pages", true), Some(&b"3"[..]));
+        assert_eq!(cache.get(&a, "page:1:1", true), Some(&b"0 0 612 792"[..]));
+        assert_eq!(cache.get(&a, "cmap", true), Some(&blob[..]));
+        assert_eq!(cache.get(&b, "pages", true), Some(&b"1"[..]));
+        assert_eq!(cache.get(&b, "page:1:1", true), None);
+        assert_eq!(cache.get(&c, "pages", true), None);
+
+        // Entries are only read from disk if requested ...
+        let mut cache = MetadataCache::new(Some(base.path().to_owned()));
+        assert_eq!(cache.get(&a, "pages", false), None);
+        cache.put(&a, "pages", b"5", false).unwrap();
+        assert_eq!(cache.get(&a, "pages", true), Some(&b"5"[..]));
+        assert_eq!(cache.get(&a, "page:1:1", true), Some(&b"0 0 612 792"[..]));
+
+        // ... and only from the directory for this version of the cache.
+        assert!(base.path().join(CACHE_VERSION).is_dir());
+        let mut cache = MetadataCache::new(Some(base.path().join(CACHE_VERSION)));
+        assert_eq!(cache.get(&a, "pages", true), None);
+
+        // A cache without a base doesn't.
+        let mut cache = MetadataCache::new(None);
+        assert_eq!(cache.get(&a, "pages", true), None);
+        cache.put(&a, "pages", b"4", true).unwrap();
+        assert_eq!(cache.get(&a, "pages", true), Some(&b"4"[..]));
+
+        // Digests are remembered until they are forgotten.
+        cache.set_digest("fig.pdf", a);
+        cache.set_digest("fig.png", b);
+        assert_eq!(cache.digest("fig.pdf"), Some(a));
+        cache.forget("fig.pdf");
+        assert_eq!(cache.digest("fig.pdf"), None);
+        assert_eq!(cache.digest("fig.png"), Some(b));
+        cache.forget_all();
+        assert_eq!(cache.digest("fig.png"), None);
+    }
+}
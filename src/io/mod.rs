@@ -7,6 +7,8 @@ use tectonic_status_base::StatusBackend;
 
 pub mod format_cache;
 pub mod memory;
+pub mod metadata_cache;
+pub mod shell_escape_cache;
 
 // Convenience re-exports.
 
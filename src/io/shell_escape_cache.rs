@@ -0,0 +1,356 @@
+// Copyright 2026 the Tectonic Project
+// Licensed under the MIT License.
+
+//! A persistent cache of the results of shell-escape commands.
+//!
+//! Packages like `minted` run an external program for every code listing on
+//! every TeX pass, even though the output is almost always the same as last
+//! time. This cache lets the driver skip running a command if it has already
+//! run the same command on the same inputs. Results are keyed by the command
+//! text and the digests of the files in the work directory, and consist of
+//! the files that the command created or modified. File contents are stored
+//! by digest, so that identical outputs are only stored once.
+//!
+//! Commands often read files that they don't mention, such as the data files
+//! of `gnuplottex` plots, so every file in the work directory goes into the
+//! key, except for version control directories and the files that the driver
+//! says to ignore: the outputs of the build, and files like the `.aux` file
+//! that TeX rewrites on every pass. The cache can't know about anything
+//! outside of the work directory that a command depends on, such as the
+//! version of the program that it runs, so it is only used if explicitly
+//! requested.
+
+use std::{
+    collections::{BTreeMap, HashMap, HashSet},
+    fs,
+    io::{BufRead, BufReader, Read, Write},
+    path::{Path, PathBuf},
+    time::{Duration, SystemTime},
+};
+use tectonic_errors::{anyhow::bail, Result};
+
+use super::{try_open_file, OpenResult};
+use crate::digest::{self, Digest, DigestData};
+
+/// The contents of a work directory: the digest of each file in it, keyed by
+/// its path relative to the directory, with `/` as the separator.
+pub type DirState = BTreeMap<String, DigestData>;
+
+/// Directories used by version control systems, which are never scanned.
+const VCS_DIRS: &[&str] = &[".bzr", ".git", ".hg", ".jj", ".svn", "_darcs"];
+
+/// A persistent cache of the results of shell-escape commands.
+pub struct ShellEscapeCache {
+    base: PathBuf,
+
+    /// Paths, relative to the work directory, of files that should be left
+    /// out of scans, such as the final outputs of the build.
+    ignored: HashSet<String>,
+
+    /// Digests of files that we have already scanned, so that we only rehash
+    /// files that might have changed.
+    scanned: HashMap<PathBuf, ScannedFile>,
+}
+
+struct ScannedFile {
+    size: u64,
+    mtime: SystemTime,
+    hashed_at: SystemTime,
+    digest: DigestData,
+}
+
+impl ScannedFile {
+    /// Whether the file is known to be unchanged since it was hashed. A file
+    /// modified within the timestamp resolution of the filesystem after we
+    /// hashed it might keep the same modification time, so if the
+    /// modification time is too close to when we hashed the file, we can't
+    /// trust it.
+    fn is_current(&self, size: u64, mtime: SystemTime) -> bool {
+        const SLOP: Duration = Duration::from_secs(2);
+
+        size == self.size
+            && mtime == self.mtime
+            && mtime.checked_add(SLOP).is_some_and(|t| t < self.hashed_at)
+    }
+}
+
+impl ShellEscapeCache {
+    /// Create a new cache, stored in the directory `base`.
+    pub fn new(base: PathBuf) -> ShellEscapeCache {
+        ShellEscapeCache {
+            base,
+            ignored: HashSet::new(),
+            scanned: HashMap::new(),
+        }
+    }
+
+    /// Leave the file `name`, relative to the work directory and with `/` as
+    /// the separator, out of scans. This is meant for files like the outputs
+    /// of the build, which change all the time but shouldn't be of interest
+    /// to shell-escape commands.
+    pub fn ignore(&mut self, name: &str) {
+        self.ignored.insert(name.to_owned());
+    }
+
+    /// Get the digests of all of the files in the work directory `dir`,
+    /// except those in version control directories and ignored files.
+    pub fn scan(&mut self, dir: &Path) -> Result<DirState> {
+        let mut state = DirState::new();
+        self.scan_inner(dir, "", &mut state)?;
+        Ok(state)
+    }
+
+    fn scan_inner(&mut self, dir: &Path, prefix: &str, state: &mut DirState) -> Result<()> {
+        for entry in fs::read_dir(dir)? {
+            let entry = entry?;
+            let file_type = entry.file_type()?;
+
+            // Names that aren't Unicode can't be recorded in a manifest. A
+            // command that depends on such a file will just be rerun.
+            let Some(name) = entry.file_name().to_str().map(|s| format!("{prefix}{s}")) else {
+                continue;
+            };
+
+            let path = entry.path();
+
+            if file_type.is_dir() {
+                if !VCS_DIRS.contains(&&name[prefix.len()..]) {
+                    self.scan_inner(&path, &format!("{name}/"), state)?;
+                }
+            } else if file_type.is_file() && !self.ignored.contains(&name) {
+                let meta = entry.metadata()?;
+                let size = meta.len();
+                let mtime = meta.modified()?;
+
+                let digest = match self.scanned.get(&path) {
+                    Some(sf) if sf.is_current(size, mtime) => sf.digest,
+                    _ => {
+                        let hashed_at = SystemTime::now();
+                        let digest = digest_file(&path)?;
+                        self.scanned.insert(
+                            path,
+                            ScannedFile {
+                                size,
+                                mtime,
+                                hashed_at,
+                                digest,
+                            },
+                        );
+                        digest
+                    }
+                };
+
+                state.insert(name, digest);
+            }
+        }
+
+        Ok(())
+    }
+
+    /// Compute the cache key for running `command` in a work directory whose
+    /// contents are `state`.
+    pub fn key(command: &str, state: &DirState) -> DigestData {
+        let mut dc = digest::create();
+        dc.update(command.as_bytes());
+        dc.update([0u8]);
+
+        for (name, d) in state {
+            dc.update(name.as_bytes());
+            dc.update([0u8]);
+            dc.update(d.to_string().as_bytes());
+            dc.update([0u8]);
+        }
+
+        DigestData::from(dc)
+    }
+
+    /// If there are saved results for the cache key `key`, write them into the
+    /// work directory `dir` and return true. Otherwise return false.
+    pub fn replay(&mut self, key: &DigestData, dir: &Path) -> Result<bool> {
+        let f = match try_open_file(self.base.join("entries").join(key.to_string())) {
+            OpenResult::Ok(f) => f,
+            OpenResult::NotAvailable => return Ok(false),
+            OpenResult::Err(e) => return Err(e),
+        };
+
+        let mut outputs = Vec::new();
+
+        for line in BufReader::new(f).lines() {
+            let line = line?;
+
+            // Lines are "{digest} {name}"; names may contain spaces, digests
+            // can't.
+            let (d, name) = match line.split_once(' ') {
+                Some(t) => t,
+                None => bail!("malformed shell-escape cache entry line \"{}\"", line),
+            };
+
+            if name
+                .split('/')
+                .any(|c| c.is_empty() || c == "." || c == "..")
+            {
+                bail!("invalid path \"{}\" in shell-escape cache entry", name);
+            }
+
+            outputs.push((name.to_owned(), d.parse::<DigestData>()?));
+        }
+
+        // Make sure that we have everything before we touch the work
+        // directory.
+
+        let mut blobs = Vec::with_capacity(outputs.len());
+
+        for (_, d) in &outputs {
+            let blob = self.blob_path(d)?;
+
+            if !blob.is_file() {
+                return Ok(false);
+            }
+
+            blobs.push(blob);
+        }
+
+        for ((name, _), blob) in outputs.iter().zip(blobs) {
+            let dest = dir.join(name);
+
+            if let Some(parent) = dest.parent() {
+                fs::create_dir_all(parent)?;
+            }
+
+            fs::copy(blob, dest)?;
+        }
+
+        Ok(true)
+    }
+
+    /// Save the results of running a command. The command was run with the
+    /// cache key `key` in the work directory `dir`, which had contents
+    /// `before` at the time. The files that the command created or changed
+    /// are stored as its results.
+    pub fn record(&mut self, key: &DigestData, dir: &Path, before: &DirState) -> Result<()> {
+        let after = self.scan(dir)?;
+        let mut manifest = Vec::new();
+
+        for (name, d) in &after {
+            if before.get(name) == Some(d) {
+                continue;
+            }
+
+            let blob = self.blob_path(d)?;
+
+            if !blob.is_file() {
+                let mut temp = tempfile::Builder::new()
+                    .prefix("blob_")
+                    .rand_bytes(6)
+                    .tempfile_in(&self.base)?;
+                temp.write_all(&fs::read(dir.join(name))?)?;
+                temp.persist(blob)?;
+            }
+
+            writeln!(manifest, "{d} {name}")?;
+        }
+
+        let entries = self.base.join("entries");
+        fs::create_dir_all(&entries)?;
+
+        let mut temp = tempfile::Builder::new()
+            .prefix("entry_")
+            .rand_bytes(6)
+            .tempfile_in(&entries)?;
+        temp.write_all(&manifest)?;
+        temp.persist(entries.join(key.to_string()))?;
+        Ok(())
+    }
+
+    fn blob_path(&self, d: &DigestData) -> Result<PathBuf> {
+        d.create_two_part_path(&self.base.join("blobs"))
+    }
+}
+
+fn digest_file(path: &Path) -> Result<DigestData> {
+    let mut dc = digest::create();
+    let mut f = fs::File::open(path)?;
+    let mut buf = vec![0u8; 65536];
+
+    loop {
+        let n = f.read(&mut buf[..])?;
+
+        if n == 0 {
+            break;
+        }
+
+        dc.update(&buf[..n]);
+    }
+
+    Ok(DigestData::from(dc))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn record_and_replay() {
+        let base = tempfile::tempdir().unwrap();
+        let work = tempfile::tempdir().unwrap();
+        let mut cache = ShellEscapeCache::new(base.path().to_owned());
+
+        fs::write(work.path().join("input.txt"), b"hello").unwrap();
+
+        let before = cache.scan(work.path()).unwrap();
+        let key = ShellEscapeCache::key("make-output input.txt", &before);
+        assert!(!cache.replay(&key, work.path()).unwrap());
+
+        // "Run" the command.
+        fs::create_dir(work.path().join("sub")).unwrap();
+        fs::write(work.path().join("sub/output.txt"), b"world").unwrap();
+        cache.record(&key, work.path(), &before).unwrap();
+
+        // Start over with a fresh work directory.
+        let work = tempfile::tempdir().unwrap();
+        fs::write(work.path().join("input.txt"), b"hello").unwrap();
+
+        let state = cache.scan(work.path()).unwrap();
+        assert_eq!(ShellEscapeCache::key("make-output input.txt", &state), key);
+        assert_ne!(ShellEscapeCache::key("other-command", &state), key);
+        assert!(cache.replay(&key, work.path()).unwrap());
+        assert_eq!(
+            fs::read(work.path().join("sub/output.txt")).unwrap(),
+            b"world"
+        );
+
+        fs::remove_dir_all(work.path().join("sub")).unwrap();
+
+        // Different inputs give a different key, even if the command doesn't
+        // mention them ...
+        fs::write(work.path().join("data.txt"), b"1 2 3").unwrap();
+        let state = cache.scan(work.path()).unwrap();
+        assert_ne!(ShellEscapeCache::key("make-output input.txt", &state), key);
+
+        // ... unless they're ignored.
+        cache.ignore("data.txt");
+        let state = cache.scan(work.path()).unwrap();
+        assert_eq!(ShellEscapeCache::key("make-output input.txt", &state), key);
+
+        fs::write(work.path().join("input.txt"), b"goodbye").unwrap();
+        let state = cache.scan(work.path()).unwrap();
+        assert_ne!(ShellEscapeCache::key("make-output input.txt", &state), key);
+    }
+
+    #[test]
+    fn scan_skips_uninteresting_files() {
+        let base = tempfile::tempdir().unwrap();
+        let work = tempfile::tempdir().unwrap();
+        let mut cache = ShellEscapeCache::new(base.path().to_owned());
+        cache.ignore("doc.pdf");
+
+        fs::create_dir_all(work.path().join(".git/objects")).unwrap();
+        fs::write(work.path().join(".git/objects/x"), b"x").unwrap();
+        fs::write(work.path().join("doc.pdf"), b"%PDF").unwrap();
+        fs::create_dir(work.path().join("sub")).unwrap();
+        fs::write(work.path().join("sub/doc.pdf"), b"%PDF").unwrap();
+
+        let state = cache.scan(work.path()).unwrap();
+        assert_eq!(state.keys().collect::<Vec<_>>(), vec!["sub/doc.pdf"]);
+    }
+}
@@ -85,6 +85,7 @@ pub mod driver;
 pub mod engines;
 pub mod errors;
 pub mod io;
+pub mod stats;
 pub mod status;
 pub mod unstable_opts;
 
@@ -176,7 +177,7 @@ pub fn latex_to_pdf<T: AsRef<str>>(latex: T) -> Result<Vec<u8>> {
     };
 
     match files.remove("texput.pdf") {
-        Some(file) => Ok(file.data),
+        Some(file) => Ok(ctry!(file.into_data(); "failed to read the generated PDF")),
         None => Err(errmsg!(
             "LaTeX didn't report failure, but no PDF was created (??)"
         )),
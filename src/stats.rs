@@ -0,0 +1,257 @@
+// Copyright 2026 the Tectonic Project
+// Licensed under the MIT License.
+
+//! Statistics about a document processing session.
+//!
+//! After running a [`crate::driver::ProcessingSession`], its
+//! [`statistics()`](crate::driver::ProcessingSession::statistics) method
+//! gathers up how long each pass of the pipeline took, the counters reported
+//! by the engines, how much data was read from and written to each file, and
+//! how well the file lookup and bundle caches did. The result can be serialized to JSON so
+//! that it can be collected and compared across builds.
+
+use std::{collections::BTreeMap, fmt::Write, time::Duration};
+use tectonic_bundles::cache::CacheStats;
+
+/// Statistics about a processing session.
+#[derive(Clone, Debug, Default)]
+pub struct SessionStats {
+    /// The passes that were run, in order.
+    pub phases: Vec<PhaseStats>,
+
+    /// The amount of I/O done on each file, summed over all passes.
+    pub files: BTreeMap<String, FileIoStats>,
+
+    /// How the session's cache of input file lookups performed.
+    pub lookup_cache: LookupCacheStats,
+
+    /// How the bundle cache satisfied requests for files, if the bundle is
+    /// cached.
+    pub bundle_cache: Option<CacheStats>,
+}
+
+/// Statistics about one pass of a processing session.
+#[derive(Clone, Debug)]
+pub struct PhaseStats {
+    /// The name of the pass, such as `"tex"` or `"xdvipdfmx"`.
+    pub name: String,
+
+    /// The wall-clock time that the pass took.
+    pub wall_time: Duration,
+
+    /// The counters reported by the engine for this pass, if any. See, e.g.,
+    /// [`tectonic_engine_xetex::TexEngine::statistics()`].
+    pub counters: Vec<(&'static str, u64)>,
+}
+
+/// The amount of I/O done on one file.
+#[derive(Clone, Copy, Debug, Default, Eq, PartialEq)]
+pub struct FileIoStats {
+    /// The number of bytes that the engines read from the file.
+    pub bytes_read: u64,
+
+    /// The number of bytes that the engines wrote to the file.
+    pub bytes_written: u64,
+}
+
+/// Statistics about the cache that remembers where input files were found.
+///
+/// The engines probe for many files, most of which don't exist, and repeat the
+/// same probes on every pass. The cache remembers which I/O provider satisfied
+/// each lookup, or that none did.
+#[derive(Clone, Copy, Debug, Default, Eq, PartialEq)]
+pub struct LookupCacheStats {
+    /// The number of lookups of files known to exist that were sent straight
+    /// to the provider that had them.
+    pub hits: u64,
+
+    /// The number of lookups of files known not to exist that were answered
+    /// without consulting any provider.
+    pub negative_hits: u64,
+
+    /// The number of lookups that had to search through all of the providers.
+    pub misses: u64,
+
+    /// The number of cached lookups that were discarded because the file might
+    /// have changed, such as when it was written.
+    pub invalidations: u64,
+}
+
+impl SessionStats {
+    /// The total wall-clock time of all of the passes.
+    pub fn total_wall_time(&self) -> Duration {
+        self.phases.iter().map(|p| p.wall_time).sum()
+    }
+
+    /// Serialize these statistics as a JSON object.
+    ///
+    /// Times are given in seconds. The output is deterministic for a given set
+    /// of statistics: files are sorted by name, and counters are given in the
+    /// order that the engine reported them.
+    pub fn to_json(&self) -> String {
+        let mut s = String::new();
+
+        s.push_str("{\n  \"phases\": [");
+
+        for (i, phase) in self.phases.iter().enumerate() {
+            if i > 0 {
+                s.push(',');
+            }
+
+            s.push_str("\n    {\"name\": ");
+            push_json_string(&mut s, &phase.name);
+            write!(s, ", \"wall_time\": {:.6}", phase.wall_time.as_secs_f64()).unwrap();
+
+            if !phase.counters.is_empty() {
+                s.push_str(", \"counters\": {");
+
+                for (j, (name, value)) in phase.counters.iter().enumerate() {
+                    if j > 0 {
+                        s.push_str(", ");
+                    }
+
+                    push_json_string(&mut s, name);
+                    write!(s, ": {value}").unwrap();
+                }
+
+                s.push('}');
+            }
+
+            s.push('}');
+        }
+
+        if !self.phases.is_empty() {
+            s.push_str("\n  ");
+        }
+
+        write!(
+            s,
+            "],\n  \"total_wall_time\": {:.6},\n  \"files\": {{",
+            self.total_wall_time().as_secs_f64()
+        )
+        .unwrap();
+
+        for (i, (name, io)) in self.files.iter().enumerate() {
+            if i > 0 {
+                s.push(',');
+            }
+
+            s.push_str("\n    ");
+            push_json_string(&mut s, name);
+            write!(
+                s,
+                ": {{\"bytes_read\": {}, \"bytes_written\": {}}}",
+                io.bytes_read, io.bytes_written
+            )
+            .unwrap();
+        }
+
+        if !self.files.is_empty() {
+            s.push_str("\n  ");
+        }
+
+        write!(
+            s,
+            "}},\n  \"lookup_cache\": {{\"hits\": {}, \"negative_hits\": {}, \"misses\": {}, \"invalidations\": {}}}",
+            self.lookup_cache.hits,
+            self.lookup_cache.negative_hits,
+            self.lookup_cache.misses,
+            self.lookup_cache.invalidations
+        )
+        .unwrap();
+
+        s.push_str(",\n  \"bundle_cache\": ");
+
+        match self.bundle_cache {
+            Some(c) => write!(
+                s,
+                "{{\"hits\": {}, \"fetches\": {}, \"misses\": {}}}",
+                c.hits, c.fetches, c.misses
+            )
+            .unwrap(),
+            None => s.push_str("null"),
+        }
+
+        s.push_str("\n}\n");
+        s
+    }
+}
+
+/// Append `text` to `s` as a quoted JSON string.
+fn push_json_string(s: &mut String, text: &str) {
+    s.push('"');
+
+    for c in text.chars() {
+        match c {
+            '"' => s.push_str("\\\""),
+            '\\' => s.push_str("\\\\"),
+            '\n' => s.push_str("\\n"),
+            '\r' => s.push_str("\\r"),
+            '\t' => s.push_str("\\t"),
+            c if (c as u32) < 0x20 => write!(s, "\\u{:04x}", c as u32).unwrap(),
+            c => s.push(c),
+        }
+    }
+
+    s.push('"');
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn json_output() {
+        let mut stats = SessionStats::default();
+        assert_eq!(
+            stats.to_json(),
+            "{\n  \"phases\": [],\n  \"total_wall_time\": 0.000000,\n  \"files\": {},\n  \"lookup_cache\": {\"hits\": 0, \"negative_hits\": 0, \"misses\": 0, \"invalidations\": 0},\n  \"bundle_cache\": null\n}\n"
+        );
+
+        stats.phases.push(PhaseStats {
+            name: "tex".to_owned(),
+            wall_time: Duration::from_millis(1500),
+            counters: vec![("mem_lo_max", 10), ("fonts_loaded", 2)],
+        });
+        stats.phases.push(PhaseStats {
+            name: "bibtex".to_owned(),
+            wall_time: Duration::from_millis(250),
+            counters: Vec::new(),
+        });
+        stats.files.insert(
+            "a \"b\"\n.tex".to_owned(),
+            FileIoStats {
+                bytes_read: 3,
+                bytes_written: 4,
+            },
+        );
+        stats.lookup_cache = LookupCacheStats {
+            hits: 8,
+            negative_hits: 9,
+            misses: 10,
+            invalidations: 11,
+        };
+        stats.bundle_cache = Some(CacheStats {
+            hits: 5,
+            fetches: 6,
+            misses: 7,
+        });
+
+        assert_eq!(
+            stats.to_json(),
+            r#"{
+  "phases": [
+    {"name": "tex", "wall_time": 1.500000, "counters": {"mem_lo_max": 10, "fonts_loaded": 2}},
+    {"name": "bibtex", "wall_time": 0.250000}
+  ],
+  "total_wall_time": 1.750000,
+  "files": {
+    "a \"b\"\n.tex": {"bytes_read": 3, "bytes_written": 4}
+  },
+  "lookup_cache": {"hits": 8, "negative_hits": 9, "misses": 10, "invalidations": 11},
+  "bundle_cache": {"hits": 5, "fetches": 6, "misses": 7}
+}
+"#
+        );
+    }
+}
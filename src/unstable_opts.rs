@@ -15,16 +15,38 @@ use std::str::FromStr;
 const HELPMSG: &str = r#"Available unstable options:
 
     -Z help                     List all unstable options
+    -Z html-changed-list=<path> In HTML mode, write the paths of the output files that were written,
+                                    relative to the output directory, to <path>, one per line
+    -Z html-incremental         In HTML mode, don't rewrite output files whose contents haven't
+                                    changed
     -Z continue-on-errors       Keep compiling even when severe errors occur
+    -Z image-metadata-cache     Save the sizes of included images and PDF pages, and the layout of
+                                    bibliography databases, so that later builds don't have to parse
+                                    the files again. Information about bundle files is always saved
+    -Z flush-pages              Write out each PDF page as soon as it is finished, keeping memory use
+                                    bounded for very long documents
     -Z min-crossrefs=<num>      Equivalent to bibtex's -min-crossrefs flag - "include after <num>
                                     crossrefs" [default: 2]
     -Z paper-size=<spec>        Change the initial paper size [default: letter]
+    -Z preamble-format          Cache a document-specific format file containing the preloaded
+                                    preamble, and use it to skip the preamble in later TeX passes
+                                    and later builds
+    -Z profile-macros           Record the time spent expanding each macro and write it out as
+                                    <jobname>.macros.folded (flame graph input) and
+                                    <jobname>.macros.tsv
     -Z search-path=<path>       Also look in <path> for files (unless --untrusted has been specified),
                                     like TEXINPUTS. Can be specified multiple times.
+    -Z spill-threshold=<bytes>  Keep intermediate files in memory only up to <bytes>, storing larger
+                                    ones in temporary files
+    -Z stats-json=<path>        Write timings, engine statistics and I/O totals for the session to
+                                    <path> as JSON
     -Z shell-escape             Enable \write18 (unless --untrusted has been specified)
     -Z shell-escape-cwd=<path>  Working directory to use for \write18. Use $(pwd) for same behaviour as
                                     most other engines (e.g. for relative paths in \inputminted).
                                     Implies -Z shell-escape
+    -Z shell-escape-cache       Save the files created by each \write18 command, and reuse them
+                                    instead of rerunning the command when it is run again with the
+                                    same work directory contents. Implies -Z shell-escape
     -Z deterministic-mode       Force a deterministic build environment. Note that setting
                                     `SOURCE_DATE_EPOCH` is usually sufficient for reproducible builds,
                                     and this option makes some extra functionality trade-offs.
@@ -37,12 +59,21 @@ const HELPMSG: &str = r#"Available unstable options:
 #[derive(Debug, Clone)]
 pub enum UnstableArg {
     ContinueOnErrors,
+    FlushPagesEnabled,
     Help,
+    HtmlChangedList(PathBuf),
+    HtmlIncrementalEnabled,
+    ImageMetadataCacheEnabled,
     MinCrossrefs(u32),
     PaperSize(String),
+    PreambleFormatEnabled,
+    ProfileMacrosEnabled,
     SearchPath(PathBuf),
     ShellEscapeEnabled,
     ShellEscapeCwd(String),
+    ShellEscapeCacheEnabled,
+    SpillThreshold(usize),
+    StatsJson(PathBuf),
     DeterministicModeEnabled,
 }
 
@@ -78,8 +109,20 @@ impl FromStr for UnstableArg {
         match arg {
             "help" => Ok(UnstableArg::Help),
 
+            "html-changed-list" => {
+                require_value("path").map(|s| UnstableArg::HtmlChangedList(s.into()))
+            }
+
+            "html-incremental" => require_no_value(value, UnstableArg::HtmlIncrementalEnabled),
+
             "continue-on-errors" => Ok(UnstableArg::ContinueOnErrors),
 
+            "image-metadata-cache" => {
+                require_no_value(value, UnstableArg::ImageMetadataCacheEnabled)
+            }
+
+            "flush-pages" => require_no_value(value, UnstableArg::FlushPagesEnabled),
+
             "min-crossrefs" => require_value("num")
                 .and_then(|s| {
                     FromStr::from_str(s).map_err(|e| format!("-Z min-crossrefs: {e}").into())
@@ -88,6 +131,10 @@ impl FromStr for UnstableArg {
 
             "paper-size" => require_value("spec").map(|s| UnstableArg::PaperSize(s.to_string())),
 
+            "preamble-format" => require_no_value(value, UnstableArg::PreambleFormatEnabled),
+
+            "profile-macros" => require_no_value(value, UnstableArg::ProfileMacrosEnabled),
+
             "search-path" => require_value("path").map(|s| UnstableArg::SearchPath(s.into())),
 
             "shell-escape" => require_no_value(value, UnstableArg::ShellEscapeEnabled),
@@ -96,6 +143,16 @@ impl FromStr for UnstableArg {
                 require_value("path").map(|s| UnstableArg::ShellEscapeCwd(s.to_string()))
             }
 
+            "shell-escape-cache" => require_no_value(value, UnstableArg::ShellEscapeCacheEnabled),
+
+            "spill-threshold" => require_value("bytes")
+                .and_then(|s| {
+                    FromStr::from_str(s).map_err(|e| format!("-Z spill-threshold: {e}").into())
+                })
+                .map(UnstableArg::SpillThreshold),
+
+            "stats-json" => require_value("path").map(|s| UnstableArg::StatsJson(s.into())),
+
             "deterministic-mode" => require_no_value(value, UnstableArg::DeterministicModeEnabled),
 
             _ => Err(format!("Unknown unstable option '{arg}'").into()),
@@ -113,9 +170,40 @@ pub struct UnstableOptions {
     /// problems.
     pub continue_on_errors: bool,
 
+    /// Have xdvipdfmx write out each page as soon as it is finished, rather than
+    /// keeping all page objects in memory until the end of the document.
+    pub flush_pages: bool,
+
+    /// In HTML mode, only write output files whose contents have changed,
+    /// leaving up-to-date files untouched.
+    pub html_incremental: bool,
+
+    /// In HTML mode, write the list of output files that were written to this
+    /// file, one per line, relative to the output directory. Combined with
+    /// [`Self::html_incremental`], this is the set of files that changed.
+    pub html_changed_list: Option<PathBuf>,
+
+    /// Keep the information that the engines work out about included images
+    /// and bibliography databases, such as image sizes and where each `.bib`
+    /// entry starts, in a persistent cache so that later builds can
+    /// reuse it; see [`crate::io::metadata_cache`]. Within a session, it's
+    /// always shared between the engines and passes.
+    pub image_metadata_cache: bool,
+
     /// Set the paper size used by the output document.
     pub paper_size: Option<String>,
 
+    /// Dump the state of the engine at the end of the document preamble into a
+    /// document-specific format file, and use it to skip over the preamble.
+    /// The format is keyed by the preamble text and the digests of the
+    /// non-bundle files it read, and is kept in the format cache for later
+    /// builds.
+    pub preamble_format: bool,
+
+    /// Profile macro expansion in the TeX engine, writing the per-macro
+    /// timings out alongside the other outputs of the document.
+    pub profile_macros: bool,
+
     /// Allow using shell commands during document compilation. All shell escapes will be executed
     /// within a custom temporary directory that lives for the duration of the compilation session.
     /// [`Self::shell_escape_cwd`] will take precedence over this flag.
@@ -131,6 +219,20 @@ pub struct UnstableOptions {
     /// compilation is complete. This overrides [`Self::shell_escape`].
     pub shell_escape_cwd: Option<String>,
 
+    /// Cache the results of shell-escape commands across processing sessions,
+    /// keyed by the command and the contents of the work directory; see
+    /// [`crate::io::shell_escape_cache`]. This implies [`Self::shell_escape`].
+    pub shell_escape_cache: bool,
+
+    /// The size, in bytes, above which intermediate files are moved out of
+    /// memory and into temporary files. By default, everything is kept in
+    /// memory.
+    pub spill_threshold: Option<usize>,
+
+    /// If set, write statistics about the processing session to this file as
+    /// JSON once it's done; see [`crate::stats::SessionStats`].
+    pub stats_json: Option<PathBuf>,
+
     /// Ensure a deterministic build environment.
     ///
     /// The most significant user-facing difference is a static document build
@@ -157,14 +259,26 @@ impl UnstableOptions {
             match u {
                 Help => print_unstable_help_and_exit(),
                 ContinueOnErrors => opts.continue_on_errors = true,
+                FlushPagesEnabled => opts.flush_pages = true,
+                HtmlChangedList(p) => opts.html_changed_list = Some(p),
+                HtmlIncrementalEnabled => opts.html_incremental = true,
+                ImageMetadataCacheEnabled => opts.image_metadata_cache = true,
                 MinCrossrefs(num) => opts.min_crossrefs = Some(num),
                 PaperSize(size) => opts.paper_size = Some(size),
+                PreambleFormatEnabled => opts.preamble_format = true,
+                ProfileMacrosEnabled => opts.profile_macros = true,
                 ShellEscapeEnabled => opts.shell_escape = true,
                 SearchPath(p) => opts.extra_search_paths.push(p),
                 ShellEscapeCwd(p) => {
                     opts.shell_escape_cwd = Some(p);
                     opts.shell_escape = true;
                 }
+                ShellEscapeCacheEnabled => {
+                    opts.shell_escape_cache = true;
+                    opts.shell_escape = true;
+                }
+                SpillThreshold(n) => opts.spill_threshold = Some(n),
+                StatsJson(p) => opts.stats_json = Some(p),
                 DeterministicModeEnabled => opts.deterministic_mode = true,
             }
         }
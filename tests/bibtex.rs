@@ -3,19 +3,58 @@
 
 //! Bibtex test suite - compare running bibtex against many different test files
 
-use std::collections::HashSet;
+use std::collections::{HashMap, HashSet};
 use std::path::PathBuf;
 
 use tectonic::io::{FilesystemIo, IoProvider, IoStack, MemoryIo};
 use tectonic::{errors::Result, BibtexEngine};
-use tectonic_bridge_core::{CoreBridgeLauncher, MinimalDriver};
+use tectonic_bridge_core::{CoreBridgeLauncher, DriverHooks};
 use tectonic_engine_xetex::TexOutcome;
-use tectonic_status_base::NoopStatusBackend;
+use tectonic_status_base::{NoopStatusBackend, StatusBackend};
 
 #[path = "util/mod.rs"]
 mod util;
 use crate::util::{test_path, Expected, ExpectedFile};
 
+/// Saved engine metadata, keyed by file name and key. The test inputs don't
+/// change, so there's no need to key them by digest.
+type Metadata = HashMap<(String, String), Vec<u8>>;
+
+/// A driver that keeps the engine's metadata cache in memory, so that it can
+/// be shared between runs.
+struct MetadataDriver<'a> {
+    io: IoStack<'a>,
+    metadata: &'a mut Metadata,
+}
+
+impl DriverHooks for MetadataDriver<'_> {
+    fn io(&mut self) -> &mut dyn IoProvider {
+        &mut self.io
+    }
+
+    fn metadata_cache_get(
+        &mut self,
+        name: &str,
+        key: &str,
+        _status: &mut dyn StatusBackend,
+    ) -> Option<Vec<u8>> {
+        self.metadata
+            .get(&(name.to_owned(), key.to_owned()))
+            .cloned()
+    }
+
+    fn metadata_cache_put(
+        &mut self,
+        name: &str,
+        key: &str,
+        value: &[u8],
+        _status: &mut dyn StatusBackend,
+    ) {
+        self.metadata
+            .insert((name.to_owned(), key.to_owned()), value.to_owned());
+    }
+}
+
 struct TestCase {
     parts: &'static [&'static str],
     test_bbl: bool,
@@ -51,6 +90,12 @@ impl TestCase {
     }
 
     fn go(self) {
+        self.go_with_metadata(&mut Metadata::new());
+    }
+
+    /// Run the test, with the engine's metadata cache kept in *metadata*.
+    /// Returns the engine's statistics.
+    fn go_with_metadata(self, metadata: &mut Metadata) -> Vec<(&'static str, u64)> {
         util::set_test_root();
 
         let mut p = self.test_dir();
@@ -65,11 +110,12 @@ impl TestCase {
         let io_list: Vec<&mut dyn IoProvider> = vec![&mut mem, &mut assets];
 
         let io = IoStack::new(io_list);
-        let mut hooks = MinimalDriver::new(io);
+        let mut hooks = MetadataDriver { io, metadata };
         let mut status = NoopStatusBackend::default();
         let mut launcher = CoreBridgeLauncher::new(&mut hooks, &mut status);
 
-        let res = BibtexEngine::new().process(&mut launcher, &auxname, &Default::default());
+        let mut engine = BibtexEngine::new();
+        let res = engine.process(&mut launcher, &auxname, &Default::default());
 
         // Check that outputs match expectations.
 
@@ -87,6 +133,8 @@ impl TestCase {
         expect
             .file(ExpectedFile::read_with_extension(&mut p, "blg").collection(&files))
             .finish();
+
+        engine.statistics().to_vec()
     }
 }
 
@@ -135,6 +183,19 @@ fn test_multi_bib() {
     TestCase::new(&["cites", "multi_file"]).go();
 }
 
+/// Databases read cleanly once are skimmed on later runs, skipping uncited
+/// entries; the output must not change.
+#[test]
+fn test_sparse_repeated() {
+    let mut metadata = Metadata::new();
+
+    let stats = TestCase::new(&["cites", "sparse"]).go_with_metadata(&mut metadata);
+    assert_eq!(stats, [("bib_entries_skipped", 0)]);
+
+    let stats = TestCase::new(&["cites", "sparse"]).go_with_metadata(&mut metadata);
+    assert_eq!(stats, [("bib_entries_skipped", 3)]);
+}
+
 #[test]
 fn test_empty_files() {
     TestCase::new(&["empty"])
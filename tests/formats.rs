@@ -21,13 +21,14 @@ use std::{
 };
 
 use tectonic::{
-    digest::DigestData,
+    digest::{self, Digest, DigestData},
     io::{IoStack, MemoryIo},
     TexEngine,
 };
 use tectonic_bridge_core::{CoreBridgeLauncher, DriverHooks};
 use tectonic_errors::Result;
 use tectonic_io_base::{
+    digest::StreamDigest,
     filesystem::{FilesystemIo, FilesystemPrimaryInputIo},
     InputHandle, IoProvider, OpenResult, OutputHandle,
 };
@@ -38,11 +39,11 @@ use crate::util::test_path;
 
 const DEBUG: bool = false; // TODO: this is kind of ugly
 
-/// A stunted version of driver::FileSummary for examining the format file
-/// SHA256 sum.
+/// A stunted version of driver::FileSummary for checking that the format file
+/// was written.
 #[derive(Clone, Debug, Eq, PartialEq)]
 struct FileSummary {
-    write_digest: Option<DigestData>,
+    write_digest: Option<StreamDigest>,
 }
 
 impl FileSummary {
@@ -118,7 +119,7 @@ impl DriverHooks for FormatTestDriver<'_> {
         self
     }
 
-    fn event_output_closed(&mut self, name: String, digest: DigestData) {
+    fn event_output_closed(&mut self, name: String, digest: StreamDigest) {
         let summ = self
             .events
             .get_mut(&name)
@@ -163,25 +164,61 @@ fn test_format_generation(texname: &str, fmtname: &str, sha256: &str) {
         hooks
     };
 
-    // Did we get what we expected?
+    // Did we get what we expected? The I/O layer only computes fast
+    // non-cryptographic digests of what passes through it, so we compute the
+    // SHA256 of the format from the data that it captured.
 
     let want_digest = DigestData::from_str(sha256).unwrap();
-
-    for (name, info) in &hooks.events {
-        if name == fmtname {
-            let observed = info.write_digest.unwrap();
-
-            if observed != want_digest {
-                println!("expected {fmtname} to have SHA256 = {want_digest}");
-                println!("instead, got {observed}");
-                panic!();
-            }
+    let written = hooks
+        .events
+        .get(fmtname)
+        .is_some_and(|info| info.write_digest.is_some());
+    drop(hooks);
+
+    if written && !DEBUG {
+        let files = mem.files.borrow();
+        let data = files[fmtname].contents().unwrap();
+        let mut dc = digest::create();
+        dc.update(&data);
+        let observed = DigestData::from(dc);
+
+        if observed != want_digest {
+            println!("expected {fmtname} to have SHA256 = {want_digest}");
+            println!("instead, got {observed}");
+            panic!();
         }
     }
 }
 
 // Keep these alphabetized.
 
+/// Make a format with only a few spare hash entries, so that the control
+/// sequences it defines have to share bucket chains, and check that they can
+/// all be found when it is loaded again.
+#[test]
+fn hash_chains() {
+    util::set_test_root();
+
+    let mut p = test_path(&["assets", "hash_chains.tex"]);
+    let mut tex = FilesystemPrimaryInputIo::new(&p);
+    p.pop();
+    let mut fs_support = FilesystemIo::new(&p, false, false, HashSet::new());
+    let mut mem = MemoryIo::new(true);
+
+    for initex in [true, false] {
+        let io = IoStack::new(vec![&mut mem, &mut tex, &mut fs_support]);
+        let mut hooks = FormatTestDriver::new(io);
+        let mut status = NoopStatusBackend::default();
+        let mut launcher = CoreBridgeLauncher::new(&mut hooks, &mut status);
+
+        TexEngine::default()
+            .initex_mode(initex)
+            .hash_extra(100)
+            .process(&mut launcher, "hash_chains.fmt", "hash_chains.tex")
+            .unwrap();
+    }
+}
+
 #[test]
 fn plain_format() {
     test_format_generation(
@@ -373,6 +373,11 @@ fn xetex_g_builtins() {
     TestCase::new("xetex_g_builtins").check_pdf(true).go()
 }
 
+#[test]
+fn xetex_input_normalization() {
+    TestCase::new("xetex_input_normalization").go()
+}
+
 #[test]
 fn xetex_ot_builtins() {
     TestCase::new("xetex_ot_builtins").check_pdf(true).go()